@@ -2,6 +2,9 @@
 #define ACTIVATION_LAYER_HPP
 
 #include <string>
+#include <cstddef>
+#include <memory>
+#include <vector>
 #include "tensor.hpp"
 #include "layer.hpp"
 
@@ -14,6 +17,25 @@ public:
     /* Layer functionality */
     Tensor forward(const Tensor& input) override;
     Tensor backward(const Tensor& output) override;
+    void infer(const Tensor& input, Tensor& output) const override;
+
+    /* Parameters */
+    std::vector<Parameter> get_parameters() override;
+
+    /* Forward caches */
+    void clear_cache() override;
+    size_t get_cache_bytes() const override;
+
+    /* Replication */
+    std::unique_ptr<Layer> replicate() const override;
+
+    /* Serialization */
+    std::string get_name() const override;
+    std::vector<double> get_config() const override;
+
+    /* Profiling */
+    double get_forward_flops(const Tensor& input) const override;
+    double get_backward_flops(const Tensor& input) const override;
     
 private:
 
@@ -21,11 +43,11 @@ private:
     std::string activation_function_name_;
 
     /* Activation functions */
-    Tensor sigmoid(const Tensor& in) const;
+    void sigmoid(const Tensor& in, Tensor& out) const;
     Tensor sigmoid_derivative(const Tensor& in) const;
-    Tensor relu(const Tensor& in) const;
+    void relu(const Tensor& in, Tensor& out) const;
     Tensor relu_derivative(const Tensor& in) const;
-    Tensor softmax(const Tensor& in) const;
+    void softmax(const Tensor& in, Tensor& out) const;
     Tensor softmax_derivative(const Tensor& in) const;
 };
 
@@ -0,0 +1,28 @@
+#ifndef ADAM_OPTIMIZER_HPP
+#define ADAM_OPTIMIZER_HPP
+
+#include "optimizer.hpp"
+
+class AdamOptimizer : public Optimizer {
+public:
+
+    /* Constructors */
+    AdamOptimizer();
+    AdamOptimizer(const double beta1, const double beta2, const double epsilon);
+
+protected:
+    void update(double* value,
+                double* gradient,
+                double* const* state,
+                const int size,
+                const double learning_rate,
+                const double gradient_scale,
+                const long step) const override;
+
+private:
+    double beta1_;
+    double beta2_;
+    double epsilon_;
+};
+
+#endif
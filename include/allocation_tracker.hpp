@@ -0,0 +1,133 @@
+#ifndef ALLOCATION_TRACKER_HPP
+#define ALLOCATION_TRACKER_HPP
+
+#include <cstddef>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <new>
+
+/* The part of a training step an allocation was made in */
+enum class AllocationPass {
+    forward,
+    backward,
+    update,
+    other
+};
+
+const int num_allocation_passes = 4;
+
+struct AllocationCounters {
+    long allocations;
+    size_t bytes;
+};
+
+/* Everything recorded since the report was last reset */
+struct AllocationReport {
+    int num_layers;
+    // Indexed by (layer + 1) * num_allocation_passes + pass, layer -1 collects allocations made outside any layer
+    std::vector<AllocationCounters> scopes;
+    long frees;
+    long steps;
+    long step_allocations;
+    size_t step_bytes;
+    long max_step_allocations;
+    size_t max_step_bytes;
+    // The most the live bytes grew above their level at the start of a step
+    size_t max_step_growth_bytes;
+    // Live bytes count from when tracking was enabled
+    size_t peak_live_bytes;
+};
+
+/* Counts the allocations of Matrix storage, which goes through TrackingAllocator.
+ * Nothing is counted while disabled. While enabled, every thread counts into its
+ * own counters, which are merged into the report when a step begins and ends.
+ * Allocations are attributed to the scope set by the training thread, including
+ * the ones made by thread pool workers on its behalf. Peaks are summed over the
+ * threads' own peaks, so they are an upper bound when several threads allocate. */
+class AllocationTracker {
+public:
+
+    AllocationTracker(const AllocationTracker& other) = delete;
+    AllocationTracker& operator=(const AllocationTracker& other) = delete;
+
+    /* Global tracker, never destroyed so static matrices can release their storage */
+    static AllocationTracker& get_global();
+
+    /* Tracking */
+    void enable(const int num_layers);
+    void disable();
+    bool is_enabled() const;
+    // layer is -1 outside any layer
+    void set_scope(const int layer, const AllocationPass pass);
+    void begin_step();
+    void end_step();
+
+    /* Accounting */
+    void record_allocation(const size_t bytes);
+    void record_free(const size_t bytes);
+
+    /* Reports */
+    // The bytes allocated and not freed since tracking was enabled
+    size_t get_live_bytes() const;
+    AllocationReport get_report() const;
+    void reset_report();
+    // Per step and total counts, then a row for every layer and pass that allocated
+    std::string format_report(const std::vector<std::string>& layer_names) const;
+
+private:
+    struct ThreadCounters;
+
+    std::atomic<bool> enabled_;
+    // Incremented by enable, threads register new counters when it changes
+    std::atomic<int> generation_;
+    std::atomic<int> scope_;
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<ThreadCounters>> thread_counters_;
+    AllocationReport report_;
+    bool in_step_;
+    long long step_start_live_bytes_;
+
+    AllocationTracker();
+
+    ThreadCounters& get_thread_counters();
+    // Moves the counts of every thread into the report, mutex_ must be held
+    void merge_thread_counters(long& allocations, size_t& bytes);
+    long long get_thread_live_bytes() const;
+};
+
+/* Allocator for Matrix storage that reports to the global tracker */
+template <typename T>
+class TrackingAllocator {
+public:
+    using value_type = T;
+
+    TrackingAllocator() = default;
+    template <typename U>
+    TrackingAllocator(const TrackingAllocator<U>&) {}
+
+    T* allocate(const size_t n) {
+        T* pointer = static_cast<T*>(::operator new(n * sizeof(T)));
+        AllocationTracker::get_global().record_allocation(n * sizeof(T));
+        return pointer;
+    }
+
+    void deallocate(T* pointer, const size_t n) {
+        AllocationTracker::get_global().record_free(n * sizeof(T));
+        ::operator delete(pointer);
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const TrackingAllocator<T>&, const TrackingAllocator<U>&) {
+    return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const TrackingAllocator<T>&, const TrackingAllocator<U>&) {
+    return false;
+}
+
+#endif
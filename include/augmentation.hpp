@@ -0,0 +1,24 @@
+#ifndef AUGMENTATION_HPP
+#define AUGMENTATION_HPP
+
+#include <random>
+#include "tensor.hpp"
+
+/* Random distortions of single channel images, applied as one resampling pass:
+ * every output pixel is read from the input at a rotated, shifted and
+ * elastically displaced position with bilinear interpolation and zero padding. */
+namespace augmentation {
+    struct Options {
+        double max_shift;
+        double max_rotation_degrees;
+        // Elastic distortion of Simard et al.: a random displacement field smoothed with a Gaussian
+        // of elastic_sigma pixels and scaled by elastic_alpha, 0 disables it
+        double elastic_alpha;
+        double elastic_sigma;
+    };
+
+    Options default_options();
+    void augment(const Tensor& input, Tensor& output, const Options& options, std::mt19937& generator);
+}
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef AUGMENTATION_PIPELINE_HPP
+#define AUGMENTATION_PIPELINE_HPP
+
+#include <vector>
+#include <thread>
+#include <memory>
+#include <chrono>
+#include <exception>
+#include "tensor.hpp"
+#include "mnist_data_set.hpp"
+#include "augmentation.hpp"
+#include "bounded_queue.hpp"
+
+/* Augments the training set on its own worker threads, ahead of training. Worker
+ * i produces batches i, i + num_workers, ... into its own bounded queue, and the
+ * consumer takes them round robin, so batches arrive in order. Every sample is
+ * distorted with a generator seeded from the seed, epoch and sample position, so
+ * the output does not depend on the number of workers or their timing. */
+class AugmentationPipeline {
+public:
+
+    struct Batch {
+        std::vector<Tensor> data;
+        std::vector<Tensor> labels;
+    };
+
+    /* Constructors */
+    AugmentationPipeline(const MNISTDataSet& data_set,
+                         const augmentation::Options& options,
+                         const int num_workers,
+                         const int batch_size,
+                         const int queue_capacity,
+                         const unsigned seed);
+    AugmentationPipeline(const AugmentationPipeline& other) = delete;
+    AugmentationPipeline& operator=(const AugmentationPipeline& other) = delete;
+    ~AugmentationPipeline();
+
+    /* Getters */
+    int get_num_workers() const;
+    long get_num_batches() const;
+    // Batches that were not ready when the consumer asked for them, and the time spent waiting on those
+    long get_num_starved() const;
+    std::chrono::microseconds get_starved_time() const;
+
+    /* Operations */
+    // Starts augmenting the given epoch from first_position, stopping any epoch still in progress
+    void start_epoch(const int epoch, const int first_position);
+    // Fills the next batch in order, false once the epoch is done
+    bool next(Batch& batch);
+
+private:
+
+    struct Message {
+        Batch batch;
+        std::exception_ptr error;
+    };
+
+    const MNISTDataSet& data_set_;
+    augmentation::Options options_;
+    int num_workers_;
+    int batch_size_;
+    int queue_capacity_;
+    unsigned seed_;
+    std::vector<std::unique_ptr<BoundedQueue<Message>>> queues_;
+    std::vector<std::thread> workers_;
+    long next_batch_;
+    long num_batches_;
+    long num_starved_;
+    std::chrono::microseconds starved_time_;
+
+    void stop();
+    void work(const int worker, const int epoch, const int first_position);
+};
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef BOUNDED_QUEUE_HPP
+#define BOUNDED_QUEUE_HPP
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <stdexcept>
+#include <utility>
+
+/* Blocking FIFO with a fixed capacity. Closing the queue wakes every waiting
+ * thread: push then fails, and pop fails once the remaining items are drained. */
+template <typename T>
+class BoundedQueue {
+public:
+
+    /* Constructors */
+    BoundedQueue(const int capacity);
+
+    /* Operations */
+    bool push(T item);
+    bool pop(T& item);
+    // Fails if nothing arrives before the deadline
+    bool pop_until(T& item, const std::chrono::steady_clock::time_point& deadline);
+    // Fails instead of waiting when the queue is empty
+    bool try_pop(T& item);
+    void close();
+
+private:
+    int capacity_;
+    bool closed_;
+    std::deque<T> items_;
+    std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+};
+
+/******************************************************
+ * Constructors
+ *****************************************************/
+
+template <typename T>
+BoundedQueue<T>::BoundedQueue(const int capacity):
+    capacity_(capacity),
+    closed_(false) {
+
+    if (capacity <= 0) {
+        throw std::invalid_argument("BoundedQueue constructor: capacity must be greater than 0");
+    }
+}
+
+/******************************************************
+ * Operations
+ *****************************************************/
+
+template <typename T>
+bool BoundedQueue<T>::push(T item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_full_.wait(lock, [this] { return closed_ || static_cast<int>(items_.size()) < capacity_; });
+
+    if (closed_) {
+        return false;
+    }
+
+    items_.push_back(std::move(item));
+    lock.unlock();
+    not_empty_.notify_one();
+    return true;
+}
+
+template <typename T>
+bool BoundedQueue<T>::pop(T& item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+
+    if (items_.empty()) {
+        return false;
+    }
+
+    item = std::move(items_.front());
+    items_.pop_front();
+    lock.unlock();
+    not_full_.notify_one();
+    return true;
+}
+
+template <typename T>
+bool BoundedQueue<T>::pop_until(T& item, const std::chrono::steady_clock::time_point& deadline) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait_until(lock, deadline, [this] { return closed_ || !items_.empty(); });
+
+    if (items_.empty()) {
+        return false;
+    }
+
+    item = std::move(items_.front());
+    items_.pop_front();
+    lock.unlock();
+    not_full_.notify_one();
+    return true;
+}
+
+template <typename T>
+bool BoundedQueue<T>::try_pop(T& item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (items_.empty()) {
+        return false;
+    }
+
+    item = std::move(items_.front());
+    items_.pop_front();
+    lock.unlock();
+    not_full_.notify_one();
+    return true;
+}
+
+template <typename T>
+void BoundedQueue<T>::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+    }
+    not_empty_.notify_all();
+    not_full_.notify_all();
+}
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include "tensor.hpp"
+#include "optimizer.hpp"
+#include "neural_network.hpp"
+
+/* Versioned binary checkpoint of a network's topology, parameters and training state, in host byte order.
+ *   Header:  char[8] magic "CNNCKPT", uint32 version, uint32 byte order marker, uint32 num_layers,
+ *            uint32 optimizer state buffers per parameter, uint64 file size, int64 epoch, int64 sample
+ *   Layers:  uint32 name length, uint32 config count, uint32 tensor count, uint32 reserved,
+ *            name bytes, config count float64 constructor arguments, then per tensor
+ *            uint32 depth, uint32 rows, uint32 columns, uint32 reserved, uint64 data offset,
+ *            int64 optimizer step, uint64 optimizer state offset
+ *   Data:    float64 parameter values of each tensor followed, when its optimizer step is not 0, by its
+ *            optimizer state buffers, every block starting on a 64 byte boundary */
+namespace checkpoint {
+    const uint32_t version = 2;
+
+    /* Where training resumes: the next sample of the given epoch */
+    struct Position {
+        long epoch;
+        long sample;
+    };
+
+    /* A copy of everything written to a checkpoint, taken between training steps */
+    struct LayerSnapshot {
+        std::string name;
+        std::vector<double> config;
+        std::vector<Tensor> parameters;
+        std::vector<Optimizer::ParameterState> optimizer_states;
+    };
+
+    struct Snapshot {
+        int num_state_buffers;
+        Position position;
+        std::vector<LayerSnapshot> layers;
+    };
+
+    Snapshot capture(NeuralNetwork& network, const Position& position);
+    // Writes to a temporary file, syncs it and renames it over path, so path always holds a complete checkpoint
+    void write(const Snapshot& snapshot, const std::string& path);
+    void save(NeuralNetwork& network, const std::string& path, const Position& position = {0, 0});
+
+    // Maps the file and uses the parameters in place, pages are only copied when training writes to them
+    NeuralNetwork load(const std::string& path);
+    // Also installs optimizer with its saved state and returns where training stopped
+    NeuralNetwork load(const std::string& path, std::shared_ptr<Optimizer> optimizer, Position& position);
+}
+
+#endif
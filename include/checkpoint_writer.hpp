@@ -0,0 +1,61 @@
+#ifndef CHECKPOINT_WRITER_HPP
+#define CHECKPOINT_WRITER_HPP
+
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+#include <memory>
+#include <exception>
+#include "neural_network.hpp"
+#include "checkpoint.hpp"
+#include "bounded_queue.hpp"
+
+/* Periodic checkpoints written by a background thread. The training thread only
+ * copies the parameters and optimizer state; serializing, syncing and renaming
+ * the file happen while training continues. A checkpoint that comes due while
+ * the previous one is still being written is skipped. */
+class CheckpointWriter {
+public:
+
+    /* Constructors */
+    // An interval of 0 disables that trigger
+    CheckpointWriter(const std::string& path, const long sample_interval, const std::chrono::seconds time_interval);
+    CheckpointWriter(const CheckpointWriter& other) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter& other) = delete;
+    ~CheckpointWriter();
+
+    /* Getters */
+    int get_num_written() const;
+
+    /* Operations */
+    // Called after every training sample, captures a checkpoint when one of the intervals has passed
+    void on_sample(NeuralNetwork& network, const checkpoint::Position& position);
+    // Captures a checkpoint now, waiting for the one in progress to finish first
+    void write(NeuralNetwork& network, const checkpoint::Position& position);
+    // Waits for the checkpoint in progress and rethrows any error from the background thread
+    void flush();
+
+private:
+    std::string path_;
+    long sample_interval_;
+    std::chrono::seconds time_interval_;
+    long samples_since_checkpoint_;
+    std::chrono::steady_clock::time_point last_checkpoint_;
+    std::atomic<int> num_written_;
+    BoundedQueue<std::unique_ptr<checkpoint::Snapshot>> snapshots_;
+    std::mutex mutex_;
+    std::condition_variable idle_;
+    bool busy_;
+    std::exception_ptr error_;
+    std::thread thread_;
+
+    void submit(NeuralNetwork& network, const checkpoint::Position& position);
+    bool is_busy();
+    void rethrow_error();
+    void run();
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef CNN_H
+#define CNN_H
+
+/* C interface for embedding inference, built into build/libcnn.a and build/libcnn.so by make lib.
+ * Every function returns a status instead of letting a C++ exception escape, and
+ * cnn_last_error describes the most recent failure on the calling thread.
+ *
+ * Samples are float arrays of depth x rows x columns values, channel by channel
+ * and row-major within a channel, and a batch is its samples back to back. A model
+ * keeps the scratch space of one inference, so cnn_model_run does not allocate once
+ * it has run the first time. A model must not be used by two threads at once:
+ * create one per thread, the weights of a checkpoint are mapped and shared. */
+
+#if defined(__GNUC__) || defined(__clang__)
+#define CNN_API __attribute__((visibility("default")))
+#else
+#define CNN_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct cnn_model cnn_model;
+
+typedef enum {
+    CNN_OK = 0,
+    CNN_ERROR_INVALID_ARGUMENT = 1,
+    /* The checkpoint could not be read or is not a valid checkpoint */
+    CNN_ERROR_IO = 2,
+    CNN_ERROR_OUT_OF_MEMORY = 3,
+    CNN_ERROR_INTERNAL = 4
+} cnn_status;
+
+typedef struct {
+    int depth;
+    int rows;
+    int columns;
+} cnn_shape;
+
+/* Loads a checkpoint written by main --save, *model is only set on success */
+CNN_API cnn_status cnn_model_create(const char* checkpoint_path, cnn_model** model);
+/* Accepts NULL */
+CNN_API void cnn_model_destroy(cnn_model* model);
+
+CNN_API cnn_status cnn_model_input_shape(const cnn_model* model, cnn_shape* shape);
+CNN_API cnn_status cnn_model_output_shape(const cnn_model* model, cnn_shape* shape);
+
+/* Predicts batch_size samples from inputs into outputs, which must hold batch_size
+ * times the input and output shape sizes, and may be NULL for an empty batch.
+ * Outputs are left unspecified on failure. */
+CNN_API cnn_status cnn_model_run(cnn_model* model, const float* inputs, int batch_size, float* outputs);
+
+/* The message of the last failed call on this thread, empty if there was none */
+CNN_API const char* cnn_last_error(void);
+CNN_API const char* cnn_status_string(cnn_status status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
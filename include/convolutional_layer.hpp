@@ -3,6 +3,8 @@
 
 #include <string>
 #include <vector>
+#include <cstddef>
+#include <memory>
 #include "tensor.hpp"
 #include "layer.hpp"
 
@@ -21,6 +23,25 @@ public:
     /* Layer functionality */
     Tensor forward(const Tensor& input) override;
     Tensor backward(const Tensor& output) override;
+    void infer(const Tensor& input, Tensor& output) const override;
+
+    /* Parameters */
+    std::vector<Parameter> get_parameters() override;
+
+    /* Forward caches */
+    void clear_cache() override;
+    size_t get_cache_bytes() const override;
+
+    /* Replication */
+    std::unique_ptr<Layer> replicate() const override;
+
+    /* Serialization */
+    std::string get_name() const override;
+    std::vector<double> get_config() const override;
+
+    /* Profiling */
+    double get_forward_flops(const Tensor& input) const override;
+    double get_backward_flops(const Tensor& input) const override;
     
 private:
     int output_depth_;
@@ -34,8 +55,10 @@ private:
     int stride_;
     Tensor input_;
     Tensor output_;
-    std::vector<Tensor> filters_;
-    Tensor biases_;
+    std::shared_ptr<std::vector<Tensor>> filters_;
+    std::shared_ptr<Tensor> biases_;
+    std::vector<Tensor> filters_gradient_;
+    Tensor biases_gradient_;
     double learning_rate_;
 };
 
@@ -0,0 +1,35 @@
+#ifndef EVALUATION_HPP
+#define EVALUATION_HPP
+
+#include <string>
+#include <vector>
+#include "neural_network.hpp"
+#include "mnist_data_set.hpp"
+#include "streaming_data_set.hpp"
+
+/* Test set evaluation. Batches of samples are predicted in parallel on the
+ * global thread pool and reduced in sample order, so the results do not
+ * depend on the number of threads. Only NeuralNetwork::predict is used, which
+ * leaves the layers' training caches and gradients untouched. */
+namespace evaluation {
+
+    struct Evaluation {
+        long num_samples;
+        long num_correct;
+        double accuracy;
+        // Mean cross entropy of the expected class
+        double loss;
+        // confusion[expected][predicted] counts the samples of every class by the class predicted for them,
+        // one row and column per network output, empty when there were no samples
+        std::vector<std::vector<long>> confusion;
+    };
+
+    Evaluation evaluate(const NeuralNetwork& network, const MNISTDataSet& data_set, const int batch_size = 256);
+    // Reads one pass of the stream, predicting each batch in parallel as it arrives
+    Evaluation evaluate(const NeuralNetwork& network, StreamingDataSet& data_set, const int batch_size = 256);
+
+    // The confusion matrix with per-class recall and precision
+    std::string format_confusion(const Evaluation& evaluation);
+}
+
+#endif
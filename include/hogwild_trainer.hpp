@@ -0,0 +1,29 @@
+#ifndef HOGWILD_TRAINER_HPP
+#define HOGWILD_TRAINER_HPP
+
+#include <vector>
+#include "neural_network.hpp"
+#include "mnist_data_set.hpp"
+
+/* Lock-free asynchronous SGD: every thread trains its own replica of the network,
+ * and all replicas update the same shared parameters without synchronization. */
+class HogwildTrainer {
+public:
+
+    /* Constructors */
+    HogwildTrainer(NeuralNetwork& network, const int num_threads);
+
+    /* Getters */
+    int get_num_threads() const;
+
+    /* Operations */
+    // Trains on the training set from first_sample to its end
+    void train(const MNISTDataSet& data_set, const int first_sample = 0);
+
+private:
+    int num_threads_;
+    NeuralNetwork& network_;
+    std::vector<NeuralNetwork> replicas_;
+};
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef INFERENCE_PROTOCOL_HPP
+#define INFERENCE_PROTOCOL_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/* Wire format of the inference server, in host byte order since it only listens on a Unix socket.
+ *   Predict request:  uint32 type, uint32 count, count float32 input values (depth, then rows, then columns)
+ *   Stats request:    uint32 type
+ *   Response:         uint32 status, uint32 count, then count float32 outputs or count bytes of JSON stats */
+namespace inference_protocol {
+    const uint32_t predict_request = 1;
+    const uint32_t stats_request = 2;
+
+    const uint32_t status_ok = 0;
+    const uint32_t status_error = 1;
+
+    bool read_exact(const int fd, void* buffer, const size_t size);
+    bool write_exact(const int fd, const void* buffer, const size_t size);
+    bool read_u32(const int fd, uint32_t& value);
+    bool write_u32(const int fd, const uint32_t value);
+    bool write_response(const int fd, const uint32_t status, const std::vector<float>& values);
+    bool write_response(const int fd, const uint32_t status, const std::string& text);
+
+    int connect_unix_socket(const std::string& socket_path);
+}
+
+#endif
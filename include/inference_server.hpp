@@ -0,0 +1,81 @@
+#ifndef INFERENCE_SERVER_HPP
+#define INFERENCE_SERVER_HPP
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <set>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <future>
+#include <chrono>
+#include <memory>
+#include "tensor.hpp"
+#include "neural_network.hpp"
+#include "bounded_queue.hpp"
+
+/* Serves predictions over a Unix domain socket. Requests from all connections are
+ * queued and grouped into batches of up to max_batch_size, or whatever arrived
+ * within max_delay of the oldest request, and every batch runs in parallel on the
+ * global thread pool against the shared read-only network. */
+class InferenceServer {
+public:
+
+    /* Constructors */
+    InferenceServer(const NeuralNetwork& network,
+                    const std::string& socket_path,
+                    const int input_depth,
+                    const int input_rows,
+                    const int input_columns,
+                    const int max_batch_size,
+                    const std::chrono::microseconds max_delay);
+    InferenceServer(const InferenceServer& other) = delete;
+    InferenceServer& operator=(const InferenceServer& other) = delete;
+    ~InferenceServer();
+
+    /* Operations */
+    void run();
+    // Safe to call from a signal handler, run returns shortly afterwards
+    void request_stop();
+
+    /* Statistics */
+    std::string get_stats_json() const;
+
+private:
+
+    struct Request {
+        Tensor input;
+        std::chrono::steady_clock::time_point arrival;
+        std::promise<Tensor> result;
+    };
+
+    const NeuralNetwork& network_;
+    std::string socket_path_;
+    int input_depth_;
+    int input_rows_;
+    int input_columns_;
+    int max_batch_size_;
+    std::chrono::microseconds max_delay_;
+    int listen_fd_;
+    std::atomic<bool> stop_requested_;
+    BoundedQueue<std::shared_ptr<Request>> requests_;
+
+    std::mutex connections_mutex_;
+    // Open connections, each served by a detached thread until it erases its fd
+    std::set<int> connection_fds_;
+    std::condition_variable connections_closed_;
+
+    mutable std::mutex stats_mutex_;
+    std::chrono::steady_clock::time_point start_time_;
+    long num_requests_;
+    long num_batches_;
+    std::deque<double> recent_latencies_us_;
+
+    void batch_loop();
+    void serve_connection(const int fd);
+    void record_batch(const std::vector<std::shared_ptr<Request>>& batch, const std::chrono::steady_clock::time_point& completion);
+};
+
+#endif
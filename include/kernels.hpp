@@ -0,0 +1,46 @@
+#ifndef KERNELS_HPP
+#define KERNELS_HPP
+
+#include <string>
+#include <vector>
+
+/* The hot numeric loops behind Matrix and ActivationLayer, compiled once for
+ * every instruction set below and selected on first use from cpuid. The
+ * CNN_ISA environment variable (generic, sse4.2, avx2 or avx512) pins a
+ * variant. Every variant vectorizes across independent outputs and keeps
+ * the order of each sum, so all of them return identical results. */
+namespace kernels {
+
+    enum class Isa { generic, sse42, avx2, avx512 };
+
+    /* Dispatch */
+    Isa get_isa();
+    // Switches every later kernel call to isa, which must be supported by the CPU
+    void set_isa(const Isa isa);
+    bool is_supported(const Isa isa);
+    // Generic first, then each supported variant in increasing width
+    std::vector<Isa> get_supported_isas();
+    std::string get_isa_name(const Isa isa);
+    Isa parse_isa(const std::string& name);
+
+    /* Kernels on row-major arrays, the output never aliases an input */
+    // result (rows x columns) = a (rows x inner) * b (inner x columns)
+    void multiply(const double* a, const double* b, double* result, const int rows, const int inner, const int columns);
+    // Adds the valid correlation of input with filter to result, whose dimensions follow from the stride
+    void correlate_accumulate(const double* input, const int rows, const int columns, const double* filter,
+                              const int filter_rows, const int filter_columns, const int stride, double* result);
+    // Window maxima of a non-negative input, the padding counts as zeros
+    void max_pool_forward(const double* input, const int rows, const int columns, const int window_size, const int stride,
+                          const int padding_top, const int padding_left, double* result, const int result_rows,
+                          const int result_columns);
+    // Adds each output gradient to result at the last maximum of its window
+    void max_pool_backward(const double* input, const int rows, const int columns, const int window_size, const int stride,
+                           const int padding_top, const int padding_left, const double* output, const int result_rows,
+                           const int result_columns, double* result);
+    void relu(const double* input, double* output, const int size);
+    void relu_derivative(const double* input, double* output, const int size);
+    void sigmoid(const double* input, double* output, const int size);
+    void sigmoid_derivative(const double* input, double* output, const int size);
+}
+
+#endif
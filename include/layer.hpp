@@ -1,14 +1,52 @@
 #ifndef LAYER_HPP
 #define LAYER_HPP
 
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
 #include "tensor.hpp"
 
+/* A trainable tensor together with the gradient accumulated for it by backward */
+struct Parameter {
+    Tensor* value;
+    Tensor* gradient;
+    double learning_rate;
+};
+
 class Layer {
 public:
 
+    virtual ~Layer() = default;
+
     /* Layer functionality */
     virtual Tensor forward(const Tensor& input) = 0;
     virtual Tensor backward(const Tensor& output) = 0;
+    // Computes the forward pass into output without touching any layer state, safe to call from several threads
+    virtual void infer(const Tensor& input, Tensor& output) const = 0;
+
+    /* Parameters */
+    // Backward adds to the gradients, the optimizer applies and clears them
+    virtual std::vector<Parameter> get_parameters() = 0;
+
+    /* Forward caches */
+    // Releases the tensors kept by forward for backward, forward repopulates them
+    virtual void clear_cache() = 0;
+    virtual size_t get_cache_bytes() const = 0;
+
+    /* Replication */
+    // Creates a layer that shares this layer's parameters but has its own forward caches
+    virtual std::unique_ptr<Layer> replicate() const = 0;
+
+    /* Serialization */
+    // The layer type and its constructor arguments, enough for checkpoint::load to rebuild it
+    virtual std::string get_name() const = 0;
+    virtual std::vector<double> get_config() const = 0;
+
+    /* Profiling */
+    // Estimated floating point operations of one forward or backward pass on an input of this shape
+    virtual double get_forward_flops(const Tensor& input) const = 0;
+    virtual double get_backward_flops(const Tensor& input) const = 0;
 
 };
 
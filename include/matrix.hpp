@@ -3,6 +3,8 @@
 
 #include <vector>
 #include <string>
+#include <memory>
+#include "allocation_tracker.hpp"
 
 class Matrix {
 public:
@@ -11,12 +13,18 @@ public:
     Matrix(const int rows, const int columns);
     Matrix(const std::vector<std::vector<double>>& input_matrix);
     Matrix(const Matrix& other);
+    Matrix(Matrix&& other) noexcept;
+    // Wraps external storage without copying it, owner keeps the storage alive
+    Matrix(const int rows, const int columns, double* data, std::shared_ptr<void> owner);
 
     /* Accessors */
     int get_num_rows() const;
     int get_num_columns() const;
     double& operator()(const int row, const int column);
     const double& operator()(const int row, const int column) const;
+    int get_size() const;
+    double* get_data();
+    const double* get_data() const;
     double get_minimum() const;
 
     /* Matrix operations */
@@ -28,18 +36,24 @@ public:
     Matrix element_wise_multiply(const Matrix& other) const;
     Matrix scalar_multiply(const double multiplier) const;
     Matrix transpose() const;
+    void multiply_into(const Matrix& other, Matrix& result) const;
 
     /* Neural network operations */
     Matrix correlate(const Matrix& filter, const int stride, const std::string& padding_type) const;
     Matrix convolve(const Matrix& filter, const int stride, const std::string& padding_type) const;
     Matrix max_pool_forward(const int window_size, const int stride) const;
     Matrix max_pool_backward(const Matrix& output, const int window_size, const int stride) const;
+    void correlate_accumulate(const Matrix& filter, const int stride, Matrix& result) const;
+    void max_pool_forward_into(const int window_size, const int stride, Matrix& result) const;
 
     /* Other operations */
     Matrix& operator=(const Matrix& other);
+    Matrix& operator=(Matrix&& other) noexcept;
     void randomize();
     void randomize(const double mean, const double std_dev);
+    void fill(const double value);
     void reshape(const int rows, const int columns);
+    void resize(const int rows, const int columns);
     bool operator==(const Matrix& other) const;
     bool operator!=(const Matrix& other) const;
 
@@ -50,7 +64,14 @@ public:
 private:
     int rows_;
     int columns_;
-    std::vector<double> data_;
+    std::vector<double, TrackingAllocator<double>> storage_;
+    double* data_;
+    std::shared_ptr<void> owner_;
+
+    void detach(const int size);
+    // Adds the correlation of this matrix, zero padded on every side, to result
+    void correlate_padded(const Matrix& filter, const int stride, const int padding_rows, const int padding_columns,
+                          const int padding_top, const int padding_left, Matrix& result) const;
 };
 
 #endif
\ No newline at end of file
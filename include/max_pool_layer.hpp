@@ -1,6 +1,10 @@
 #ifndef MAX_POOL_LAYER_HPP
 #define MAX_POOL_LAYER_HPP
 
+#include <cstddef>
+#include <string>
+#include <memory>
+#include <vector>
 #include "tensor.hpp"
 #include "layer.hpp"
 
@@ -13,6 +17,25 @@ public:
     /* Layer functionality */
     Tensor forward(const Tensor& input) override;
     Tensor backward(const Tensor& output) override;
+    void infer(const Tensor& input, Tensor& output) const override;
+
+    /* Parameters */
+    std::vector<Parameter> get_parameters() override;
+
+    /* Forward caches */
+    void clear_cache() override;
+    size_t get_cache_bytes() const override;
+
+    /* Replication */
+    std::unique_ptr<Layer> replicate() const override;
+
+    /* Serialization */
+    std::string get_name() const override;
+    std::vector<double> get_config() const override;
+
+    /* Profiling */
+    double get_forward_flops(const Tensor& input) const override;
+    double get_backward_flops(const Tensor& input) const override;
     
 private:
     int window_size_;
@@ -1,31 +1,64 @@
 #ifndef MNIST_DATA_SET_HPP
 #define MNIST_DATA_SET_HPP
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <vector>
+#include <chrono>
 #include "tensor.hpp"
+#include "sample_view.hpp"
 
+/* Samples are kept in one buffer of uint8 records, a label byte followed by the
+ * 28x28 pixels, and only normalized to [0, 1] when copied into a tensor. The
+ * train and test sets are index arrays into that buffer, so shuffling never
+ * moves sample data. */
 class MNISTDataSet {
 public:
 
     /* Constructors */
     MNISTDataSet(const std::string& file_path);
+    // Reads IDX image and label files. A non-empty cache_path keeps the packed samples and the
+    // train/test split there and reuses them until either source file changes size or modification time
+    MNISTDataSet(const std::string& images_path, const std::string& labels_path, const std::string& cache_path);
 
     /* Getters */
     int get_train_size() const;
     int get_test_size() const;
+    std::chrono::milliseconds get_load_time() const;
+    bool get_loaded_from_cache() const;
+    size_t get_memory_bytes() const;
     Tensor get_train_data(const int position) const;
     Tensor get_train_label(const int position) const;
     Tensor get_test_data(const int position) const;
     Tensor get_test_label(const int position) const;
+    SampleView get_train_sample(const int position) const;
+    SampleView get_test_sample(const int position) const;
+    // Write into output, reusing its storage when it already has the sample's shape
+    void get_train_data(const int position, Tensor& output) const;
+    void get_train_label(const int position, Tensor& output) const;
+    void get_test_data(const int position, Tensor& output) const;
+    void get_test_label(const int position, Tensor& output) const;
+
+    /* Shuffling */
+    // Reorders the training set, the same seed always gives the same order. Samples that are
+    // near each other in memory are visited in blocks so reads stay local and prefetchable
+    void shuffle(const unsigned seed);
 
 private:
     int train_size_;
     int test_size_;
-    std::vector<Tensor> train_data_;
-    std::vector<Tensor> train_labels_;
-    std::vector<Tensor> test_data_;
-    std::vector<Tensor> test_labels_;
+    std::chrono::milliseconds load_time_;
+    bool loaded_from_cache_;
+    std::vector<uint8_t> samples_;
+    std::vector<int> train_indices_;
+    std::vector<int> test_indices_;
+
+    void load_csv(const std::string& file_path);
+    void load_idx(const std::string& images_path, const std::string& labels_path);
+    void split();
+    bool read_cache(const std::string& cache_path, const std::vector<uint64_t>& sources);
+    void write_cache(const std::string& cache_path, const std::vector<uint64_t>& sources) const;
 };
 
 #endif
\ No newline at end of file
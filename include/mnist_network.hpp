@@ -0,0 +1,9 @@
+#ifndef MNIST_NETWORK_HPP
+#define MNIST_NETWORK_HPP
+
+#include "neural_network.hpp"
+
+/* The convolutional network trained on MNIST by main.cpp, shared by the tools */
+NeuralNetwork create_mnist_network(const double learning_rate);
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef MNIST_RECORD_HPP
+#define MNIST_RECORD_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include "tensor.hpp"
+
+/* In-memory form of one MNIST sample: a label byte followed by the 28x28 pixels as bytes.
+ * Shared by the data set loaders, which only normalize when a record is copied into a tensor. */
+namespace mnist_record {
+    const int image_rows = 28;
+    const int image_columns = 28;
+    const int num_classes = 10;
+    const int num_pixels = image_rows * image_columns;
+    const size_t record_bytes = 1 + num_pixels;
+
+    /* CSV lines */
+    const char* find_line_end(const char* position, const char* end);
+    bool is_blank(const char* begin, const char* end);
+    // Parses one "label,pixel,...,pixel" line into record, line_number only appears in errors
+    void parse_csv_line(const char* begin, const char* end, uint8_t* record, const long line_number);
+
+    /* Conversion, reusing the output's storage when it already has the right shape */
+    void to_data(const uint8_t* record, Tensor& output);
+    void to_label(const uint8_t* record, Tensor& output);
+}
+
+#endif
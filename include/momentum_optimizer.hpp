@@ -0,0 +1,26 @@
+#ifndef MOMENTUM_OPTIMIZER_HPP
+#define MOMENTUM_OPTIMIZER_HPP
+
+#include "optimizer.hpp"
+
+class MomentumOptimizer : public Optimizer {
+public:
+
+    /* Constructors */
+    MomentumOptimizer(const double momentum, const bool nesterov);
+
+protected:
+    void update(double* value,
+                double* gradient,
+                double* const* state,
+                const int size,
+                const double learning_rate,
+                const double gradient_scale,
+                const long step) const override;
+
+private:
+    double momentum_;
+    bool nesterov_;
+};
+
+#endif
@@ -1,10 +1,34 @@
 #ifndef NEURAL_NETWORK_HPP
 #define NEURAL_NETWORK_HPP
 
+#include <cstddef>
 #include <vector>
 #include <memory>
+#include <string>
 #include "tensor.hpp"
 #include "layer.hpp"
+#include "optimizer.hpp"
+#include "allocation_tracker.hpp"
+
+/* Scratch tensors for one inference at a time, reused across calls */
+struct InferenceWorkspace {
+    std::vector<Tensor> activations;
+};
+
+/* Totals for one layer and direction, collected while profiling is enabled */
+struct PassProfile {
+    long calls;
+    double seconds;
+    size_t input_bytes;
+    size_t output_bytes;
+    double flops;
+};
+
+struct LayerProfile {
+    std::string name;
+    PassProfile forward;
+    PassProfile backward;
+};
 
 class NeuralNetwork {
 public:
@@ -12,16 +36,57 @@ public:
     /* Constructors */
     NeuralNetwork();
 
+    /* Getters */
+    int get_num_layers() const;
+    Layer& get_layer(const int index);
+    Optimizer& get_optimizer();
+    std::vector<Parameter> get_parameters();
+    size_t get_peak_activation_bytes() const;
+
     /* Setters */
     void add_layer(std::unique_ptr<Layer> layer);
+    void set_optimizer(std::shared_ptr<Optimizer> optimizer);
+    // Keeps only the input of every segment_size layers during training and recomputes the rest in backward, 0 disables
+    void set_checkpoint_segment_size(const int segment_size);
+    void reset_peak_activation_bytes();
+
+    /* Profiling */
+    // Times every forward and backward call made by train, disabled by default
+    void set_profiling(const bool enabled);
+    bool is_profiling() const;
+    const std::vector<LayerProfile>& get_profile() const;
+    void reset_profile();
+    // A table of the profile with each layer's share of the time and its throughput
+    std::string format_profile() const;
 
     /* Operations */
-    void train(const Tensor& input, const Tensor& expected_output);
-    Tensor predict(const Tensor& input);
+    // Returns the output of the forward pass, from before the update
+    Tensor train(const Tensor& input, const Tensor& expected_output);
+    Tensor predict(const Tensor& input) const;
+    const Tensor& predict(const Tensor& input, InferenceWorkspace& workspace) const;
+
+    /* Replication */
+    NeuralNetwork replicate() const;
 
 private:
     int num_layers_;
     std::vector<std::unique_ptr<Layer>> layers_;
+    std::shared_ptr<Optimizer> optimizer_;
+    // Every layer's parameters and their optimizer states, resolved by the first train and cleared when either changes
+    std::vector<Parameter> parameters_;
+    std::vector<Optimizer::State*> optimizer_states_;
+    int checkpoint_segment_size_;
+    size_t peak_activation_bytes_;
+    bool profiling_;
+    std::vector<LayerProfile> profile_;
+    // Tracer name ids of every layer's forward, backward and infer
+    std::vector<int> trace_names_;
+
+    size_t get_cache_bytes() const;
+    Tensor forward_layer(const int index, const Tensor& input);
+    Tensor backward_layer(const int index, const Tensor& output);
+    void set_allocation_scope(const int layer, const AllocationPass pass) const;
+    Tensor train_with_checkpoints(const Tensor& input, const Tensor& expected_output);
 };
 
 #endif
\ No newline at end of file
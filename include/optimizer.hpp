@@ -0,0 +1,88 @@
+#ifndef OPTIMIZER_HPP
+#define OPTIMIZER_HPP
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+#include "tensor.hpp"
+#include "layer.hpp"
+
+/* Applies accumulated gradients to parameters. Every update is a single fused
+ * pass over each parameter buffer that also clears the gradient. Optimizer
+ * state is kept per parameter tensor, so replicas sharing parameters share it. */
+class Optimizer {
+public:
+
+    /* Constructors */
+    Optimizer(const int num_state_buffers);
+    Optimizer(const Optimizer& other) = delete;
+    Optimizer& operator=(const Optimizer& other) = delete;
+    virtual ~Optimizer() = default;
+
+    /* State of one parameter, step is 0 and buffers empty for a parameter never updated */
+    struct ParameterState {
+        long step;
+        std::vector<std::vector<double>> buffers;
+    };
+
+    /* Live state of one parameter, shared by every replica updating it */
+    struct State {
+        std::atomic<long> step;
+        std::vector<std::vector<double>> buffers;
+    };
+
+    static const int max_state_buffers = 4;
+
+    /* Getters */
+    int get_num_state_buffers() const;
+
+    /* Setters */
+    // The schedule maps the number of updates applied to a parameter to a learning rate multiplier
+    void set_schedule(const std::function<double(const long)>& schedule);
+
+    /* Operations */
+    // Finds or creates the state of each parameter, in the order given. States live as long as
+    // the optimizer, so callers resolve them once and pass them to every step
+    std::vector<State*> get_states(const std::vector<Parameter>& parameters);
+    // Neither allocates nor locks, states holds one state per parameter
+    void step(const std::vector<Parameter>& parameters, State* const* states, const int batch_size);
+    // Resolves the states first
+    void step(const std::vector<Parameter>& parameters, const int batch_size);
+
+    /* Checkpointing */
+    // Copies the state of each parameter, in the order given
+    std::vector<ParameterState> export_state(const std::vector<Parameter>& parameters);
+    void import_state(const std::vector<Parameter>& parameters, const std::vector<ParameterState>& states);
+
+protected:
+
+    /* Fused update of one parameter buffer of the given size */
+    virtual void update(double* value,
+                        double* gradient,
+                        double* const* state,
+                        const int size,
+                        const double learning_rate,
+                        const double gradient_scale,
+                        const long step) const = 0;
+
+private:
+
+    int num_state_buffers_;
+    std::function<double(const long)> schedule_;
+    std::mutex states_mutex_;
+    std::unordered_map<const Tensor*, std::unique_ptr<State>> states_;
+
+    State& get_state(const Tensor& value);
+};
+
+/* Learning rate schedules */
+namespace schedules {
+    std::function<double(const long)> constant();
+    std::function<double(const long)> step_decay(const double factor, const long step_size);
+    std::function<double(const long)> exponential_decay(const double decay_rate, const long decay_steps);
+}
+
+#endif
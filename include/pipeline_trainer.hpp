@@ -0,0 +1,53 @@
+#ifndef PIPELINE_TRAINER_HPP
+#define PIPELINE_TRAINER_HPP
+
+#include <vector>
+#include <memory>
+#include "tensor.hpp"
+#include "neural_network.hpp"
+#include "mnist_data_set.hpp"
+#include "bounded_queue.hpp"
+
+/* GPipe-style pipeline parallelism: consecutive groups of layers run as stages on
+ * their own threads, and micro-batches stream between stages through bounded queues.
+ * Each in-flight micro-batch uses its own replica of the network for the forward
+ * caches, gradients are summed per stage and applied by the network's optimizer once
+ * per mini-batch. */
+class PipelineTrainer {
+public:
+
+    /* Constructors */
+    PipelineTrainer(NeuralNetwork& network, const std::vector<int>& stage_boundaries, const int num_micro_batches);
+
+    /* Getters */
+    int get_num_stages() const;
+    int get_num_micro_batches() const;
+
+    /* Operations */
+    // Trains on the training set from first_sample to its end
+    void train(const MNISTDataSet& data_set, const int first_sample = 0);
+
+private:
+
+    struct Message {
+        int micro_batch;
+        int batch_size;
+        Tensor activation;
+        Tensor label;
+    };
+
+    typedef std::vector<std::unique_ptr<BoundedQueue<Message>>> MessageQueues;
+
+    NeuralNetwork& network_;
+    std::vector<int> stage_boundaries_;
+    int num_stages_;
+    int num_micro_batches_;
+    std::vector<NeuralNetwork> replicas_;
+
+    NeuralNetwork& get_replica(const int micro_batch);
+    Tensor forward_stage(const int stage, const int micro_batch, Tensor activation);
+    Tensor backward_stage(const int stage, const int micro_batch, Tensor gradient);
+    void run_stage(const int stage, MessageQueues& forward_queues, MessageQueues& backward_queues);
+};
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef SAMPLE_VIEW_HPP
+#define SAMPLE_VIEW_HPP
+
+#include <cstdint>
+#include "tensor.hpp"
+
+/* Read-only view of one sample's record inside a data set, valid while the data set is */
+class SampleView {
+public:
+
+    /* Constructors */
+    SampleView(const uint8_t* record);
+
+    /* Getters */
+    int get_label() const;
+    // 28x28 raw pixel values in row major order
+    const uint8_t* get_pixels() const;
+
+    /* Conversion */
+    // Normalize into output, reusing its storage when it already has the sample's shape
+    void copy_data(Tensor& output) const;
+    void copy_label(Tensor& output) const;
+
+private:
+    const uint8_t* record_;
+};
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef SGD_OPTIMIZER_HPP
+#define SGD_OPTIMIZER_HPP
+
+#include "optimizer.hpp"
+
+class SGDOptimizer : public Optimizer {
+public:
+
+    /* Constructors */
+    SGDOptimizer();
+
+protected:
+    void update(double* value,
+                double* gradient,
+                double* const* state,
+                const int size,
+                const double learning_rate,
+                const double gradient_scale,
+                const long step) const override;
+};
+
+#endif
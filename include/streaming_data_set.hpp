@@ -0,0 +1,74 @@
+#ifndef STREAMING_DATA_SET_HPP
+#define STREAMING_DATA_SET_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <thread>
+#include <memory>
+#include <random>
+#include <chrono>
+#include <exception>
+#include "tensor.hpp"
+#include "bounded_queue.hpp"
+
+/* MNIST samples streamed from CSV shards, for data sets larger than memory. A
+ * prefetch thread reads the shards in order into a ring of record blocks while
+ * the consumer trains, and samples are drawn at random from a shuffle buffer
+ * that the stream keeps topped up. Memory use stays within the given budget. */
+class StreamingDataSet {
+public:
+
+    /* Constructors */
+    // The memory budget covers the shuffle buffer, the shard read buffer and at least three blocks of records
+    StreamingDataSet(const std::vector<std::string>& shard_paths,
+                     const size_t memory_budget,
+                     const int shuffle_buffer_size,
+                     const unsigned seed);
+    StreamingDataSet(const StreamingDataSet& other) = delete;
+    StreamingDataSet& operator=(const StreamingDataSet& other) = delete;
+    ~StreamingDataSet();
+
+    /* Getters */
+    int get_num_shards() const;
+    size_t get_buffer_bytes() const;
+    long get_num_samples() const;
+    // Time next spent waiting on the prefetch thread during this pass
+    std::chrono::microseconds get_stall_time() const;
+
+    /* Operations */
+    // Restarts reading from the first shard, each pass shuffles differently
+    void start_pass(const int pass);
+    // Fills the next sample, false once the pass has delivered every sample of every shard
+    bool next(Tensor& data, Tensor& label);
+
+private:
+
+    struct Block {
+        std::vector<uint8_t> records;
+        std::exception_ptr error;
+    };
+
+    std::vector<std::string> shard_paths_;
+    int block_records_;
+    int num_blocks_;
+    int shuffle_buffer_size_;
+    unsigned seed_;
+    std::unique_ptr<BoundedQueue<Block>> blocks_;
+    std::thread prefetcher_;
+    Block current_;
+    size_t current_position_;
+    bool exhausted_;
+    std::vector<uint8_t> shuffle_buffer_;
+    int num_buffered_;
+    std::mt19937 generator_;
+    long num_samples_;
+    std::chrono::microseconds stall_time_;
+
+    void stop();
+    void prefetch(BoundedQueue<Block>& blocks) const;
+    bool pull_record(uint8_t* record);
+};
+
+#endif
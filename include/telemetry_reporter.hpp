@@ -0,0 +1,65 @@
+#ifndef TELEMETRY_REPORTER_HPP
+#define TELEMETRY_REPORTER_HPP
+
+#include <string>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+#include "tensor.hpp"
+
+/* Training progress reported by a background thread. The training loop only
+ * updates atomic counters; every interval the reporter prints the throughput,
+ * running loss, training accuracy and time left in the epoch, and appends the
+ * same values to a JSON lines file if one was given. */
+class TelemetryReporter {
+public:
+
+    /* Constructors */
+    // An empty json_path reports to the console only
+    TelemetryReporter(const std::chrono::milliseconds interval, const std::string& json_path);
+    TelemetryReporter(const TelemetryReporter& other) = delete;
+    TelemetryReporter& operator=(const TelemetryReporter& other) = delete;
+    ~TelemetryReporter();
+
+    /* Getters */
+    int get_num_reports() const;
+
+    /* Operations */
+    // first_sample is where a resumed epoch starts, num_samples the size of the whole epoch or 0 when unknown
+    void start_epoch(const int epoch, const long first_sample, const long num_samples);
+    // Called by the training thread after every sample with the output train returned
+    void record(const Tensor& output, const Tensor& expected_output);
+    // Writes a final report for the epoch and stops reporting until the next one starts
+    void end_epoch();
+
+private:
+    std::chrono::milliseconds interval_;
+    std::ofstream json_;
+    std::atomic<long> samples_;
+    std::atomic<long> correct_;
+    // Only the training thread writes it, so a load and a store need no lock
+    std::atomic<double> loss_sum_;
+    std::atomic<int> num_reports_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stop_;
+    bool active_;
+    int epoch_;
+    long first_sample_;
+    long num_samples_;
+    std::chrono::steady_clock::time_point created_;
+    std::chrono::steady_clock::time_point epoch_start_;
+    std::chrono::steady_clock::time_point last_time_;
+    long last_samples_;
+    double last_loss_sum_;
+    double last_loss_;
+    std::thread thread_;
+
+    void report(const bool final);
+    void run();
+};
+
+#endif
@@ -15,11 +15,13 @@ public:
     Tensor(const Matrix& input_data, const int depth);
     Tensor(const std::vector<Matrix>& input_data);
     Tensor(const Tensor& other);
+    Tensor(Tensor&& other) noexcept = default;
     
     /* Accessors */
     int get_num_rows() const;
     int get_num_columns() const;
     int get_depth() const;
+    int get_size() const;
     Matrix& operator()(const int index);
     const Matrix& operator()(const int index) const;
 
@@ -34,15 +36,19 @@ public:
     Tensor transpose() const;
     Tensor max_pool_forward(const int window_size, const int stride) const;
     Tensor max_pool_backward(const Tensor& output, const int window_size, const int stride) const;
+    void max_pool_forward_into(const int window_size, const int stride, Tensor& result) const;
 
     /* Neural network operations */
     Tensor flatten() const;
 
     /* Other operations */
     Tensor& operator=(const Tensor& other);
+    Tensor& operator=(Tensor&& other) noexcept = default;
     void randomize();
     void randomize(const double mean, const double std_dev);
+    void fill(const double value);
     void reshape(const int depth, const int rows, const int columns);
+    void resize(const int depth, const int rows, const int columns);
     bool operator==(const Tensor& other) const;
     bool operator!=(const Tensor& other) const;
     void append_matrix(const Matrix& input_data);
@@ -0,0 +1,77 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+/* Work-stealing pool used by the layer kernels. Each worker owns a deque of
+ * chunks: it pops work from the back of its own deque and steals from the
+ * front of the others when it runs dry. A thread waiting on a parallel_for
+ * executes chunks itself, so nested calls cannot deadlock. */
+class ThreadPool {
+public:
+
+    /* Constructors */
+    ThreadPool(const int num_threads);
+    ThreadPool(const ThreadPool& other) = delete;
+    ThreadPool& operator=(const ThreadPool& other) = delete;
+    ~ThreadPool();
+
+    /* Global pool, sized by CNN_NUM_THREADS or the number of hardware threads */
+    static ThreadPool& get_global();
+
+    /* Getters */
+    int get_num_threads() const;
+
+    /* Operations */
+    void parallel_for(const int begin, const int end, const int grain_size, const std::function<void(int, int)>& body);
+
+private:
+
+    struct Job;
+
+    struct Task {
+        const std::function<void(int, int)>* body;
+        int begin;
+        int end;
+        Job* job;
+    };
+
+    /* Ring buffer of chunks, which only allocates when it has to grow, so steady
+     * parallel_for calls do not allocate */
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::vector<Task> tasks;
+        size_t head = 0;
+        size_t size = 0;
+
+        bool empty() const;
+        void push_back(const Task& task);
+        Task pop_back();
+        Task pop_front();
+    };
+
+    int num_threads_;
+    std::vector<std::unique_ptr<WorkerQueue>> queues_;
+    std::vector<std::thread> workers_;
+    std::atomic<int> pending_tasks_;
+    std::atomic<unsigned> next_queue_;
+    std::atomic<bool> stop_;
+    std::mutex sleep_mutex_;
+    std::condition_variable sleep_condition_;
+
+    void worker_loop(const int worker_index);
+    bool pop_task(const int worker_index, Task& task);
+    bool steal_task(const int worker_index, Task& task);
+    void run_task(const Task& task);
+};
+
+/* Runs body over [begin, end) in chunks of at least grain_size on the global pool */
+void parallel_for(const int begin, const int end, const int grain_size, const std::function<void(int, int)>& body);
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef TRACER_HPP
+#define TRACER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <map>
+#include <atomic>
+#include <mutex>
+
+/* Timeline of begin/end events in the Chrome trace event format, which Perfetto
+ * and chrome://tracing load. Every thread records into its own ring buffer
+ * without locking, and a full buffer overwrites its oldest events. Sampling
+ * records only one in every sample_interval train or predict calls, counted
+ * separately by every thread that makes them. Threads that never make them,
+ * such as data workers, record while the latest call of any thread is sampled.
+ * The buffer of a thread that exits is reused by the next thread that records,
+ * which gets a new thread id. */
+class Tracer {
+public:
+
+    Tracer(const Tracer& other) = delete;
+    Tracer& operator=(const Tracer& other) = delete;
+
+    /* Global tracer, never destroyed so threads can record until the process exits */
+    static Tracer& get_global();
+
+    /* Tracing */
+    // events_per_thread bounds the memory of every thread's ring buffer
+    void enable(const size_t events_per_thread, const long sample_interval);
+    void disable();
+    bool is_recording() const;
+    // Called at the start of every train and predict call to decide whether the calling thread samples it
+    void next_sample();
+
+    /* Events */
+    // Returns a stable id for a name, call once and keep the id for the hot path
+    int intern(const std::string& name, const std::string& category);
+    void record(const int name_id, const int64_t begin_ns, const int64_t end_ns);
+    static int64_t now_ns();
+
+    /* Output */
+    // Call once the traced work has finished, events recorded during the write may be torn
+    void write(const std::string& path) const;
+    size_t get_num_events() const;
+
+private:
+
+    struct Event {
+        int name_id;
+        // Kept per event, since a reused buffer still holds events of its previous thread
+        int thread_id;
+        int64_t begin_ns;
+        int64_t end_ns;
+    };
+
+    struct ThreadBuffer {
+        int thread_id;
+        std::vector<Event> events;
+        std::atomic<size_t> head;
+    };
+
+    std::atomic<bool> enabled_;
+    // Decision of the latest sampled call, for threads that make none
+    std::atomic<bool> recording_;
+    // Incremented by enable, so every thread restarts its sample count
+    std::atomic<long> generation_;
+    std::atomic<size_t> events_per_thread_;
+    std::atomic<long> sample_interval_;
+    int64_t origin_ns_;
+    mutable std::mutex mutex_;
+    int next_thread_id_;
+    std::deque<std::unique_ptr<ThreadBuffer>> buffers_;
+    std::vector<ThreadBuffer*> free_buffers_;
+    std::deque<std::pair<std::string, std::string>> names_;
+    std::map<std::pair<std::string, std::string>, int> name_ids_;
+
+    Tracer();
+    ThreadBuffer& get_thread_buffer();
+};
+
+/* Records the lifetime of the scope as one event when the tracer is recording */
+class TraceScope {
+public:
+
+    TraceScope(const int name_id):
+        name_id_(name_id),
+        begin_ns_(Tracer::get_global().is_recording() ? Tracer::now_ns() : -1) {}
+
+    TraceScope(const TraceScope& other) = delete;
+    TraceScope& operator=(const TraceScope& other) = delete;
+
+    ~TraceScope() {
+        if (begin_ns_ >= 0) {
+            Tracer::get_global().record(name_id_, begin_ns_, Tracer::now_ns());
+        }
+    }
+
+private:
+    int name_id_;
+    int64_t begin_ns_;
+};
+
+#endif
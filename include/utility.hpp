@@ -2,13 +2,21 @@
 #define UTILITY_HPP
 
 #include <string>
+#include <vector>
+#include <random>
 #include "tensor.hpp"
 
 namespace utility {
     bool compare_ignore_case(std::string s1, std::string s2);
     int argmax(const Tensor& input);
+    // Cross entropy of the output for the class expected_output labels one-hot, clamped to stay finite
+    double cross_entropy(const Tensor& output, const Tensor& expected_output);
     int convolve_result_dim(const int dim, const int filter_dim, const int stride, const std::string& padding_type);
     int max_pool_result_dim(const int dim, const int window_size, const int stride);
+    double percentile(std::vector<double> values, const double fraction);
+    // The calling thread's engine behind Matrix::randomize, seeded from std::random_device unless seed_random is called
+    std::default_random_engine& random_engine();
+    void seed_random(const unsigned seed);
 }
 
 #endif
\ No newline at end of file
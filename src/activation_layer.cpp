@@ -2,9 +2,14 @@
 #include <stdexcept>
 #include <cmath>
 #include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <vector>
 #include "activation_layer.hpp"
 #include "tensor.hpp"
 #include "utility.hpp"
+#include "thread_pool.hpp"
+#include "kernels.hpp"
 
 /******************************************************
  * Constructors
@@ -28,112 +33,170 @@ ActivationLayer::ActivationLayer(const std::string& activation_function_name) {
 Tensor ActivationLayer::forward(const Tensor& input) {
     input_ = input;
 
+    Tensor output;
+    infer(input, output);
+    return output;
+}
+
+Tensor ActivationLayer::backward(const Tensor& output) {
     if (utility::compare_ignore_case(activation_function_name_, "sigmoid")) {
-        return sigmoid(input);
+        return output.element_wise_multiply(sigmoid_derivative(input_));
     }
     else if (utility::compare_ignore_case(activation_function_name_, "relu")) {
-        return relu(input);
+        return output.element_wise_multiply(relu_derivative(input_));
     }
     else {
-        return softmax(input);
+        return output.element_wise_multiply(softmax_derivative(input_));
     }
 }
 
-Tensor ActivationLayer::backward(const Tensor& output) {
+/******************************************************
+ * Parameters
+ *****************************************************/
+
+std::vector<Parameter> ActivationLayer::get_parameters() {
+    return std::vector<Parameter>();
+}
+
+void ActivationLayer::infer(const Tensor& input, Tensor& output) const {
+    if (input.get_depth() <= 0) {
+        output = Tensor();
+        return;
+    }
+
+    output.resize(input.get_depth(), input.get_num_rows(), input.get_num_columns());
+
     if (utility::compare_ignore_case(activation_function_name_, "sigmoid")) {
-        return output.element_wise_multiply(sigmoid_derivative(input_));
+        sigmoid(input, output);
     }
     else if (utility::compare_ignore_case(activation_function_name_, "relu")) {
-        return output.element_wise_multiply(relu_derivative(input_));
+        relu(input, output);
     }
     else {
-        return output.element_wise_multiply(softmax_derivative(input_));
+        softmax(input, output);
     }
 }
 
 /******************************************************
- * Activation functions
+ * Forward caches
  *****************************************************/
 
-Tensor ActivationLayer::sigmoid(const Tensor& in) const {
-    Tensor result (in.get_depth(), in.get_num_rows(), in.get_num_columns());
+void ActivationLayer::clear_cache() {
+    input_ = Tensor();
+}
 
-    for (int i = 0; i < in.get_depth(); ++i) {
-        for (int j = 0; j < in.get_num_rows(); ++j) {
-            for (int k = 0; k < in.get_num_columns(); ++k) {
-                double sigmoid = 1.0 / (1 + std::exp(-in(i)(j, k)));
-                result(i)(j, k) = sigmoid;
-            }
-        }
+size_t ActivationLayer::get_cache_bytes() const {
+    return input_.get_size() * sizeof(double);
+}
+
+/******************************************************
+ * Replication
+ *****************************************************/
+
+std::unique_ptr<Layer> ActivationLayer::replicate() const {
+    return std::unique_ptr<Layer>(new ActivationLayer(activation_function_name_));
+}
+
+/******************************************************
+ * Serialization
+ *****************************************************/
+
+std::string ActivationLayer::get_name() const {
+    return "activation";
+}
+
+std::vector<double> ActivationLayer::get_config() const {
+    /* The function is stored as a code: 0 sigmoid, 1 relu, 2 softmax */
+    if (utility::compare_ignore_case(activation_function_name_, "sigmoid")) {
+        return {0.0};
     }
-    
-    return result;
+    if (utility::compare_ignore_case(activation_function_name_, "relu")) {
+        return {1.0};
+    }
+    return {2.0};
 }
 
-Tensor ActivationLayer::sigmoid_derivative(const Tensor& in) const {
-    Tensor result (in.get_depth(), in.get_num_rows(), in.get_num_columns());
+/******************************************************
+ * Profiling
+ *****************************************************/
 
-    for (int i = 0; i < in.get_depth(); ++i) {
-        for (int j = 0; j < in.get_num_rows(); ++j) {
-            for (int k = 0; k < in.get_num_columns(); ++k) {
-                double sigmoid = 1.0 / (1 + std::exp(-in(i)(j, k)));
-                double sigmoid_derivative = sigmoid * (1 - sigmoid);
-                result(i)(j, k) = sigmoid_derivative;
-            }
-        }
+double ActivationLayer::get_forward_flops(const Tensor& input) const {
+    /* Rough per element costs counting exp as one operation */
+    if (utility::compare_ignore_case(activation_function_name_, "relu")) {
+        return input.get_size();
     }
-    
-    return result;
+    return 4.0 * input.get_size();
 }
 
-Tensor ActivationLayer::relu(const Tensor& in) const {
+double ActivationLayer::get_backward_flops(const Tensor& input) const {
+    /* The derivative and the multiply with the incoming gradient */
+    return get_forward_flops(input) + input.get_size();
+}
+
+/******************************************************
+ * Activation functions
+ *****************************************************/
+
+void ActivationLayer::sigmoid(const Tensor& in, Tensor& out) const {
+    parallel_for(0, in.get_depth(), 1, [&](const int begin, const int end) {
+        for (int i = begin; i < end; ++i) {
+            kernels::sigmoid(in(i).get_data(), out(i).get_data(), in(i).get_size());
+        }
+    });
+}
+
+Tensor ActivationLayer::sigmoid_derivative(const Tensor& in) const {
     Tensor result (in.get_depth(), in.get_num_rows(), in.get_num_columns());
 
-    for (int i = 0; i < in.get_depth(); ++i) {
-        for (int j = 0; j < in.get_num_rows(); ++j) {
-            for (int k = 0; k < in.get_num_columns(); ++k) {
-                result(i)(j, k) = std::max(0.0, in(i)(j, k));
-            }
+    parallel_for(0, in.get_depth(), 1, [&](const int begin, const int end) {
+        for (int i = begin; i < end; ++i) {
+            kernels::sigmoid_derivative(in(i).get_data(), result(i).get_data(), in(i).get_size());
         }
-    }
+    });
     
     return result;
 }
 
+void ActivationLayer::relu(const Tensor& in, Tensor& out) const {
+    parallel_for(0, in.get_depth(), 1, [&](const int begin, const int end) {
+        for (int i = begin; i < end; ++i) {
+            kernels::relu(in(i).get_data(), out(i).get_data(), in(i).get_size());
+        }
+    });
+}
+
 Tensor ActivationLayer::relu_derivative(const Tensor& in) const {
     Tensor result (in.get_depth(), in.get_num_rows(), in.get_num_columns());
 
-    for (int i = 0; i < in.get_depth(); ++i) {
-        for (int j = 0; j < in.get_num_rows(); ++j) {
-            for (int k = 0; k < in.get_num_columns(); ++k) {
-                if (in(i)(j, k) <= 0.0) {
-                    result(i)(j, k) = 0.0;
-                }
-                else {
-                    result(i)(j, k) = 1.0;
-                }
-            }
+    parallel_for(0, in.get_depth(), 1, [&](const int begin, const int end) {
+        for (int i = begin; i < end; ++i) {
+            kernels::relu_derivative(in(i).get_data(), result(i).get_data(), in(i).get_size());
         }
-    }
+    });
     
     return result;
 }
 
-Tensor ActivationLayer::softmax(const Tensor& in) const {
+void ActivationLayer::softmax(const Tensor& in, Tensor& out) const {
     double sum = 0.0;
-    Tensor result (in.get_depth(), in.get_num_rows(), in.get_num_columns());
 
     for (int i = 0; i < in.get_depth(); ++i) {
         for (int j = 0; j < in.get_num_rows(); ++j) {
             for (int k = 0; k < in.get_num_columns(); ++k) {
                 double exponent = std::exp(in(i)(j, k));
-                result(i)(j, k) = exponent;
+                out(i)(j, k) = exponent;
                 sum += exponent;
             }
         }
     }
-    
-    return result.scalar_multiply(1.0 / sum);
+
+    for (int i = 0; i < in.get_depth(); ++i) {
+        for (int j = 0; j < in.get_num_rows(); ++j) {
+            for (int k = 0; k < in.get_num_columns(); ++k) {
+                out(i)(j, k) *= 1.0 / sum;
+            }
+        }
+    }
 }
 
 Tensor ActivationLayer::softmax_derivative(const Tensor& in) const {
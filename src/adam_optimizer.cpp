@@ -0,0 +1,53 @@
+#include <stdexcept>
+#include <cmath>
+#include "adam_optimizer.hpp"
+#include "optimizer.hpp"
+
+/******************************************************
+ * Constructors
+ *****************************************************/
+
+AdamOptimizer::AdamOptimizer(): AdamOptimizer(0.9, 0.999, 1e-8) {}
+
+AdamOptimizer::AdamOptimizer(const double beta1, const double beta2, const double epsilon):
+    Optimizer(2),
+    beta1_(beta1),
+    beta2_(beta2),
+    epsilon_(epsilon) {
+
+    if (beta1 < 0.0 || beta1 >= 1.0 || beta2 < 0.0 || beta2 >= 1.0) {
+        throw std::invalid_argument("AdamOptimizer constructor: beta1 and beta2 must be in [0, 1)");
+    }
+    if (epsilon <= 0.0) {
+        throw std::invalid_argument("AdamOptimizer constructor: epsilon must be greater than 0");
+    }
+}
+
+/******************************************************
+ * Update
+ *****************************************************/
+
+void AdamOptimizer::update(double* value,
+                           double* gradient,
+                           double* const* state,
+                           const int size,
+                           const double learning_rate,
+                           const double gradient_scale,
+                           const long step) const {
+    double* first_moment = state[0];
+    double* second_moment = state[1];
+
+    /* Bias correction is folded into the step size */
+    const double correction1 = 1.0 - std::pow(beta1_, static_cast<double>(step));
+    const double correction2 = 1.0 - std::pow(beta2_, static_cast<double>(step));
+    const double step_size = learning_rate * std::sqrt(correction2) / correction1;
+    const double epsilon = epsilon_ * std::sqrt(correction2);
+
+    for (int i = 0; i < size; ++i) {
+        const double g = gradient[i] * gradient_scale;
+        first_moment[i] = beta1_ * first_moment[i] + (1.0 - beta1_) * g;
+        second_moment[i] = beta2_ * second_moment[i] + (1.0 - beta2_) * g * g;
+        value[i] -= step_size * first_moment[i] / (std::sqrt(second_moment[i]) + epsilon);
+        gradient[i] = 0.0;
+    }
+}
@@ -0,0 +1,307 @@
+#include <cstddef>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <stdexcept>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include "allocation_tracker.hpp"
+
+namespace {
+    const char* pass_names[num_allocation_passes] = {"forward", "backward", "update", "other"};
+}
+
+/* Written by its own thread and drained by whichever thread merges the report */
+struct AllocationTracker::ThreadCounters {
+    const int generation;
+    std::vector<std::atomic<long>> allocations;
+    std::vector<std::atomic<size_t>> bytes;
+    std::atomic<long> frees;
+    // Signed, since a thread can free storage another thread allocated
+    std::atomic<long long> live_bytes;
+    std::atomic<long long> peak_live_bytes;
+    // Only used under the tracker's mutex
+    long long step_start_live_bytes;
+
+    ThreadCounters(const int generation, const size_t num_scopes):
+        generation(generation),
+        allocations(num_scopes),
+        bytes(num_scopes),
+        frees(0),
+        live_bytes(0),
+        peak_live_bytes(0),
+        step_start_live_bytes(0) {}
+};
+
+/******************************************************
+ * Constructors
+ *****************************************************/
+
+AllocationTracker::AllocationTracker():
+    enabled_(false),
+    generation_(0),
+    scope_(static_cast<int>(AllocationPass::other)),
+    report_(),
+    in_step_(false),
+    step_start_live_bytes_(0) {}
+
+AllocationTracker& AllocationTracker::get_global() {
+    static AllocationTracker* tracker = new AllocationTracker();
+    return *tracker;
+}
+
+/******************************************************
+ * Tracking
+ *****************************************************/
+
+void AllocationTracker::enable(const int num_layers) {
+    if (num_layers < 0) {
+        throw std::invalid_argument("AllocationTracker enable: num_layers cannot be negative");
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    report_ = AllocationReport();
+    report_.num_layers = num_layers;
+    report_.scopes.assign((num_layers + 1) * num_allocation_passes, {0, 0});
+    scope_.store(static_cast<int>(AllocationPass::other), std::memory_order_relaxed);
+    in_step_ = false;
+
+    /* Counters of an earlier generation are kept, a thread may still be writing to them */
+    generation_.fetch_add(1, std::memory_order_relaxed);
+    enabled_.store(true, std::memory_order_relaxed);
+}
+
+void AllocationTracker::disable() {
+    enabled_.store(false, std::memory_order_relaxed);
+}
+
+bool AllocationTracker::is_enabled() const {
+    return enabled_.load(std::memory_order_relaxed);
+}
+
+void AllocationTracker::set_scope(const int layer, const AllocationPass pass) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (layer < -1 || layer >= report_.num_layers) {
+        throw std::invalid_argument("AllocationTracker set_scope: layer out of bounds");
+    }
+
+    scope_.store((layer + 1) * num_allocation_passes + static_cast<int>(pass), std::memory_order_relaxed);
+}
+
+void AllocationTracker::begin_step() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    in_step_ = true;
+    scope_.store(static_cast<int>(AllocationPass::other), std::memory_order_relaxed);
+
+    long allocations = 0;
+    size_t bytes = 0;
+    merge_thread_counters(allocations, bytes);
+
+    step_start_live_bytes_ = 0;
+    const int generation = generation_.load(std::memory_order_relaxed);
+    for (const std::unique_ptr<ThreadCounters>& counters : thread_counters_) {
+        if (counters->generation == generation) {
+            counters->step_start_live_bytes = counters->live_bytes.load(std::memory_order_relaxed);
+            counters->peak_live_bytes.store(counters->step_start_live_bytes, std::memory_order_relaxed);
+            step_start_live_bytes_ += counters->step_start_live_bytes;
+        }
+    }
+}
+
+void AllocationTracker::end_step() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!in_step_) {
+        return;
+    }
+
+    long allocations = 0;
+    size_t bytes = 0;
+    merge_thread_counters(allocations, bytes);
+
+    long long growth = 0;
+    const int generation = generation_.load(std::memory_order_relaxed);
+    for (const std::unique_ptr<ThreadCounters>& counters : thread_counters_) {
+        if (counters->generation == generation) {
+            growth += std::max(0LL, counters->peak_live_bytes.load(std::memory_order_relaxed) - counters->step_start_live_bytes);
+            counters->step_start_live_bytes = 0;
+        }
+    }
+
+    ++report_.steps;
+    report_.step_allocations += allocations;
+    report_.step_bytes += bytes;
+    report_.max_step_allocations = std::max(report_.max_step_allocations, allocations);
+    report_.max_step_bytes = std::max(report_.max_step_bytes, bytes);
+    report_.max_step_growth_bytes = std::max(report_.max_step_growth_bytes, static_cast<size_t>(growth));
+    report_.peak_live_bytes = std::max(report_.peak_live_bytes,
+                                       static_cast<size_t>(std::max(0LL, step_start_live_bytes_ + growth)));
+
+    in_step_ = false;
+    scope_.store(static_cast<int>(AllocationPass::other), std::memory_order_relaxed);
+}
+
+AllocationTracker::ThreadCounters& AllocationTracker::get_thread_counters() {
+    thread_local ThreadCounters* counters = nullptr;
+
+    if (counters == nullptr || counters->generation != generation_.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        thread_counters_.push_back(std::make_unique<ThreadCounters>(generation_.load(std::memory_order_relaxed),
+                                                                    report_.scopes.size()));
+        counters = thread_counters_.back().get();
+    }
+    return *counters;
+}
+
+void AllocationTracker::merge_thread_counters(long& allocations, size_t& bytes) {
+    const int generation = generation_.load(std::memory_order_relaxed);
+    for (const std::unique_ptr<ThreadCounters>& counters : thread_counters_) {
+        if (counters->generation != generation) {
+            continue;
+        }
+
+        for (size_t scope = 0; scope < counters->allocations.size(); ++scope) {
+            const long scope_allocations = counters->allocations[scope].exchange(0, std::memory_order_relaxed);
+            const size_t scope_bytes = counters->bytes[scope].exchange(0, std::memory_order_relaxed);
+            report_.scopes[scope].allocations += scope_allocations;
+            report_.scopes[scope].bytes += scope_bytes;
+            allocations += scope_allocations;
+            bytes += scope_bytes;
+        }
+        report_.frees += counters->frees.exchange(0, std::memory_order_relaxed);
+    }
+}
+
+long long AllocationTracker::get_thread_live_bytes() const {
+    long long live_bytes = 0;
+    const int generation = generation_.load(std::memory_order_relaxed);
+    for (const std::unique_ptr<ThreadCounters>& counters : thread_counters_) {
+        if (counters->generation == generation) {
+            live_bytes += counters->live_bytes.load(std::memory_order_relaxed);
+        }
+    }
+    return live_bytes;
+}
+
+/******************************************************
+ * Accounting
+ *****************************************************/
+
+void AllocationTracker::record_allocation(const size_t bytes) {
+    if (!enabled_.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    /* Only this thread writes its counters, so the atomics stay in its own cache */
+    ThreadCounters& counters = get_thread_counters();
+    const size_t scope = static_cast<size_t>(scope_.load(std::memory_order_relaxed));
+    if (scope < counters.allocations.size()) {
+        counters.allocations[scope].fetch_add(1, std::memory_order_relaxed);
+        counters.bytes[scope].fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    const long long live_bytes = counters.live_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    if (live_bytes > counters.peak_live_bytes.load(std::memory_order_relaxed)) {
+        counters.peak_live_bytes.store(live_bytes, std::memory_order_relaxed);
+    }
+}
+
+void AllocationTracker::record_free(const size_t bytes) {
+    if (!enabled_.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    ThreadCounters& counters = get_thread_counters();
+    counters.frees.fetch_add(1, std::memory_order_relaxed);
+    counters.live_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+/******************************************************
+ * Reports
+ *****************************************************/
+
+size_t AllocationTracker::get_live_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<size_t>(std::max(0LL, get_thread_live_bytes()));
+}
+
+AllocationReport AllocationTracker::get_report() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    AllocationReport report = report_;
+
+    /* Counts made since the last merge are added without draining them */
+    const int generation = generation_.load(std::memory_order_relaxed);
+    for (const std::unique_ptr<ThreadCounters>& counters : thread_counters_) {
+        if (counters->generation != generation) {
+            continue;
+        }
+
+        for (size_t scope = 0; scope < counters->allocations.size(); ++scope) {
+            report.scopes[scope].allocations += counters->allocations[scope].load(std::memory_order_relaxed);
+            report.scopes[scope].bytes += counters->bytes[scope].load(std::memory_order_relaxed);
+        }
+        report.frees += counters->frees.load(std::memory_order_relaxed);
+    }
+    report.peak_live_bytes = std::max(report.peak_live_bytes,
+                                      static_cast<size_t>(std::max(0LL, get_thread_live_bytes())));
+    return report;
+}
+
+void AllocationTracker::reset_report() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    long allocations = 0;
+    size_t bytes = 0;
+    merge_thread_counters(allocations, bytes);
+
+    const int num_layers = report_.num_layers;
+    const size_t num_scopes = report_.scopes.size();
+
+    report_ = AllocationReport();
+    report_.num_layers = num_layers;
+    report_.scopes.assign(num_scopes, {0, 0});
+    report_.peak_live_bytes = static_cast<size_t>(std::max(0LL, get_thread_live_bytes()));
+}
+
+std::string AllocationTracker::format_report(const std::vector<std::string>& layer_names) const {
+    const AllocationReport report = get_report();
+    const double steps = report.steps > 0 ? static_cast<double>(report.steps) : 1.0;
+
+    long allocations = 0;
+    size_t bytes = 0;
+    for (const AllocationCounters& counters : report.scopes) {
+        allocations += counters.allocations;
+        bytes += counters.bytes;
+    }
+
+    std::ostringstream table;
+    table << std::fixed << std::setprecision(1);
+    table << "Allocations: " << allocations << " (" << bytes / (1024.0 * 1024.0) << "MB), frees: " << report.frees
+          << ", peak live: " << report.peak_live_bytes / 1024.0 << "KB\n";
+    table << "Per step: " << report.step_allocations / steps << " allocations (max " << report.max_step_allocations << "), "
+          << report.step_bytes / steps / 1024.0 << "KB (max " << report.max_step_bytes / 1024.0 << "KB), "
+          << "live growth max " << report.max_step_growth_bytes / 1024.0 << "KB over " << report.steps << " steps\n";
+
+    table << std::left << std::setw(20) << "layer" << std::setw(10) << "pass" << std::right
+          << std::setw(14) << "allocations" << std::setw(12) << "per step" << std::setw(14) << "KB per step" << "\n";
+
+    for (size_t scope = 0; scope < report.scopes.size(); ++scope) {
+        const AllocationCounters& counters = report.scopes[scope];
+        if (counters.allocations == 0) {
+            continue;
+        }
+
+        const int layer = static_cast<int>(scope / num_allocation_passes) - 1;
+        std::string name = "network";
+        if (layer >= 0) {
+            name = layer < static_cast<int>(layer_names.size()) ? layer_names[layer] : std::to_string(layer);
+        }
+
+        table << std::left << std::setw(20) << name << std::setw(10) << pass_names[scope % num_allocation_passes]
+              << std::right << std::setw(14) << counters.allocations << std::setw(12) << counters.allocations / steps
+              << std::setw(14) << counters.bytes / steps / 1024.0 << "\n";
+    }
+
+    return table.str();
+}
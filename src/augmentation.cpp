@@ -0,0 +1,124 @@
+#include <cmath>
+#include <vector>
+#include <random>
+#include <stdexcept>
+#include "augmentation.hpp"
+#include "tensor.hpp"
+
+namespace {
+    const double pi = 3.14159265358979323846;
+
+    /* Separable Gaussian blur of a rows x columns field, zero outside the field */
+    void gaussian_blur(std::vector<double>& field, const int rows, const int columns, const double sigma) {
+        const int radius = std::max(1, static_cast<int>(std::ceil(2 * sigma)));
+        std::vector<double> kernel(2 * radius + 1);
+        double sum = 0.0;
+        for (int i = -radius; i <= radius; ++i) {
+            kernel[i + radius] = std::exp(-(i * i) / (2 * sigma * sigma));
+            sum += kernel[i + radius];
+        }
+        for (double& weight : kernel) {
+            weight /= sum;
+        }
+
+        std::vector<double> blurred(field.size(), 0.0);
+        for (int r = 0; r < rows; ++r) {
+            for (int c = 0; c < columns; ++c) {
+                double value = 0.0;
+                for (int k = -radius; k <= radius; ++k) {
+                    if (c + k >= 0 && c + k < columns) {
+                        value += kernel[k + radius] * field[r * columns + c + k];
+                    }
+                }
+                blurred[r * columns + c] = value;
+            }
+        }
+        for (int r = 0; r < rows; ++r) {
+            for (int c = 0; c < columns; ++c) {
+                double value = 0.0;
+                for (int k = -radius; k <= radius; ++k) {
+                    if (r + k >= 0 && r + k < rows) {
+                        value += kernel[k + radius] * blurred[(r + k) * columns + c];
+                    }
+                }
+                field[r * columns + c] = value;
+            }
+        }
+    }
+
+    double sample(const Matrix& image, const double row, const double column) {
+        const int row0 = static_cast<int>(std::floor(row));
+        const int column0 = static_cast<int>(std::floor(column));
+        const double row_weight = row - row0;
+        const double column_weight = column - column0;
+
+        auto pixel = [&image](const int r, const int c) {
+            return r >= 0 && r < image.get_num_rows() && c >= 0 && c < image.get_num_columns() ? image(r, c) : 0.0;
+        };
+
+        return (1 - row_weight) * ((1 - column_weight) * pixel(row0, column0) + column_weight * pixel(row0, column0 + 1)) +
+               row_weight * ((1 - column_weight) * pixel(row0 + 1, column0) + column_weight * pixel(row0 + 1, column0 + 1));
+    }
+}
+
+augmentation::Options augmentation::default_options() {
+    Options options;
+    options.max_shift = 2.0;
+    options.max_rotation_degrees = 10.0;
+    options.elastic_alpha = 8.0;
+    options.elastic_sigma = 3.0;
+    return options;
+}
+
+void augmentation::augment(const Tensor& input, Tensor& output, const Options& options, std::mt19937& generator) {
+    if (input.get_depth() != 1) {
+        throw std::invalid_argument("Augment: input must have depth 1");
+    }
+    if (&input == &output) {
+        throw std::invalid_argument("Augment: output cannot alias the input");
+    }
+
+    const int rows = input.get_num_rows();
+    const int columns = input.get_num_columns();
+    std::uniform_real_distribution<double> unit(-1.0, 1.0);
+
+    const double angle = unit(generator) * options.max_rotation_degrees * pi / 180.0;
+    const double shift_rows = unit(generator) * options.max_shift;
+    const double shift_columns = unit(generator) * options.max_shift;
+
+    std::vector<double> displacement_rows;
+    std::vector<double> displacement_columns;
+    if (options.elastic_alpha > 0.0) {
+        displacement_rows.resize(rows * columns);
+        displacement_columns.resize(rows * columns);
+        for (int i = 0; i < rows * columns; ++i) {
+            displacement_rows[i] = unit(generator);
+            displacement_columns[i] = unit(generator);
+        }
+        gaussian_blur(displacement_rows, rows, columns, options.elastic_sigma);
+        gaussian_blur(displacement_columns, rows, columns, options.elastic_sigma);
+    }
+
+    /* Map every output pixel back to the input: undo the shift, rotate about the centre, then displace */
+    const double centre_row = (rows - 1) / 2.0;
+    const double centre_column = (columns - 1) / 2.0;
+    const double cosine = std::cos(angle);
+    const double sine = std::sin(angle);
+
+    output.resize(1, rows, columns);
+    for (int r = 0; r < rows; ++r) {
+        for (int c = 0; c < columns; ++c) {
+            const double y = r - shift_rows - centre_row;
+            const double x = c - shift_columns - centre_column;
+            double source_row = cosine * y - sine * x + centre_row;
+            double source_column = sine * y + cosine * x + centre_column;
+
+            if (!displacement_rows.empty()) {
+                source_row += options.elastic_alpha * displacement_rows[r * columns + c];
+                source_column += options.elastic_alpha * displacement_columns[r * columns + c];
+            }
+
+            output(0)(r, c) = sample(input(0), source_row, source_column);
+        }
+    }
+}
@@ -0,0 +1,181 @@
+#include <vector>
+#include <thread>
+#include <memory>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include "augmentation_pipeline.hpp"
+#include "augmentation.hpp"
+#include "mnist_data_set.hpp"
+#include "bounded_queue.hpp"
+#include "tensor.hpp"
+#include "tracer.hpp"
+
+/******************************************************
+ * Constructors
+ *****************************************************/
+
+AugmentationPipeline::AugmentationPipeline(const MNISTDataSet& data_set,
+                                           const augmentation::Options& options,
+                                           const int num_workers,
+                                           const int batch_size,
+                                           const int queue_capacity,
+                                           const unsigned seed):
+    data_set_(data_set),
+    options_(options),
+    num_workers_(num_workers),
+    batch_size_(batch_size),
+    queue_capacity_(queue_capacity),
+    seed_(seed),
+    next_batch_(0),
+    num_batches_(0),
+    num_starved_(0),
+    starved_time_(0) {
+
+    if (num_workers <= 0) {
+        throw std::invalid_argument("AugmentationPipeline constructor: num_workers must be greater than 0");
+    }
+    if (batch_size <= 0) {
+        throw std::invalid_argument("AugmentationPipeline constructor: batch_size must be greater than 0");
+    }
+    if (queue_capacity <= 0) {
+        throw std::invalid_argument("AugmentationPipeline constructor: queue_capacity must be greater than 0");
+    }
+}
+
+AugmentationPipeline::~AugmentationPipeline() {
+    stop();
+}
+
+/******************************************************
+ * Getters
+ *****************************************************/
+
+int AugmentationPipeline::get_num_workers() const {
+    return num_workers_;
+}
+
+long AugmentationPipeline::get_num_batches() const {
+    return num_batches_;
+}
+
+long AugmentationPipeline::get_num_starved() const {
+    return num_starved_;
+}
+
+std::chrono::microseconds AugmentationPipeline::get_starved_time() const {
+    return starved_time_;
+}
+
+/******************************************************
+ * Operations
+ *****************************************************/
+
+void AugmentationPipeline::start_epoch(const int epoch, const int first_position) {
+    stop();
+
+    /* The queue capacity is shared out between the workers */
+    const int capacity = std::max(1, (queue_capacity_ + num_workers_ - 1) / num_workers_);
+    queues_.clear();
+    for (int i = 0; i < num_workers_; ++i) {
+        queues_.push_back(std::make_unique<BoundedQueue<Message>>(capacity));
+    }
+
+    next_batch_ = 0;
+    num_batches_ = 0;
+    num_starved_ = 0;
+    starved_time_ = std::chrono::microseconds(0);
+
+    for (int i = 0; i < num_workers_; ++i) {
+        workers_.emplace_back(&AugmentationPipeline::work, this, i, epoch, first_position);
+    }
+}
+
+bool AugmentationPipeline::next(Batch& batch) {
+    if (queues_.empty()) {
+        return false;
+    }
+
+    BoundedQueue<Message>& queue = *queues_[next_batch_ % num_workers_];
+    Message message;
+
+    if (!queue.try_pop(message)) {
+        static const int wait_trace = Tracer::get_global().intern("wait for augmentation", "data");
+        TraceScope trace(wait_trace);
+
+        ++num_starved_;
+        auto wait_start = std::chrono::steady_clock::now();
+        const bool received = queue.pop(message);
+        starved_time_ += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - wait_start);
+
+        if (!received) {
+            return false;
+        }
+    }
+
+    if (message.error) {
+        std::rethrow_exception(message.error);
+    }
+
+    batch = std::move(message.batch);
+    ++next_batch_;
+    ++num_batches_;
+    return true;
+}
+
+void AugmentationPipeline::stop() {
+    for (std::unique_ptr<BoundedQueue<Message>>& queue : queues_) {
+        queue->close();
+    }
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+}
+
+void AugmentationPipeline::work(const int worker, const int epoch, const int first_position) {
+    BoundedQueue<Message>& queue = *queues_[worker];
+    const int train_size = data_set_.get_train_size();
+    Tensor input;
+
+    try {
+        for (long batch_index = worker; ; batch_index += num_workers_) {
+            const long begin = first_position + batch_index * batch_size_;
+            if (begin >= train_size) {
+                break;
+            }
+            const long end = std::min<long>(begin + batch_size_, train_size);
+
+            Message message;
+            message.batch.data.resize(end - begin);
+            message.batch.labels.resize(end - begin);
+
+            {
+                static const int augment_trace = Tracer::get_global().intern("augment batch", "data");
+                TraceScope trace(augment_trace);
+
+                for (long position = begin; position < end; ++position) {
+                    std::seed_seq seed {seed_, static_cast<unsigned>(epoch), static_cast<unsigned>(position)};
+                    std::mt19937 generator(seed);
+
+                    data_set_.get_train_data(position, input);
+                    augmentation::augment(input, message.batch.data[position - begin], options_, generator);
+                    data_set_.get_train_label(position, message.batch.labels[position - begin]);
+                }
+            }
+
+            if (!queue.push(std::move(message))) {
+                return;
+            }
+        }
+    }
+    catch (...) {
+        Message message;
+        message.error = std::current_exception();
+        queue.push(std::move(message));
+    }
+
+    queue.close();
+}
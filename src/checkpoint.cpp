@@ -0,0 +1,463 @@
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <stdexcept>
+#include <cerrno>
+#include <cstdio>
+#include <cmath>
+#include <limits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "checkpoint.hpp"
+#include "optimizer.hpp"
+#include "neural_network.hpp"
+#include "layer.hpp"
+#include "tensor.hpp"
+#include "matrix.hpp"
+#include "convolutional_layer.hpp"
+#include "dense_layer.hpp"
+#include "activation_layer.hpp"
+#include "max_pool_layer.hpp"
+#include "flatten_layer.hpp"
+
+namespace {
+    const char magic[8] = {'C', 'N', 'N', 'C', 'K', 'P', 'T', '\0'};
+    const uint32_t byte_order_marker = 0x01020304;
+    const uint64_t data_alignment = 64;
+
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        uint32_t num_layers;
+        uint32_t num_state_buffers;
+        uint64_t file_size;
+        int64_t epoch;
+        int64_t sample;
+    };
+
+    struct LayerHeader {
+        uint32_t name_length;
+        uint32_t config_count;
+        uint32_t tensor_count;
+        uint32_t reserved;
+    };
+
+    struct TensorHeader {
+        uint32_t depth;
+        uint32_t rows;
+        uint32_t columns;
+        uint32_t reserved;
+        uint64_t offset;
+        int64_t optimizer_step;
+        uint64_t optimizer_state_offset;
+    };
+
+    uint64_t align(const uint64_t offset) {
+        return (offset + data_alignment - 1) / data_alignment * data_alignment;
+    }
+
+    /* Sequential writes to a file descriptor, keeping track of the file position */
+    class Writer {
+    public:
+        Writer(const int fd): fd_(fd), position_(0) {}
+
+        void write(const void* data, const uint64_t size) {
+            const char* bytes = static_cast<const char*>(data);
+            uint64_t written = 0;
+
+            while (written < size) {
+                const ssize_t result = ::write(fd_, bytes + written, size - written);
+                if (result < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (result <= 0) {
+                    throw std::runtime_error("Checkpoint write: failed to write file");
+                }
+                written += result;
+            }
+            position_ += size;
+        }
+
+        template <typename T>
+        void write(const T& value) {
+            write(&value, sizeof(T));
+        }
+
+        void pad_to(const uint64_t offset) {
+            const char padding[data_alignment] = {};
+            write(padding, offset - position_);
+        }
+
+    private:
+        int fd_;
+        uint64_t position_;
+    };
+
+    /* Bounds checked reads from the mapped file, fields are copied out so they need no alignment */
+    class Reader {
+    public:
+        Reader(const char* data, const uint64_t size): data_(data), size_(size), position_(0) {}
+
+        void read(void* destination, const uint64_t size) {
+            if (size > size_ - position_) {
+                throw std::runtime_error("Checkpoint load: file is truncated");
+            }
+            std::memcpy(destination, data_ + position_, size);
+            position_ += size;
+        }
+
+        uint64_t get_remaining() const {
+            return size_ - position_;
+        }
+
+        template <typename T>
+        T read() {
+            T value;
+            read(&value, sizeof(T));
+            return value;
+        }
+
+    private:
+        const char* data_;
+        uint64_t size_;
+        uint64_t position_;
+    };
+
+    /* Config values are stored as doubles, so the sizes among them are checked before the cast to int */
+    std::vector<int> to_arguments(const std::string& name, const std::vector<double>& config) {
+        std::vector<int> arguments;
+        for (size_t i = 0; i < config.size(); ++i) {
+            if (!std::isfinite(config[i])) {
+                throw std::runtime_error("Checkpoint load: non-finite config value for layer " + name);
+            }
+
+            // The learning rates are the only values that are not sizes
+            const bool learning_rate = (name == "convolutional" && i == 6) || (name == "dense" && i == 2);
+            if (learning_rate) {
+                arguments.push_back(0);
+                continue;
+            }
+            if (config[i] < 0.0 || config[i] > std::numeric_limits<int>::max() || config[i] != std::floor(config[i])) {
+                throw std::runtime_error("Checkpoint load: invalid config value for layer " + name);
+            }
+            arguments.push_back(static_cast<int>(config[i]));
+        }
+        return arguments;
+    }
+
+    std::unique_ptr<Layer> create_layer(const std::string& name, const std::vector<double>& config) {
+        const std::vector<int> arguments = to_arguments(name, config);
+
+        if (name == "convolutional" && config.size() == 7) {
+            return std::make_unique<ConvolutionalLayer>(arguments[0], arguments[1], arguments[2], arguments[3],
+                                                        arguments[4], arguments[5], config[6]);
+        }
+        if (name == "dense" && config.size() == 3) {
+            return std::make_unique<DenseLayer>(arguments[0], arguments[1], config[2]);
+        }
+        if (name == "activation" && config.size() == 1) {
+            const char* functions[] = {"sigmoid", "relu", "softmax"};
+            if (arguments[0] >= 0 && arguments[0] < 3) {
+                return std::make_unique<ActivationLayer>(functions[arguments[0]]);
+            }
+        }
+        if (name == "max_pool" && config.size() == 2) {
+            return std::make_unique<MaxPoolLayer>(arguments[0], arguments[1]);
+        }
+        if (name == "flatten" && config.size() == 3) {
+            return std::make_unique<FlattenLayer>(arguments[0], arguments[1], arguments[2]);
+        }
+
+        throw std::runtime_error("Checkpoint load: unknown layer " + name);
+    }
+
+    bool has_optimizer_state(const Optimizer::ParameterState& state) {
+        return state.step != 0 && !state.buffers.empty();
+    }
+
+    void sync_directory(const std::string& path) {
+        const size_t separator = path.find_last_of('/');
+        const std::string directory = separator == std::string::npos ? "." : path.substr(0, separator + 1);
+
+        const int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+        if (fd >= 0) {
+            fsync(fd);
+            close(fd);
+        }
+    }
+
+    NeuralNetwork load_file(const std::string& path, std::shared_ptr<Optimizer> optimizer, checkpoint::Position* position) {
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Checkpoint load: failed to open " + path);
+        }
+
+        struct stat status;
+        if (fstat(fd, &status) != 0 || status.st_size < static_cast<off_t>(sizeof(FileHeader))) {
+            close(fd);
+            throw std::runtime_error("Checkpoint load: " + path + " is not a checkpoint");
+        }
+
+        /* A private writable mapping lets training update the weights without touching the file */
+        const uint64_t size = status.st_size;
+        void* address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (address == MAP_FAILED) {
+            throw std::runtime_error("Checkpoint load: failed to map " + path);
+        }
+        std::shared_ptr<void> mapping(address, [size](void* pointer) { munmap(pointer, size); });
+        char* data = static_cast<char*>(address);
+
+        Reader reader(data, size);
+        const FileHeader file_header = reader.read<FileHeader>();
+        if (std::memcmp(file_header.magic, magic, sizeof(magic)) != 0) {
+            throw std::runtime_error("Checkpoint load: " + path + " is not a checkpoint");
+        }
+        if (file_header.version != checkpoint::version) {
+            throw std::runtime_error("Checkpoint load: unsupported version " + std::to_string(file_header.version));
+        }
+        if (file_header.byte_order != byte_order_marker) {
+            throw std::runtime_error("Checkpoint load: " + path + " was written with a different byte order");
+        }
+        if (file_header.file_size != size) {
+            throw std::runtime_error("Checkpoint load: " + path + " is truncated");
+        }
+
+        NeuralNetwork network;
+        std::vector<Optimizer::ParameterState> optimizer_states;
+
+        for (uint32_t i = 0; i < file_header.num_layers; ++i) {
+            const LayerHeader layer_header = reader.read<LayerHeader>();
+
+            /* Both counts come from the file, so they are checked against its size before allocating */
+            if (layer_header.name_length > reader.get_remaining() ||
+                static_cast<uint64_t>(layer_header.config_count) * sizeof(double) > reader.get_remaining() - layer_header.name_length) {
+                throw std::runtime_error("Checkpoint load: file is truncated");
+            }
+
+            std::string name(layer_header.name_length, '\0');
+            reader.read(&name[0], name.size());
+            std::vector<double> config(layer_header.config_count);
+            reader.read(config.data(), config.size() * sizeof(double));
+
+            std::unique_ptr<Layer> layer = create_layer(name, config);
+            std::vector<Parameter> parameters = layer->get_parameters();
+            if (parameters.size() != layer_header.tensor_count) {
+                throw std::runtime_error("Checkpoint load: wrong number of tensors for layer " + std::to_string(i));
+            }
+
+            for (const Parameter& parameter : parameters) {
+                const TensorHeader tensor_header = reader.read<TensorHeader>();
+                Tensor& value = *parameter.value;
+
+                if (static_cast<int>(tensor_header.depth) != value.get_depth() ||
+                    static_cast<int>(tensor_header.rows) != value.get_num_rows() ||
+                    static_cast<int>(tensor_header.columns) != value.get_num_columns()) {
+                    throw std::runtime_error("Checkpoint load: tensor dimensions do not match layer " + std::to_string(i));
+                }
+
+                const uint64_t bytes = static_cast<uint64_t>(value.get_size()) * sizeof(double);
+                if (tensor_header.offset % data_alignment != 0 || tensor_header.offset > size || bytes > size - tensor_header.offset) {
+                    throw std::runtime_error("Checkpoint load: tensor data out of bounds in layer " + std::to_string(i));
+                }
+
+                /* Point each matrix of the parameter at its slice of the mapping */
+                double* values = reinterpret_cast<double*>(data + tensor_header.offset);
+                for (int d = 0; d < value.get_depth(); ++d) {
+                    value(d) = Matrix(value.get_num_rows(), value.get_num_columns(), values, mapping);
+                    values += value(d).get_size();
+                }
+
+                /* Optimizer state is small next to the activations and is copied out */
+                Optimizer::ParameterState state = {tensor_header.optimizer_step, {}};
+                if (tensor_header.optimizer_step != 0 && file_header.num_state_buffers > 0) {
+                    const uint64_t state_bytes = bytes * file_header.num_state_buffers;
+                    const uint64_t state_offset = tensor_header.optimizer_state_offset;
+                    if (state_offset % data_alignment != 0 || state_offset > size || state_bytes > size - state_offset) {
+                        throw std::runtime_error("Checkpoint load: optimizer state out of bounds in layer " + std::to_string(i));
+                    }
+
+                    const double* buffer = reinterpret_cast<const double*>(data + state_offset);
+                    for (uint32_t j = 0; j < file_header.num_state_buffers; ++j) {
+                        state.buffers.emplace_back(buffer, buffer + value.get_size());
+                        buffer += value.get_size();
+                    }
+                }
+                optimizer_states.push_back(std::move(state));
+            }
+
+            network.add_layer(std::move(layer));
+        }
+
+        if (optimizer) {
+            network.set_optimizer(optimizer);
+            optimizer->import_state(network.get_parameters(), optimizer_states);
+        }
+        if (position != nullptr) {
+            position->epoch = file_header.epoch;
+            position->sample = file_header.sample;
+        }
+
+        return network;
+    }
+}
+
+/******************************************************
+ * Save
+ *****************************************************/
+
+checkpoint::Snapshot checkpoint::capture(NeuralNetwork& network, const Position& position) {
+    Snapshot snapshot;
+    snapshot.num_state_buffers = network.get_optimizer().get_num_state_buffers();
+    snapshot.position = position;
+
+    for (int i = 0; i < network.get_num_layers(); ++i) {
+        Layer& layer = network.get_layer(i);
+        const std::vector<Parameter> parameters = layer.get_parameters();
+
+        LayerSnapshot layer_snapshot;
+        layer_snapshot.name = layer.get_name();
+        layer_snapshot.config = layer.get_config();
+        for (const Parameter& parameter : parameters) {
+            layer_snapshot.parameters.push_back(*parameter.value);
+        }
+        layer_snapshot.optimizer_states = network.get_optimizer().export_state(parameters);
+
+        snapshot.layers.push_back(std::move(layer_snapshot));
+    }
+
+    return snapshot;
+}
+
+void checkpoint::write(const Snapshot& snapshot, const std::string& path) {
+    uint64_t metadata_size = sizeof(FileHeader);
+    for (const LayerSnapshot& layer : snapshot.layers) {
+        metadata_size += sizeof(LayerHeader) + layer.name.size() + layer.config.size() * sizeof(double) +
+                         layer.parameters.size() * sizeof(TensorHeader);
+    }
+
+    /* Lay out the tensor data and optimizer state after the metadata */
+    std::vector<TensorHeader> tensor_headers;
+    uint64_t file_size = metadata_size;
+    for (const LayerSnapshot& layer : snapshot.layers) {
+        for (size_t i = 0; i < layer.parameters.size(); ++i) {
+            const Tensor& value = layer.parameters[i];
+            const Optimizer::ParameterState& state = layer.optimizer_states[i];
+            const uint64_t bytes = static_cast<uint64_t>(value.get_size()) * sizeof(double);
+
+            TensorHeader tensor_header = {};
+            tensor_header.depth = value.get_depth();
+            tensor_header.rows = value.get_num_rows();
+            tensor_header.columns = value.get_num_columns();
+            tensor_header.offset = align(file_size);
+            tensor_header.optimizer_step = state.step;
+            file_size = tensor_header.offset + bytes;
+
+            if (has_optimizer_state(state)) {
+                tensor_header.optimizer_state_offset = align(file_size);
+                file_size = tensor_header.optimizer_state_offset + bytes * state.buffers.size();
+            }
+            tensor_headers.push_back(tensor_header);
+        }
+    }
+
+    const std::string temporary_path = path + ".tmp";
+    const int fd = open(temporary_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Checkpoint write: failed to open " + temporary_path);
+    }
+
+    try {
+        Writer writer(fd);
+
+        FileHeader file_header = {};
+        std::memcpy(file_header.magic, magic, sizeof(magic));
+        file_header.version = checkpoint::version;
+        file_header.byte_order = byte_order_marker;
+        file_header.num_layers = snapshot.layers.size();
+        file_header.num_state_buffers = snapshot.num_state_buffers;
+        file_header.file_size = file_size;
+        file_header.epoch = snapshot.position.epoch;
+        file_header.sample = snapshot.position.sample;
+        writer.write(file_header);
+
+        size_t tensor_index = 0;
+        for (const LayerSnapshot& layer : snapshot.layers) {
+            LayerHeader layer_header = {};
+            layer_header.name_length = layer.name.size();
+            layer_header.config_count = layer.config.size();
+            layer_header.tensor_count = layer.parameters.size();
+            writer.write(layer_header);
+            writer.write(layer.name.data(), layer.name.size());
+            writer.write(layer.config.data(), layer.config.size() * sizeof(double));
+
+            for (size_t i = 0; i < layer.parameters.size(); ++i) {
+                writer.write(tensor_headers[tensor_index++]);
+            }
+        }
+
+        tensor_index = 0;
+        for (const LayerSnapshot& layer : snapshot.layers) {
+            for (size_t i = 0; i < layer.parameters.size(); ++i) {
+                const Tensor& value = layer.parameters[i];
+                const Optimizer::ParameterState& state = layer.optimizer_states[i];
+                const TensorHeader& tensor_header = tensor_headers[tensor_index++];
+
+                writer.pad_to(tensor_header.offset);
+                for (int d = 0; d < value.get_depth(); ++d) {
+                    writer.write(value(d).get_data(), value(d).get_size() * sizeof(double));
+                }
+
+                if (has_optimizer_state(state)) {
+                    writer.pad_to(tensor_header.optimizer_state_offset);
+                    for (const std::vector<double>& buffer : state.buffers) {
+                        writer.write(buffer.data(), buffer.size() * sizeof(double));
+                    }
+                }
+            }
+        }
+
+        if (fsync(fd) != 0) {
+            throw std::runtime_error("Checkpoint write: failed to sync " + temporary_path);
+        }
+    }
+    catch (...) {
+        close(fd);
+        unlink(temporary_path.c_str());
+        throw;
+    }
+
+    close(fd);
+    if (rename(temporary_path.c_str(), path.c_str()) != 0) {
+        unlink(temporary_path.c_str());
+        throw std::runtime_error("Checkpoint write: failed to rename " + temporary_path + " to " + path);
+    }
+    sync_directory(path);
+}
+
+void checkpoint::save(NeuralNetwork& network, const std::string& path, const Position& position) {
+    write(capture(network, position), path);
+}
+
+/******************************************************
+ * Load
+ *****************************************************/
+
+NeuralNetwork checkpoint::load(const std::string& path) {
+    return load_file(path, nullptr, nullptr);
+}
+
+NeuralNetwork checkpoint::load(const std::string& path, std::shared_ptr<Optimizer> optimizer, Position& position) {
+    if (!optimizer) {
+        throw std::invalid_argument("Checkpoint load: optimizer cannot be null");
+    }
+
+    return load_file(path, optimizer, &position);
+}
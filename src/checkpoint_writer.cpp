@@ -0,0 +1,129 @@
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+#include <memory>
+#include <exception>
+#include <stdexcept>
+#include "checkpoint_writer.hpp"
+#include "checkpoint.hpp"
+#include "neural_network.hpp"
+
+/******************************************************
+ * Constructors
+ *****************************************************/
+
+CheckpointWriter::CheckpointWriter(const std::string& path, const long sample_interval, const std::chrono::seconds time_interval):
+    path_(path),
+    sample_interval_(sample_interval),
+    time_interval_(time_interval),
+    samples_since_checkpoint_(0),
+    last_checkpoint_(std::chrono::steady_clock::now()),
+    num_written_(0),
+    snapshots_(1),
+    busy_(false) {
+
+    if (path.empty()) {
+        throw std::invalid_argument("CheckpointWriter constructor: path cannot be empty");
+    }
+    if (sample_interval < 0 || time_interval.count() < 0) {
+        throw std::invalid_argument("CheckpointWriter constructor: intervals cannot be negative");
+    }
+
+    thread_ = std::thread(&CheckpointWriter::run, this);
+}
+
+CheckpointWriter::~CheckpointWriter() {
+    snapshots_.close();
+    thread_.join();
+}
+
+/******************************************************
+ * Getters
+ *****************************************************/
+
+int CheckpointWriter::get_num_written() const {
+    return num_written_;
+}
+
+/******************************************************
+ * Operations
+ *****************************************************/
+
+void CheckpointWriter::on_sample(NeuralNetwork& network, const checkpoint::Position& position) {
+    ++samples_since_checkpoint_;
+
+    const bool samples_due = sample_interval_ > 0 && samples_since_checkpoint_ >= sample_interval_;
+    const bool time_due = time_interval_.count() > 0 && std::chrono::steady_clock::now() - last_checkpoint_ >= time_interval_;
+
+    if ((samples_due || time_due) && !is_busy()) {
+        submit(network, position);
+    }
+}
+
+void CheckpointWriter::write(NeuralNetwork& network, const checkpoint::Position& position) {
+    flush();
+    submit(network, position);
+}
+
+void CheckpointWriter::flush() {
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        idle_.wait(lock, [this] { return !busy_; });
+    }
+    rethrow_error();
+}
+
+void CheckpointWriter::submit(NeuralNetwork& network, const checkpoint::Position& position) {
+    rethrow_error();
+
+    /* The copy is the only part that stalls training */
+    std::unique_ptr<checkpoint::Snapshot> snapshot(new checkpoint::Snapshot(checkpoint::capture(network, position)));
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        busy_ = true;
+    }
+    samples_since_checkpoint_ = 0;
+    last_checkpoint_ = std::chrono::steady_clock::now();
+    snapshots_.push(std::move(snapshot));
+}
+
+bool CheckpointWriter::is_busy() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return busy_;
+}
+
+void CheckpointWriter::rethrow_error() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (error_) {
+        std::exception_ptr error = error_;
+        error_ = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void CheckpointWriter::run() {
+    std::unique_ptr<checkpoint::Snapshot> snapshot;
+
+    while (snapshots_.pop(snapshot)) {
+        std::exception_ptr error;
+        try {
+            checkpoint::write(*snapshot, path_);
+            ++num_written_;
+        }
+        catch (...) {
+            error = std::current_exception();
+        }
+        snapshot.reset();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (error) {
+            error_ = error;
+        }
+        busy_ = false;
+        idle_.notify_all();
+    }
+}
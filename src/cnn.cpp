@@ -0,0 +1,200 @@
+#include <string>
+#include <vector>
+#include <new>
+#include <memory>
+#include <stdexcept>
+#include <cstddef>
+#include "cnn.h"
+#include "neural_network.hpp"
+#include "checkpoint.hpp"
+#include "layer.hpp"
+#include "tensor.hpp"
+
+struct cnn_model {
+    NeuralNetwork network;
+    cnn_shape input_shape;
+    cnn_shape output_shape;
+    // The current sample converted to doubles, and the activations of its inference
+    Tensor input;
+    InferenceWorkspace workspace;
+};
+
+namespace {
+
+    thread_local std::string last_error;
+
+    cnn_status fail(const cnn_status status, const char* message) {
+        try {
+            last_error = message;
+        }
+        catch (...) {
+            last_error.clear();
+        }
+        return status;
+    }
+
+    /* Runs body, turning any exception into a status so none reaches the C caller */
+    template <typename Body>
+    cnn_status guard(Body body) {
+        try {
+            body();
+            return CNN_OK;
+        }
+        catch (const std::invalid_argument& error) {
+            return fail(CNN_ERROR_INVALID_ARGUMENT, error.what());
+        }
+        catch (const std::bad_alloc&) {
+            return fail(CNN_ERROR_OUT_OF_MEMORY, "cnn: out of memory");
+        }
+        catch (const std::runtime_error& error) {
+            return fail(CNN_ERROR_IO, error.what());
+        }
+        catch (const std::exception& error) {
+            return fail(CNN_ERROR_INTERNAL, error.what());
+        }
+        catch (...) {
+            return fail(CNN_ERROR_INTERNAL, "cnn: unknown error");
+        }
+    }
+
+    size_t get_size(const cnn_shape& shape) {
+        return static_cast<size_t>(shape.depth) * shape.rows * shape.columns;
+    }
+
+    /* The input shape is fixed by the first layer that has one */
+    cnn_shape find_input_shape(NeuralNetwork& network) {
+        if (network.get_num_layers() == 0) {
+            throw std::invalid_argument("cnn_model_create: the checkpoint has no layers");
+        }
+
+        const Layer& layer = network.get_layer(0);
+        const std::vector<double> config = layer.get_config();
+
+        if (layer.get_name() == "convolutional") {
+            return {static_cast<int>(config[1]), static_cast<int>(config[2]), static_cast<int>(config[3])};
+        }
+        if (layer.get_name() == "flatten") {
+            return {static_cast<int>(config[0]), static_cast<int>(config[1]), static_cast<int>(config[2])};
+        }
+        if (layer.get_name() == "dense") {
+            return {1, 1, static_cast<int>(config[0])};
+        }
+        throw std::invalid_argument("cnn_model_create: the input shape of a network starting with a " + layer.get_name() +
+                                    " layer is unknown");
+    }
+}
+
+/******************************************************
+ * Lifetime
+ *****************************************************/
+
+cnn_status cnn_model_create(const char* checkpoint_path, cnn_model** model) {
+    if (checkpoint_path == nullptr || model == nullptr) {
+        return fail(CNN_ERROR_INVALID_ARGUMENT, "cnn_model_create: checkpoint_path and model cannot be null");
+    }
+
+    return guard([&] {
+        std::unique_ptr<cnn_model> created(new cnn_model{checkpoint::load(checkpoint_path), {0, 0, 0}, {0, 0, 0}, Tensor(),
+                                                         InferenceWorkspace()});
+
+        created->input_shape = find_input_shape(created->network);
+        created->input = Tensor(created->input_shape.depth, created->input_shape.rows, created->input_shape.columns);
+
+        /* A first inference sizes the workspace, so runs do not allocate, and gives the output shape */
+        const Tensor& output = created->network.predict(created->input, created->workspace);
+        created->output_shape = {output.get_depth(), output.get_num_rows(), output.get_num_columns()};
+
+        *model = created.release();
+    });
+}
+
+void cnn_model_destroy(cnn_model* model) {
+    delete model;
+}
+
+/******************************************************
+ * Shapes
+ *****************************************************/
+
+cnn_status cnn_model_input_shape(const cnn_model* model, cnn_shape* shape) {
+    if (model == nullptr || shape == nullptr) {
+        return fail(CNN_ERROR_INVALID_ARGUMENT, "cnn_model_input_shape: model and shape cannot be null");
+    }
+
+    *shape = model->input_shape;
+    return CNN_OK;
+}
+
+cnn_status cnn_model_output_shape(const cnn_model* model, cnn_shape* shape) {
+    if (model == nullptr || shape == nullptr) {
+        return fail(CNN_ERROR_INVALID_ARGUMENT, "cnn_model_output_shape: model and shape cannot be null");
+    }
+
+    *shape = model->output_shape;
+    return CNN_OK;
+}
+
+/******************************************************
+ * Inference
+ *****************************************************/
+
+cnn_status cnn_model_run(cnn_model* model, const float* inputs, const int batch_size, float* outputs) {
+    if (model == nullptr) {
+        return fail(CNN_ERROR_INVALID_ARGUMENT, "cnn_model_run: model cannot be null");
+    }
+    if (batch_size < 0) {
+        return fail(CNN_ERROR_INVALID_ARGUMENT, "cnn_model_run: batch_size cannot be negative");
+    }
+    if (batch_size > 0 && (inputs == nullptr || outputs == nullptr)) {
+        return fail(CNN_ERROR_INVALID_ARGUMENT, "cnn_model_run: inputs and outputs cannot be null");
+    }
+
+    return guard([&] {
+        const size_t input_size = get_size(model->input_shape);
+        const size_t channel_size = static_cast<size_t>(model->input_shape.rows) * model->input_shape.columns;
+
+        for (int sample = 0; sample < batch_size; ++sample) {
+            const float* input = inputs + sample * input_size;
+            for (int d = 0; d < model->input_shape.depth; ++d) {
+                double* channel = model->input(d).get_data();
+                for (size_t i = 0; i < channel_size; ++i) {
+                    channel[i] = input[d * channel_size + i];
+                }
+            }
+
+            const Tensor& result = model->network.predict(model->input, model->workspace);
+
+            float* output = outputs + sample * get_size(model->output_shape);
+            for (int d = 0; d < result.get_depth(); ++d) {
+                const Matrix& channel = result(d);
+                for (int i = 0; i < channel.get_size(); ++i) {
+                    *output++ = static_cast<float>(channel.get_data()[i]);
+                }
+            }
+        }
+    });
+}
+
+/******************************************************
+ * Errors
+ *****************************************************/
+
+const char* cnn_last_error(void) {
+    return last_error.c_str();
+}
+
+const char* cnn_status_string(const cnn_status status) {
+    switch (status) {
+        case CNN_OK:
+            return "ok";
+        case CNN_ERROR_INVALID_ARGUMENT:
+            return "invalid argument";
+        case CNN_ERROR_IO:
+            return "checkpoint could not be read";
+        case CNN_ERROR_OUT_OF_MEMORY:
+            return "out of memory";
+        case CNN_ERROR_INTERNAL:
+            return "internal error";
+    }
+    return "unknown status";
+}
@@ -1,9 +1,14 @@
 #include <string>
 #include <stdexcept>
 #include <cmath>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <functional>
 #include "convolutional_layer.hpp"
 #include "tensor.hpp"
 #include "utility.hpp"
+#include "thread_pool.hpp"
 
 /******************************************************
  * Constructors
@@ -25,12 +30,14 @@ ConvolutionalLayer::ConvolutionalLayer(const int output_depth,
     filter_rows_(filter_rows),
     filter_columns_(filter_columns),
     stride_(1),
-    filters_(output_depth, Tensor(input_depth, filter_rows, filter_columns)),
-    biases_(output_depth, output_rows_, output_columns_),
+    filters_(std::make_shared<std::vector<Tensor>>(output_depth, Tensor(input_depth, filter_rows, filter_columns))),
+    biases_(std::make_shared<Tensor>(output_depth, output_rows_, output_columns_)),
+    filters_gradient_(output_depth, Tensor(input_depth, filter_rows, filter_columns)),
+    biases_gradient_(output_depth, output_rows_, output_columns_),
     learning_rate_(learning_rate) {
     
     for (int i = 0; i < output_depth; ++i) {
-        filters_[i].randomize(0, sqrt(2.0 / (filter_rows * filter_columns * input_depth)));
+        (*filters_)[i].randomize(0, sqrt(2.0 / (filter_rows * filter_columns * input_depth)));
     }
 } 
 
@@ -39,19 +46,8 @@ ConvolutionalLayer::ConvolutionalLayer(const int output_depth,
  *****************************************************/
 
 Tensor ConvolutionalLayer::forward(const Tensor& input) {
-    if (input.get_depth() != input_depth_ || input.get_num_rows() != input_rows_ || input.get_num_columns() != input_columns_) {
-        throw std::invalid_argument("ConvolutionalLayer forward: invalid input dimensions");
-    }
-
     input_ = input;
-    output_ = biases_;
-
-    for (int i = 0; i < output_depth_; ++i) {
-        for (int j = 0; j < input_depth_; ++j) {
-            output_(i) += input(j).correlate(filters_[i](j), stride_, "valid");
-        }
-    }
-
+    infer(input, output_);
     return output_;
 }
 
@@ -60,19 +56,118 @@ Tensor ConvolutionalLayer::backward(const Tensor& output) {
         throw std::invalid_argument("ConvolutionalLayer forward: invalid input dimensions");
     }
 
-    std::vector<Tensor> filters_gradient(output_depth_, Tensor(input_depth_, filter_rows_, filter_columns_));
     Tensor input_gradient(input_depth_, input_rows_, input_columns_);
+    const std::vector<Tensor>& filters = *filters_;
 
-    for (int i = 0; i < output_depth_; ++i) {
-        for (int j = 0; j < input_depth_; ++j) {
-            filters_gradient[i](j) = input_(j).correlate(output(i), stride_, "valid");
-            input_gradient(j) += output(i).convolve(filters_[i](j), stride_, "full");
+    /* Filter gradients are split across output channels, input gradients across input channels */
+    parallel_for(0, output_depth_, 1, [&](const int begin, const int end) {
+        for (int i = begin; i < end; ++i) {
+            for (int j = 0; j < input_depth_; ++j) {
+                filters_gradient_[i](j) += input_(j).correlate(output(i), stride_, "valid");
+            }
+        }
+    });
+    parallel_for(0, input_depth_, 1, [&](const int begin, const int end) {
+        for (int j = begin; j < end; ++j) {
+            for (int i = 0; i < output_depth_; ++i) {
+                input_gradient(j) += output(i).convolve(filters[i](j), stride_, "full");
+            }
         }
+    });
+
+    biases_gradient_ += output;
+    return input_gradient;
+}
+
+void ConvolutionalLayer::infer(const Tensor& input, Tensor& output) const {
+    if (input.get_depth() != input_depth_ || input.get_num_rows() != input_rows_ || input.get_num_columns() != input_columns_) {
+        throw std::invalid_argument("ConvolutionalLayer forward: invalid input dimensions");
     }
 
+    output = *biases_;
+
+    /* Output channels are independent of each other. The body is passed by reference,
+     * which std::function stores without allocating, so inference does not allocate */
+    const std::vector<Tensor>& filters = *filters_;
+    const auto correlate_channels = [&](const int begin, const int end) {
+        for (int i = begin; i < end; ++i) {
+            for (int j = 0; j < input_depth_; ++j) {
+                input(j).correlate_accumulate(filters[i](j), stride_, output(i));
+            }
+        }
+    };
+    parallel_for(0, output_depth_, 1, std::cref(correlate_channels));
+}
+
+/******************************************************
+ * Parameters
+ *****************************************************/
+
+std::vector<Parameter> ConvolutionalLayer::get_parameters() {
+    std::vector<Parameter> parameters;
+    std::vector<Tensor>& filters = *filters_;
+
     for (int i = 0; i < output_depth_; ++i) {
-        filters_[i] -= filters_gradient[i].scalar_multiply(learning_rate_);
+        parameters.push_back(Parameter {&filters[i], &filters_gradient_[i], learning_rate_});
     }
-    biases_ -= output.scalar_multiply(learning_rate_);
-    return input_gradient;
+    parameters.push_back(Parameter {biases_.get(), &biases_gradient_, learning_rate_});
+
+    return parameters;
+}
+
+/******************************************************
+ * Forward caches
+ *****************************************************/
+
+void ConvolutionalLayer::clear_cache() {
+    input_ = Tensor();
+    output_ = Tensor();
+}
+
+size_t ConvolutionalLayer::get_cache_bytes() const {
+    return (input_.get_size() + output_.get_size()) * sizeof(double);
+}
+
+/******************************************************
+ * Replication
+ *****************************************************/
+
+std::unique_ptr<Layer> ConvolutionalLayer::replicate() const {
+    std::unique_ptr<ConvolutionalLayer> replica(new ConvolutionalLayer(*this));
+    replica->input_ = Tensor();
+    replica->output_ = Tensor();
+    replica->filters_gradient_.assign(output_depth_, Tensor(input_depth_, filter_rows_, filter_columns_));
+    replica->biases_gradient_ = Tensor(output_depth_, output_rows_, output_columns_);
+    return replica;
+}
+
+/******************************************************
+ * Serialization
+ *****************************************************/
+
+std::string ConvolutionalLayer::get_name() const {
+    return "convolutional";
+}
+
+std::vector<double> ConvolutionalLayer::get_config() const {
+    return {static_cast<double>(output_depth_), static_cast<double>(input_depth_),
+            static_cast<double>(input_rows_), static_cast<double>(input_columns_),
+            static_cast<double>(filter_rows_), static_cast<double>(filter_columns_), learning_rate_};
+}
+
+/******************************************************
+ * Profiling
+ *****************************************************/
+
+double ConvolutionalLayer::get_forward_flops(const Tensor& input) const {
+    (void)input;
+
+    /* A multiply and an add per filter element and output element, plus the bias */
+    const double outputs = static_cast<double>(output_depth_) * output_rows_ * output_columns_;
+    return outputs * (2.0 * input_depth_ * filter_rows_ * filter_columns_ + 1.0);
+}
+
+double ConvolutionalLayer::get_backward_flops(const Tensor& input) const {
+    /* The filter gradients and the input gradient each cost about as much as forward */
+    return 2.0 * get_forward_flops(input);
 }
@@ -1,6 +1,9 @@
 #include <string>
 #include <stdexcept>
 #include <cmath>
+#include <cstddef>
+#include <memory>
+#include <vector>
 #include "dense_layer.hpp"
 #include "tensor.hpp"
 
@@ -11,12 +14,14 @@
 DenseLayer::DenseLayer(const int input_size, const int output_size, const double learning_rate):
     input_size_(input_size), 
     output_size_(output_size),
-    weights_(1, input_size, output_size), 
-    biases_(1, 1, output_size),
+    weights_(std::make_shared<Tensor>(1, input_size, output_size)),
+    biases_(std::make_shared<Tensor>(1, 1, output_size)),
+    weights_gradient_(1, input_size, output_size),
+    biases_gradient_(1, 1, output_size),
     input_(1, 1, input_size),
     learning_rate_(learning_rate) {
     
-    weights_.randomize(0, sqrt(1.0 / input_size));
+    weights_->randomize(0, sqrt(1.0 / input_size));
 }
 
 /******************************************************
@@ -24,12 +29,11 @@ DenseLayer::DenseLayer(const int input_size, const int output_size, const double
  *****************************************************/
 
 Tensor DenseLayer::forward(const Tensor& input) {
-    if (input.get_depth() != 1) {
-        throw std::invalid_argument("DenseLayer forward: tensor must have depth 1");
-    }
-
     input_ = input;
-    return input * weights_ + biases_;
+
+    Tensor output;
+    infer(input, output);
+    return output;
 }
 
 Tensor DenseLayer::backward(const Tensor& output) {
@@ -37,12 +41,81 @@ Tensor DenseLayer::backward(const Tensor& output) {
         throw std::invalid_argument("DenseLayer forward: tensor must have depth 1");
     }
 
-    Tensor weights_gradient = input_.transpose() * output;
-    Tensor biases_gradient = output;
-    Tensor input_gradient = output * weights_.transpose();
-
-    weights_ -= weights_gradient.scalar_multiply(learning_rate_);
-    biases_ -= biases_gradient.scalar_multiply(learning_rate_);
+    weights_gradient_ += input_.transpose() * output;
+    biases_gradient_ += output;
+    Tensor input_gradient = output * weights_->transpose();
 
     return input_gradient;
 }
+
+void DenseLayer::infer(const Tensor& input, Tensor& output) const {
+    if (input.get_depth() != 1) {
+        throw std::invalid_argument("DenseLayer forward: tensor must have depth 1");
+    }
+
+    output.resize(1, input.get_num_rows(), output_size_);
+    input(0).multiply_into((*weights_)(0), output(0));
+    output(0) += (*biases_)(0);
+}
+
+/******************************************************
+ * Parameters
+ *****************************************************/
+
+std::vector<Parameter> DenseLayer::get_parameters() {
+    return std::vector<Parameter> {
+        Parameter {weights_.get(), &weights_gradient_, learning_rate_},
+        Parameter {biases_.get(), &biases_gradient_, learning_rate_}
+    };
+}
+
+/******************************************************
+ * Forward caches
+ *****************************************************/
+
+void DenseLayer::clear_cache() {
+    input_ = Tensor();
+}
+
+size_t DenseLayer::get_cache_bytes() const {
+    return input_.get_size() * sizeof(double);
+}
+
+/******************************************************
+ * Replication
+ *****************************************************/
+
+std::unique_ptr<Layer> DenseLayer::replicate() const {
+    std::unique_ptr<DenseLayer> replica(new DenseLayer(*this));
+    replica->input_ = Tensor(1, 1, input_size_);
+    replica->weights_gradient_ = Tensor(1, input_size_, output_size_);
+    replica->biases_gradient_ = Tensor(1, 1, output_size_);
+    return replica;
+}
+
+/******************************************************
+ * Serialization
+ *****************************************************/
+
+std::string DenseLayer::get_name() const {
+    return "dense";
+}
+
+std::vector<double> DenseLayer::get_config() const {
+    return {static_cast<double>(input_size_), static_cast<double>(output_size_), learning_rate_};
+}
+
+/******************************************************
+ * Profiling
+ *****************************************************/
+
+double DenseLayer::get_forward_flops(const Tensor& input) const {
+    (void)input;
+    return (2.0 * input_size_ + 1.0) * output_size_;
+}
+
+double DenseLayer::get_backward_flops(const Tensor& input) const {
+    /* The weight gradient and the input gradient, each a multiply and an add per weight */
+    (void)input;
+    return 4.0 * input_size_ * output_size_ + output_size_;
+}
@@ -0,0 +1,211 @@
+#include <string>
+#include <vector>
+#include <sstream>
+#include <iomanip>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include "evaluation.hpp"
+#include "neural_network.hpp"
+#include "mnist_data_set.hpp"
+#include "streaming_data_set.hpp"
+#include "thread_pool.hpp"
+#include "tracer.hpp"
+#include "tensor.hpp"
+#include "utility.hpp"
+
+namespace {
+
+    struct Prediction {
+        int num_classes;
+        int expected;
+        int predicted;
+        double loss;
+    };
+
+    /* Activations and sample tensors of one chunk, reused by later chunks on the same thread */
+    struct Scratch {
+        InferenceWorkspace workspace;
+        Tensor input;
+        Tensor label;
+    };
+
+    /* A thread waiting on the pool inside predict can start another chunk, so every chunk
+     * leases its own scratch from the thread's free list and hands it back when done */
+    thread_local std::vector<std::unique_ptr<Scratch>> free_scratch;
+
+    class ScratchLease {
+    public:
+
+        ScratchLease() {
+            if (free_scratch.empty()) {
+                scratch_.reset(new Scratch());
+            }
+            else {
+                scratch_ = std::move(free_scratch.back());
+                free_scratch.pop_back();
+            }
+        }
+
+        ScratchLease(const ScratchLease& other) = delete;
+        ScratchLease& operator=(const ScratchLease& other) = delete;
+
+        ~ScratchLease() {
+            free_scratch.push_back(std::move(scratch_));
+        }
+
+        Scratch& get() {
+            return *scratch_;
+        }
+
+    private:
+        std::unique_ptr<Scratch> scratch_;
+    };
+
+    /* Predicts a batch in parallel, every sample writing only its own slot */
+    void predict_batch(const NeuralNetwork& network, const int count,
+                       const std::function<void(int, Tensor&, Tensor&)>& load, std::vector<Prediction>& predictions) {
+        predictions.resize(count);
+
+        parallel_for(0, count, 8, [&](const int begin, const int end) {
+            ScratchLease lease;
+            Scratch& scratch = lease.get();
+
+            for (int i = begin; i < end; ++i) {
+                load(i, scratch.input, scratch.label);
+                const Tensor& output = network.predict(scratch.input, scratch.workspace);
+                if (output.get_size() != scratch.label.get_size()) {
+                    throw std::invalid_argument("Evaluate: the network output and the labels differ in size");
+                }
+
+                predictions[i] = {output.get_size(), utility::argmax(scratch.label), utility::argmax(output),
+                                  utility::cross_entropy(output, scratch.label)};
+            }
+        });
+    }
+
+    /* Adds a batch in sample order, which keeps the loss sum independent of the thread count */
+    void reduce(const std::vector<Prediction>& predictions, const int count, evaluation::Evaluation& result, double& loss_sum) {
+        for (int i = 0; i < count; ++i) {
+            const Prediction& prediction = predictions[i];
+
+            /* The confusion matrix takes its size from the first output */
+            if (result.confusion.empty()) {
+                result.confusion.assign(prediction.num_classes, std::vector<long>(prediction.num_classes, 0));
+            }
+            if (prediction.num_classes != static_cast<int>(result.confusion.size())) {
+                throw std::invalid_argument("Evaluate: the network output changed size");
+            }
+
+            ++result.num_samples;
+            result.num_correct += prediction.expected == prediction.predicted;
+            ++result.confusion[prediction.expected][prediction.predicted];
+            loss_sum += prediction.loss;
+        }
+    }
+
+    evaluation::Evaluation create_result() {
+        return {0, 0, 0.0, 0.0, {}};
+    }
+
+    void finish(evaluation::Evaluation& result, const double loss_sum) {
+        result.accuracy = result.num_samples > 0 ? static_cast<double>(result.num_correct) / result.num_samples : 0.0;
+        result.loss = result.num_samples > 0 ? loss_sum / result.num_samples : 0.0;
+    }
+}
+
+evaluation::Evaluation evaluation::evaluate(const NeuralNetwork& network, const MNISTDataSet& data_set, const int batch_size) {
+    if (batch_size <= 0) {
+        throw std::invalid_argument("Evaluate: batch_size must be greater than 0");
+    }
+
+    static const int evaluate_trace = Tracer::get_global().intern("evaluate", "evaluate");
+    TraceScope trace(evaluate_trace);
+
+    Evaluation result = create_result();
+    double loss_sum = 0.0;
+    std::vector<Prediction> predictions;
+
+    for (int begin = 0; begin < data_set.get_test_size(); begin += batch_size) {
+        const int count = std::min(batch_size, data_set.get_test_size() - begin);
+
+        predict_batch(network, count, [&](const int i, Tensor& input, Tensor& label) {
+            data_set.get_test_data(begin + i, input);
+            data_set.get_test_label(begin + i, label);
+        }, predictions);
+        reduce(predictions, count, result, loss_sum);
+    }
+
+    finish(result, loss_sum);
+    return result;
+}
+
+evaluation::Evaluation evaluation::evaluate(const NeuralNetwork& network, StreamingDataSet& data_set, const int batch_size) {
+    if (batch_size <= 0) {
+        throw std::invalid_argument("Evaluate: batch_size must be greater than 0");
+    }
+
+    static const int evaluate_trace = Tracer::get_global().intern("evaluate", "evaluate");
+    TraceScope trace(evaluate_trace);
+
+    Evaluation result = create_result();
+    double loss_sum = 0.0;
+    std::vector<Tensor> inputs(batch_size);
+    std::vector<Tensor> labels(batch_size);
+    std::vector<Prediction> predictions;
+
+    data_set.start_pass(0);
+    for (;;) {
+        /* The stream has a single reader, so batches are filled before predicting them */
+        int count = 0;
+        while (count < batch_size && data_set.next(inputs[count], labels[count])) {
+            ++count;
+        }
+        if (count == 0) {
+            break;
+        }
+
+        predict_batch(network, count, [&](const int i, Tensor& input, Tensor& label) {
+            input = inputs[i];
+            label = labels[i];
+        }, predictions);
+        reduce(predictions, count, result, loss_sum);
+    }
+
+    finish(result, loss_sum);
+    return result;
+}
+
+std::string evaluation::format_confusion(const Evaluation& evaluation) {
+    const int num_classes = static_cast<int>(evaluation.confusion.size());
+    std::ostringstream table;
+
+    table << "expected \\ predicted\n" << std::setw(9) << "";
+    for (int predicted = 0; predicted < num_classes; ++predicted) {
+        table << std::setw(7) << predicted;
+    }
+    table << "   recall\n";
+
+    std::vector<long> predicted_totals(num_classes, 0);
+    for (int expected = 0; expected < num_classes; ++expected) {
+        long total = 0;
+        table << std::setw(9) << expected;
+        for (int predicted = 0; predicted < num_classes; ++predicted) {
+            table << std::setw(7) << evaluation.confusion[expected][predicted];
+            total += evaluation.confusion[expected][predicted];
+            predicted_totals[predicted] += evaluation.confusion[expected][predicted];
+        }
+        table << std::fixed << std::setprecision(2) << std::setw(8)
+              << (total > 0 ? 100.0 * evaluation.confusion[expected][expected] / total : 0.0) << "%\n";
+    }
+
+    table << "precision";
+    for (int predicted = 0; predicted < num_classes; ++predicted) {
+        const double precision = predicted_totals[predicted] > 0
+                                 ? 100.0 * evaluation.confusion[predicted][predicted] / predicted_totals[predicted] : 0.0;
+        table << std::setw(7) << std::setprecision(1) << precision;
+    }
+    table << "\n";
+
+    return table.str();
+}
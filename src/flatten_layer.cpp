@@ -1,3 +1,7 @@
+#include <string>
+#include <cstddef>
+#include <memory>
+#include <vector>
 #include "tensor.hpp"
 #include "flatten_layer.hpp"
 
@@ -23,3 +27,76 @@ Tensor FlattenLayer::backward(const Tensor& output) {
     input.reshape(input_depth_, input_rows_, input_columns_);
     return input;
 }
+
+/******************************************************
+ * Parameters
+ *****************************************************/
+
+std::vector<Parameter> FlattenLayer::get_parameters() {
+    return std::vector<Parameter>();
+}
+
+void FlattenLayer::infer(const Tensor& input, Tensor& output) const {
+    const int rows = input.get_num_rows();
+    const int columns = input.get_num_columns();
+
+    if (input.get_size() <= 0) {
+        output = Tensor();
+        return;
+    }
+
+    output.resize(1, 1, input.get_size());
+
+    for (int i = 0; i < input.get_depth(); ++i) {
+        for (int j = 0; j < rows; ++j) {
+            for (int k = 0; k < columns; ++k) {
+                output(0)(0, (i * rows + j) * columns + k) = input(i)(j, k);
+            }
+        }
+    }
+}
+
+/******************************************************
+ * Forward caches
+ *****************************************************/
+
+void FlattenLayer::clear_cache() {}
+
+size_t FlattenLayer::get_cache_bytes() const {
+    return 0;
+}
+
+/******************************************************
+ * Replication
+ *****************************************************/
+
+std::unique_ptr<Layer> FlattenLayer::replicate() const {
+    return std::unique_ptr<Layer>(new FlattenLayer(input_depth_, input_rows_, input_columns_));
+}
+
+/******************************************************
+ * Serialization
+ *****************************************************/
+
+std::string FlattenLayer::get_name() const {
+    return "flatten";
+}
+
+std::vector<double> FlattenLayer::get_config() const {
+    return {static_cast<double>(input_depth_), static_cast<double>(input_rows_), static_cast<double>(input_columns_)};
+}
+
+/******************************************************
+ * Profiling
+ *****************************************************/
+
+double FlattenLayer::get_forward_flops(const Tensor& input) const {
+    /* Flattening only moves data */
+    (void)input;
+    return 0.0;
+}
+
+double FlattenLayer::get_backward_flops(const Tensor& input) const {
+    (void)input;
+    return 0.0;
+}
@@ -0,0 +1,84 @@
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <stdexcept>
+#include "hogwild_trainer.hpp"
+#include "neural_network.hpp"
+#include "mnist_data_set.hpp"
+#include "tensor.hpp"
+
+/******************************************************
+ * Constructors
+ *****************************************************/
+
+HogwildTrainer::HogwildTrainer(NeuralNetwork& network, const int num_threads):
+    num_threads_(num_threads),
+    network_(network) {
+
+    if (num_threads <= 0) {
+        throw std::invalid_argument("HogwildTrainer constructor: num_threads must be greater than 0");
+    }
+
+    /* The first thread trains the original network, the rest train replicas sharing its parameters */
+    for (int i = 1; i < num_threads_; ++i) {
+        replicas_.push_back(network_.replicate());
+    }
+}
+
+/******************************************************
+ * Getters
+ *****************************************************/
+
+int HogwildTrainer::get_num_threads() const {
+    return num_threads_;
+}
+
+/******************************************************
+ * Operations
+ *****************************************************/
+
+void HogwildTrainer::train(const MNISTDataSet& data_set, const int first_sample) {
+    if (first_sample < 0) {
+        throw std::invalid_argument("HogwildTrainer train: first_sample cannot be negative");
+    }
+
+    std::atomic<int> next_position(first_sample);
+    std::vector<std::exception_ptr> errors(num_threads_);
+
+    auto worker = [&](const int thread_index) {
+        NeuralNetwork& network = thread_index == 0 ? network_ : replicas_[thread_index - 1];
+
+        try {
+            Tensor input;
+            Tensor expected_output;
+            int position = next_position.fetch_add(1, std::memory_order_relaxed);
+
+            while (position < data_set.get_train_size()) {
+                data_set.get_train_data(position, input);
+                data_set.get_train_label(position, expected_output);
+                network.train(input, expected_output);
+                position = next_position.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        catch (...) {
+            errors[thread_index] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < num_threads_; ++i) {
+        threads.emplace_back(worker, i);
+    }
+    worker(0);
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    for (const std::exception_ptr& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
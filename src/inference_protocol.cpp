@@ -0,0 +1,94 @@
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "inference_protocol.hpp"
+
+bool inference_protocol::read_exact(const int fd, void* buffer, const size_t size) {
+    char* position = static_cast<char*>(buffer);
+    size_t remaining = size;
+
+    while (remaining > 0) {
+        ssize_t count = ::read(fd, position, remaining);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            return false;
+        }
+
+        position += count;
+        remaining -= static_cast<size_t>(count);
+    }
+
+    return true;
+}
+
+bool inference_protocol::write_exact(const int fd, const void* buffer, const size_t size) {
+    const char* position = static_cast<const char*>(buffer);
+    size_t remaining = size;
+
+    while (remaining > 0) {
+        ssize_t count = ::send(fd, position, remaining, MSG_NOSIGNAL);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            return false;
+        }
+
+        position += count;
+        remaining -= static_cast<size_t>(count);
+    }
+
+    return true;
+}
+
+bool inference_protocol::read_u32(const int fd, uint32_t& value) {
+    return read_exact(fd, &value, sizeof(value));
+}
+
+bool inference_protocol::write_u32(const int fd, const uint32_t value) {
+    return write_exact(fd, &value, sizeof(value));
+}
+
+bool inference_protocol::write_response(const int fd, const uint32_t status, const std::vector<float>& values) {
+    return write_u32(fd, status) &&
+           write_u32(fd, static_cast<uint32_t>(values.size())) &&
+           write_exact(fd, values.data(), values.size() * sizeof(float));
+}
+
+bool inference_protocol::write_response(const int fd, const uint32_t status, const std::string& text) {
+    return write_u32(fd, status) &&
+           write_u32(fd, static_cast<uint32_t>(text.size())) &&
+           write_exact(fd, text.data(), text.size());
+}
+
+int inference_protocol::connect_unix_socket(const std::string& socket_path) {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        throw std::invalid_argument("Connect_unix_socket: socket path is too long");
+    }
+    std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        throw std::runtime_error("Connect_unix_socket: failed to create socket");
+    }
+
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        ::close(fd);
+        throw std::runtime_error("Connect_unix_socket: failed to connect to " + socket_path);
+    }
+
+    return fd;
+}
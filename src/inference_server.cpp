@@ -0,0 +1,276 @@
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <future>
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "inference_server.hpp"
+#include "inference_protocol.hpp"
+#include "neural_network.hpp"
+#include "thread_pool.hpp"
+#include "utility.hpp"
+
+namespace {
+    /* Number of most recent request latencies the percentiles are computed over */
+    const size_t latency_window = 10000;
+}
+
+/******************************************************
+ * Constructors
+ *****************************************************/
+
+InferenceServer::InferenceServer(const NeuralNetwork& network,
+                                 const std::string& socket_path,
+                                 const int input_depth,
+                                 const int input_rows,
+                                 const int input_columns,
+                                 const int max_batch_size,
+                                 const std::chrono::microseconds max_delay):
+    network_(network),
+    socket_path_(socket_path),
+    input_depth_(input_depth),
+    input_rows_(input_rows),
+    input_columns_(input_columns),
+    max_batch_size_(max_batch_size),
+    max_delay_(max_delay),
+    listen_fd_(-1),
+    stop_requested_(false),
+    requests_(max_batch_size * 16),
+    start_time_(std::chrono::steady_clock::now()),
+    num_requests_(0),
+    num_batches_(0) {
+
+    if (input_depth <= 0 || input_rows <= 0 || input_columns <= 0) {
+        throw std::invalid_argument("InferenceServer constructor: input dimensions must be greater than 0");
+    }
+    if (max_batch_size <= 0) {
+        throw std::invalid_argument("InferenceServer constructor: max_batch_size must be greater than 0");
+    }
+
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        throw std::invalid_argument("InferenceServer constructor: socket path is too long");
+    }
+    std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+
+    listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) {
+        throw std::runtime_error("InferenceServer constructor: failed to create socket");
+    }
+
+    ::unlink(socket_path.c_str());
+    if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || ::listen(listen_fd_, 128) < 0) {
+        ::close(listen_fd_);
+        throw std::runtime_error("InferenceServer constructor: failed to listen on " + socket_path);
+    }
+}
+
+InferenceServer::~InferenceServer() {
+    ::close(listen_fd_);
+    ::unlink(socket_path_.c_str());
+}
+
+/******************************************************
+ * Operations
+ *****************************************************/
+
+void InferenceServer::run() {
+    std::thread batcher(&InferenceServer::batch_loop, this);
+
+    /* Accept connections, waking up regularly to notice stop requests */
+    while (!stop_requested_) {
+        pollfd listener {listen_fd_, POLLIN, 0};
+        if (::poll(&listener, 1, 100) <= 0) {
+            continue;
+        }
+
+        int fd = ::accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0) {
+            continue;
+        }
+
+        /* Connection threads are detached and counted, so finished ones do not pile up */
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        connection_fds_.insert(fd);
+        std::thread(&InferenceServer::serve_connection, this, fd).detach();
+    }
+
+    /* Unblock every connection waiting on a read and wait for their threads, then drain the batcher */
+    {
+        std::unique_lock<std::mutex> lock(connections_mutex_);
+        for (int fd : connection_fds_) {
+            ::shutdown(fd, SHUT_RDWR);
+        }
+        connections_closed_.wait(lock, [this] { return connection_fds_.empty(); });
+    }
+
+    requests_.close();
+    batcher.join();
+}
+
+void InferenceServer::request_stop() {
+    stop_requested_ = true;
+}
+
+void InferenceServer::batch_loop() {
+    std::shared_ptr<Request> request;
+    std::vector<std::shared_ptr<Request>> batch;
+    std::vector<Tensor> outputs;
+    std::vector<std::exception_ptr> errors;
+
+    while (requests_.pop(request)) {
+        batch.assign(1, request);
+        const std::chrono::steady_clock::time_point deadline = request->arrival + max_delay_;
+
+        while (static_cast<int>(batch.size()) < max_batch_size_ && requests_.pop_until(request, deadline)) {
+            batch.push_back(request);
+        }
+
+        const int batch_size = static_cast<int>(batch.size());
+        outputs.resize(batch_size);
+        errors.assign(batch_size, nullptr);
+
+        parallel_for(0, batch_size, 1, [&](const int begin, const int end) {
+            for (int i = begin; i < end; ++i) {
+                try {
+                    outputs[i] = network_.predict(batch[i]->input);
+                }
+                catch (...) {
+                    errors[i] = std::current_exception();
+                }
+            }
+        });
+
+        for (int i = 0; i < batch_size; ++i) {
+            if (errors[i]) {
+                batch[i]->result.set_exception(errors[i]);
+            }
+            else {
+                batch[i]->result.set_value(outputs[i]);
+            }
+        }
+
+        record_batch(batch, std::chrono::steady_clock::now());
+    }
+}
+
+void InferenceServer::serve_connection(const int fd) {
+    const uint32_t input_size = static_cast<uint32_t>(input_depth_ * input_rows_ * input_columns_);
+    std::vector<float> values;
+    uint32_t type = 0;
+
+    while (inference_protocol::read_u32(fd, type)) {
+        if (type == inference_protocol::stats_request) {
+            if (!inference_protocol::write_response(fd, inference_protocol::status_ok, get_stats_json())) {
+                break;
+            }
+            continue;
+        }
+
+        uint32_t count = 0;
+        if (type != inference_protocol::predict_request || !inference_protocol::read_u32(fd, count)) {
+            break;
+        }
+
+        /* The payload of a wrong sized request is neither allocated nor read, the connection is dropped */
+        if (count != input_size) {
+            inference_protocol::write_response(fd, inference_protocol::status_error, std::string("invalid input size"));
+            break;
+        }
+
+        values.resize(count);
+        if (!inference_protocol::read_exact(fd, values.data(), count * sizeof(float))) {
+            break;
+        }
+
+        std::shared_ptr<Request> request = std::make_shared<Request>();
+        request->input = Tensor(input_depth_, input_rows_, input_columns_);
+        for (int i = 0; i < input_depth_; ++i) {
+            for (int j = 0; j < input_rows_; ++j) {
+                for (int k = 0; k < input_columns_; ++k) {
+                    request->input(i)(j, k) = values[(i * input_rows_ + j) * input_columns_ + k];
+                }
+            }
+        }
+        request->arrival = std::chrono::steady_clock::now();
+
+        std::future<Tensor> result = request->result.get_future();
+        if (!requests_.push(request)) {
+            break;
+        }
+
+        bool written = false;
+        try {
+            Tensor output = result.get();
+            std::vector<float> response;
+            for (int i = 0; i < output.get_depth(); ++i) {
+                for (int j = 0; j < output.get_num_rows(); ++j) {
+                    for (int k = 0; k < output.get_num_columns(); ++k) {
+                        response.push_back(static_cast<float>(output(i)(j, k)));
+                    }
+                }
+            }
+            written = inference_protocol::write_response(fd, inference_protocol::status_ok, response);
+        }
+        catch (const std::exception& e) {
+            written = inference_protocol::write_response(fd, inference_protocol::status_error, std::string(e.what()));
+        }
+
+        if (!written) {
+            break;
+        }
+    }
+
+    /* Notified under the lock, which is the last use of this, since run may return as soon as it is released */
+    std::lock_guard<std::mutex> lock(connections_mutex_);
+    connection_fds_.erase(fd);
+    ::close(fd);
+    connections_closed_.notify_all();
+}
+
+/******************************************************
+ * Statistics
+ *****************************************************/
+
+void InferenceServer::record_batch(const std::vector<std::shared_ptr<Request>>& batch, const std::chrono::steady_clock::time_point& completion) {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+
+    for (const std::shared_ptr<Request>& request : batch) {
+        recent_latencies_us_.push_back(std::chrono::duration<double, std::micro>(completion - request->arrival).count());
+        if (recent_latencies_us_.size() > latency_window) {
+            recent_latencies_us_.pop_front();
+        }
+    }
+
+    num_requests_ += static_cast<long>(batch.size());
+    ++num_batches_;
+}
+
+std::string InferenceServer::get_stats_json() const {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time_).count();
+    std::vector<double> latencies(recent_latencies_us_.begin(), recent_latencies_us_.end());
+
+    std::stringstream ss;
+    ss << "{\"requests\":" << num_requests_
+       << ",\"batches\":" << num_batches_
+       << ",\"mean_batch_size\":" << (num_batches_ > 0 ? static_cast<double>(num_requests_) / num_batches_ : 0.0)
+       << ",\"throughput_per_second\":" << (elapsed > 0.0 ? num_requests_ / elapsed : 0.0)
+       << ",\"latency_p50_us\":" << (latencies.empty() ? 0.0 : utility::percentile(latencies, 0.50))
+       << ",\"latency_p99_us\":" << (latencies.empty() ? 0.0 : utility::percentile(latencies, 0.99))
+       << "}";
+    return ss.str();
+}
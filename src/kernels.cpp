@@ -0,0 +1,429 @@
+#include <string>
+#include <vector>
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <atomic>
+#include <stdexcept>
+#include "kernels.hpp"
+#include "utility.hpp"
+
+/* Variants are only built where GCC style target attributes and cpuid exist */
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define KERNELS_MULTI_ISA 1
+#else
+#define KERNELS_MULTI_ISA 0
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define KERNEL_BODY inline __attribute__((always_inline))
+#else
+#define KERNEL_BODY inline
+#endif
+
+namespace {
+
+    /******************************************************
+     * Kernel bodies
+     *****************************************************/
+
+    /* Written once and inlined into every variant, where the compiler vectorizes
+     * them for that variant's instruction set. The innermost loops run across
+     * independent outputs, so vectorizing them never reorders a sum. */
+
+    KERNEL_BODY void multiply_body(const double* __restrict a, const double* __restrict b, double* __restrict result,
+                                   const int rows, const int inner, const int columns) {
+        for (int i = 0; i < rows; ++i) {
+            double* __restrict result_row = result + i * columns;
+            for (int j = 0; j < columns; ++j) {
+                result_row[j] = 0.0;
+            }
+
+            /* Four terms per pass over the row, added left to right so each sum keeps its order */
+            int k = 0;
+            for (; k + 4 <= inner; k += 4) {
+                const double a0 = a[i * inner + k];
+                const double a1 = a[i * inner + k + 1];
+                const double a2 = a[i * inner + k + 2];
+                const double a3 = a[i * inner + k + 3];
+                const double* __restrict b0 = b + k * columns;
+                const double* __restrict b1 = b0 + columns;
+                const double* __restrict b2 = b1 + columns;
+                const double* __restrict b3 = b2 + columns;
+                for (int j = 0; j < columns; ++j) {
+                    result_row[j] = result_row[j] + a0 * b0[j] + a1 * b1[j] + a2 * b2[j] + a3 * b3[j];
+                }
+            }
+            for (; k < inner; ++k) {
+                const double a_ik = a[i * inner + k];
+                const double* __restrict b_row = b + k * columns;
+                for (int j = 0; j < columns; ++j) {
+                    result_row[j] += a_ik * b_row[j];
+                }
+            }
+        }
+    }
+
+    KERNEL_BODY void correlate_accumulate_body(const double* __restrict input, const int rows, const int columns,
+                                               const double* __restrict filter, const int filter_rows,
+                                               const int filter_columns, const int stride, double* __restrict result,
+                                               double* __restrict sums) {
+        const int result_rows = (rows - filter_rows) / stride + 1;
+        const int result_columns = (columns - filter_columns) / stride + 1;
+        const int num_weights = filter_rows * filter_columns;
+
+        for (int i = 0; i < result_rows; ++i) {
+            for (int j = 0; j < result_columns; ++j) {
+                sums[j] = 0.0;
+            }
+
+            /* Each output's terms are added in the same row-major filter order as a scalar loop would,
+             * three filter weights per pass over the row */
+            const double* __restrict window_row = input + i * stride * columns;
+            int t = 0;
+            for (; t + 3 <= num_weights; t += 3) {
+                const double* __restrict window0 = window_row + (t / filter_columns) * columns + t % filter_columns;
+                const double* __restrict window1 = window_row + ((t + 1) / filter_columns) * columns + (t + 1) % filter_columns;
+                const double* __restrict window2 = window_row + ((t + 2) / filter_columns) * columns + (t + 2) % filter_columns;
+                const double weight0 = filter[t];
+                const double weight1 = filter[t + 1];
+                const double weight2 = filter[t + 2];
+                for (int j = 0; j < result_columns; ++j) {
+                    sums[j] = sums[j] + window0[j * stride] * weight0 + window1[j * stride] * weight1 +
+                              window2[j * stride] * weight2;
+                }
+            }
+            for (; t < num_weights; ++t) {
+                const double* __restrict window = window_row + (t / filter_columns) * columns + t % filter_columns;
+                const double weight = filter[t];
+                for (int j = 0; j < result_columns; ++j) {
+                    sums[j] += window[j * stride] * weight;
+                }
+            }
+
+            double* __restrict result_row = result + i * result_columns;
+            for (int j = 0; j < result_columns; ++j) {
+                result_row[j] += sums[j];
+            }
+        }
+    }
+
+    KERNEL_BODY void max_pool_forward_body(const double* __restrict input, const int rows, const int columns,
+                                           const int window_size, const int stride, const int padding_top,
+                                           const int padding_left, double* __restrict result, const int result_rows,
+                                           const int result_columns) {
+        for (int i = 0; i < result_rows; ++i) {
+            double* __restrict result_row = result + i * result_columns;
+            for (int j = 0; j < result_columns; ++j) {
+                result_row[j] = 0.0;
+            }
+
+            for (int k = 0; k < window_size; ++k) {
+                const int row = i * stride + k - padding_top;
+                if (row < 0 || row >= rows) {
+                    continue;
+                }
+
+                for (int l = 0; l < window_size; ++l) {
+                    /* The outputs whose window column l falls inside the input */
+                    const int offset = l - padding_left;
+                    const int first = offset < 0 ? (-offset + stride - 1) / stride : 0;
+                    int last = columns - offset > 0 ? (columns - offset + stride - 1) / stride : 0;
+                    last = last < result_columns ? last : result_columns;
+
+                    const double* __restrict input_row = input + row * columns + offset;
+                    for (int j = first; j < last; ++j) {
+                        const double value = input_row[j * stride];
+                        result_row[j] = value > result_row[j] ? value : result_row[j];
+                    }
+                }
+            }
+        }
+    }
+
+    KERNEL_BODY void max_pool_backward_body(const double* __restrict input, const int rows, const int columns,
+                                            const int window_size, const int stride, const int padding_top,
+                                            const int padding_left, const double* __restrict output,
+                                            const int result_rows, const int result_columns, double* __restrict result) {
+        for (int i = 0; i < result_rows; ++i) {
+            for (int j = 0; j < result_columns; ++j) {
+                double max = 0.0;
+                int max_position = -1;
+
+                for (int k = 0; k < window_size; ++k) {
+                    const int row = i * stride + k - padding_top;
+                    if (row < 0 || row >= rows) {
+                        continue;
+                    }
+
+                    for (int l = 0; l < window_size; ++l) {
+                        const int column = j * stride + l - padding_left;
+                        if (column >= 0 && column < columns && input[row * columns + column] >= max) {
+                            max = input[row * columns + column];
+                            max_position = row * columns + column;
+                        }
+                    }
+                }
+
+                if (max_position >= 0) {
+                    result[max_position] += output[i * result_columns + j];
+                }
+            }
+        }
+    }
+
+    KERNEL_BODY void relu_body(const double* __restrict input, double* __restrict output, const int size) {
+        for (int i = 0; i < size; ++i) {
+            output[i] = input[i] > 0.0 ? input[i] : 0.0;
+        }
+    }
+
+    KERNEL_BODY void relu_derivative_body(const double* __restrict input, double* __restrict output, const int size) {
+        for (int i = 0; i < size; ++i) {
+            output[i] = input[i] <= 0.0 ? 0.0 : 1.0;
+        }
+    }
+
+    KERNEL_BODY void sigmoid_body(const double* __restrict input, double* __restrict output, const int size) {
+        for (int i = 0; i < size; ++i) {
+            output[i] = 1.0 / (1 + std::exp(-input[i]));
+        }
+    }
+
+    KERNEL_BODY void sigmoid_derivative_body(const double* __restrict input, double* __restrict output, const int size) {
+        for (int i = 0; i < size; ++i) {
+            const double sigmoid = 1.0 / (1 + std::exp(-input[i]));
+            output[i] = sigmoid * (1 - sigmoid);
+        }
+    }
+
+    /******************************************************
+     * Variants
+     *****************************************************/
+
+    struct KernelTable {
+        void (*multiply)(const double*, const double*, double*, int, int, int);
+        void (*correlate_accumulate)(const double*, int, int, const double*, int, int, int, double*, double*);
+        void (*max_pool_forward)(const double*, int, int, int, int, int, int, double*, int, int);
+        void (*max_pool_backward)(const double*, int, int, int, int, int, int, const double*, int, int, double*);
+        void (*relu)(const double*, double*, int);
+        void (*relu_derivative)(const double*, double*, int);
+        void (*sigmoid)(const double*, double*, int);
+        void (*sigmoid_derivative)(const double*, double*, int);
+    };
+
+    /* Wraps every body in a function compiled for one instruction set. FMA is not
+     * requested, and the Makefile turns off contraction for the avx512 variant that
+     * implies it: a fused multiply and add rounds once instead of twice, which would
+     * make the variants disagree in the last bit. */
+#define KERNEL_VARIANT(name, attributes)                                                                               \
+    attributes void multiply_##name(const double* a, const double* b, double* result, int rows, int inner,          \
+                                    int columns) {                                                                  \
+        multiply_body(a, b, result, rows, inner, columns);                                                          \
+    }                                                                                                                \
+    attributes void correlate_accumulate_##name(const double* input, int rows, int columns, const double* filter,    \
+                                                int filter_rows, int filter_columns, int stride, double* result,    \
+                                                double* sums) {                                                     \
+        correlate_accumulate_body(input, rows, columns, filter, filter_rows, filter_columns, stride, result, sums); \
+    }                                                                                                                \
+    attributes void max_pool_forward_##name(const double* input, int rows, int columns, int window_size, int stride, \
+                                            int padding_top, int padding_left, double* result, int result_rows,     \
+                                            int result_columns) {                                                   \
+        max_pool_forward_body(input, rows, columns, window_size, stride, padding_top, padding_left, result,         \
+                              result_rows, result_columns);                                                         \
+    }                                                                                                                \
+    attributes void max_pool_backward_##name(const double* input, int rows, int columns, int window_size, int stride,\
+                                             int padding_top, int padding_left, const double* output,               \
+                                             int result_rows, int result_columns, double* result) {                 \
+        max_pool_backward_body(input, rows, columns, window_size, stride, padding_top, padding_left, output,        \
+                               result_rows, result_columns, result);                                                \
+    }                                                                                                                \
+    attributes void relu_##name(const double* input, double* output, int size) {                                   \
+        relu_body(input, output, size);                                                                             \
+    }                                                                                                                \
+    attributes void relu_derivative_##name(const double* input, double* output, int size) {                         \
+        relu_derivative_body(input, output, size);                                                                  \
+    }                                                                                                                \
+    attributes void sigmoid_##name(const double* input, double* output, int size) {                                 \
+        sigmoid_body(input, output, size);                                                                          \
+    }                                                                                                                \
+    attributes void sigmoid_derivative_##name(const double* input, double* output, int size) {                      \
+        sigmoid_derivative_body(input, output, size);                                                               \
+    }                                                                                                                \
+    const KernelTable name##_table = {multiply_##name, correlate_accumulate_##name, max_pool_forward_##name,        \
+                                      max_pool_backward_##name, relu_##name, relu_derivative_##name,                \
+                                      sigmoid_##name, sigmoid_derivative_##name};
+
+    KERNEL_VARIANT(generic, )
+#if KERNELS_MULTI_ISA
+    KERNEL_VARIANT(sse42, __attribute__((target("sse4.2"))))
+    KERNEL_VARIANT(avx2, __attribute__((target("avx2"))))
+    KERNEL_VARIANT(avx512, __attribute__((target("avx512f,prefer-vector-width=512"))))
+#endif
+
+#undef KERNEL_VARIANT
+
+    /******************************************************
+     * Selection
+     *****************************************************/
+
+    const KernelTable& get_table(const kernels::Isa isa) {
+        switch (isa) {
+#if KERNELS_MULTI_ISA
+            case kernels::Isa::sse42:
+                return sse42_table;
+            case kernels::Isa::avx2:
+                return avx2_table;
+            case kernels::Isa::avx512:
+                return avx512_table;
+#endif
+            default:
+                return generic_table;
+        }
+    }
+
+    kernels::Isa detect_isa() {
+#if KERNELS_MULTI_ISA
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) {
+            return kernels::Isa::avx512;
+        }
+        if (__builtin_cpu_supports("avx2")) {
+            return kernels::Isa::avx2;
+        }
+        if (__builtin_cpu_supports("sse4.2")) {
+            return kernels::Isa::sse42;
+        }
+#endif
+        return kernels::Isa::generic;
+    }
+
+    /* The detected variant unless CNN_ISA names another supported one */
+    kernels::Isa select_isa() {
+        const char* value = std::getenv("CNN_ISA");
+        if (value == nullptr || *value == '\0') {
+            return detect_isa();
+        }
+
+        try {
+            const kernels::Isa isa = kernels::parse_isa(value);
+            if (kernels::is_supported(isa)) {
+                return isa;
+            }
+            std::cerr << "CNN_ISA: " << value << " is not supported by this CPU, using " << kernels::get_isa_name(detect_isa())
+                      << std::endl;
+        }
+        catch (const std::invalid_argument& error) {
+            std::cerr << error.what() << ", using " << kernels::get_isa_name(detect_isa()) << std::endl;
+        }
+        return detect_isa();
+    }
+
+    std::atomic<kernels::Isa>& current_isa() {
+        static std::atomic<kernels::Isa> isa(select_isa());
+        return isa;
+    }
+
+    const KernelTable& table() {
+        return get_table(current_isa().load(std::memory_order_relaxed));
+    }
+}
+
+/******************************************************
+ * Dispatch
+ *****************************************************/
+
+kernels::Isa kernels::get_isa() {
+    return current_isa().load(std::memory_order_relaxed);
+}
+
+void kernels::set_isa(const Isa isa) {
+    if (!is_supported(isa)) {
+        throw std::invalid_argument("Kernels set_isa: " + get_isa_name(isa) + " is not supported by this CPU");
+    }
+    current_isa().store(isa, std::memory_order_relaxed);
+}
+
+bool kernels::is_supported(const Isa isa) {
+    static const Isa detected = detect_isa();
+    return static_cast<int>(isa) <= static_cast<int>(detected);
+}
+
+std::vector<kernels::Isa> kernels::get_supported_isas() {
+    std::vector<Isa> isas;
+    for (const Isa isa : {Isa::generic, Isa::sse42, Isa::avx2, Isa::avx512}) {
+        if (is_supported(isa)) {
+            isas.push_back(isa);
+        }
+    }
+    return isas;
+}
+
+std::string kernels::get_isa_name(const Isa isa) {
+    switch (isa) {
+        case Isa::sse42:
+            return "sse4.2";
+        case Isa::avx2:
+            return "avx2";
+        case Isa::avx512:
+            return "avx512";
+        default:
+            return "generic";
+    }
+}
+
+kernels::Isa kernels::parse_isa(const std::string& name) {
+    for (const Isa isa : {Isa::generic, Isa::sse42, Isa::avx2, Isa::avx512}) {
+        if (utility::compare_ignore_case(name, get_isa_name(isa))) {
+            return isa;
+        }
+    }
+    throw std::invalid_argument("Kernels parse_isa: unknown instruction set " + name);
+}
+
+/******************************************************
+ * Kernels
+ *****************************************************/
+
+void kernels::multiply(const double* a, const double* b, double* result, const int rows, const int inner, const int columns) {
+    table().multiply(a, b, result, rows, inner, columns);
+}
+
+void kernels::correlate_accumulate(const double* input, const int rows, const int columns, const double* filter,
+                                   const int filter_rows, const int filter_columns, const int stride, double* result) {
+    /* One row of partial sums, kept per thread so the call does not allocate */
+    thread_local std::vector<double> sums;
+    sums.resize((columns - filter_columns) / stride + 1);
+
+    table().correlate_accumulate(input, rows, columns, filter, filter_rows, filter_columns, stride, result, sums.data());
+}
+
+void kernels::max_pool_forward(const double* input, const int rows, const int columns, const int window_size,
+                               const int stride, const int padding_top, const int padding_left, double* result,
+                               const int result_rows, const int result_columns) {
+    table().max_pool_forward(input, rows, columns, window_size, stride, padding_top, padding_left, result, result_rows,
+                             result_columns);
+}
+
+void kernels::max_pool_backward(const double* input, const int rows, const int columns, const int window_size,
+                                const int stride, const int padding_top, const int padding_left, const double* output,
+                                const int result_rows, const int result_columns, double* result) {
+    table().max_pool_backward(input, rows, columns, window_size, stride, padding_top, padding_left, output, result_rows,
+                              result_columns, result);
+}
+
+void kernels::relu(const double* input, double* output, const int size) {
+    table().relu(input, output, size);
+}
+
+void kernels::relu_derivative(const double* input, double* output, const int size) {
+    table().relu_derivative(input, output, size);
+}
+
+void kernels::sigmoid(const double* input, double* output, const int size) {
+    table().sigmoid(input, output, size);
+}
+
+void kernels::sigmoid_derivative(const double* input, double* output, const int size) {
+    table().sigmoid_derivative(input, output, size);
+}
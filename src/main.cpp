@@ -1,100 +1,518 @@
 #include <iostream>
 #include <chrono>
 #include <memory>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <functional>
+#include <stdexcept>
 #include "utility.hpp"
 #include "tensor.hpp"
-#include "dense_layer.hpp"
-#include "convolutional_layer.hpp"
-#include "activation_layer.hpp"
-#include "max_pool_layer.hpp"
-#include "flatten_layer.hpp"
 #include "mnist_data_set.hpp"
+#include "streaming_data_set.hpp"
+#include "augmentation.hpp"
+#include "augmentation_pipeline.hpp"
 #include "neural_network.hpp"
+#include "mnist_network.hpp"
+#include "hogwild_trainer.hpp"
+#include "pipeline_trainer.hpp"
+#include "optimizer.hpp"
+#include "sgd_optimizer.hpp"
+#include "momentum_optimizer.hpp"
+#include "adam_optimizer.hpp"
+#include "checkpoint.hpp"
+#include "checkpoint_writer.hpp"
+#include "allocation_tracker.hpp"
+#include "telemetry_reporter.hpp"
+#include "tracer.hpp"
+#include "evaluation.hpp"
 
-int main() {
+int main(int argc, char* argv[]) {
 
-    double learning_rate = 0.1;
+    double learning_rate = 0.0;
+    std::function<double(const long)> schedule = schedules::constant();
+    std::string optimizer_name = "sgd";
     int epochs = 10;
+    int hogwild_threads = 0;
+    std::vector<int> pipeline_stages;
+    int micro_batches = 4;
+    int checkpoint_segment_size = 0;
+    std::string save_path;
+    std::string load_path;
+    long checkpoint_interval = 0;
+    int checkpoint_seconds = 0;
+    std::string idx_images_path;
+    std::string idx_labels_path;
+    std::string data_cache_path;
+    std::vector<std::string> stream_shards;
+    std::vector<std::string> stream_test_shards;
+    int memory_budget_mb = 64;
+    int shuffle_buffer_size = 4096;
+    int augment_workers = 0;
+    bool profile = false;
+    bool confusion_matrix = false;
+    bool track_allocations = false;
+    double report_seconds = 10.0;
+    std::string telemetry_path;
+    std::string trace_path;
+    long trace_sample_interval = 1;
+    long trace_buffer_events = 1 << 18;
 
-    std::cout << "Loading data set..." << std::endl ;
+    auto print_usage = [argv] {
+        std::cerr << "Usage: " << argv[0] << " [--hogwild num_threads]"
+                  << " [--pipeline first_layer_of_each_stage] [--micro-batches num_micro_batches]"
+                  << " [--optimizer sgd|momentum|nesterov|adam] [--learning-rate learning_rate]"
+                  << " [--lr-schedule constant|step,factor,step_size|exponential,decay_rate,decay_steps]"
+                  << " [--gradient-checkpointing segment_size] [--save path] [--load path]"
+                  << " [--checkpoint-interval num_samples] [--checkpoint-seconds seconds]"
+                  << " [--idx images_file,labels_file] [--data-cache path]"
+                  << " [--stream train_shards --stream-test test_shards] [--memory-budget megabytes]"
+                  << " [--shuffle-buffer num_samples] [--augment num_threads] [--profile] [--confusion-matrix]"
+                  << " [--track-allocations] [--report-seconds seconds] [--telemetry path]"
+                  << " [--trace path] [--trace-sample interval] [--trace-buffer events_per_thread]" << std::endl;
+    };
 
-    MNISTDataSet dataset("data/mnist.csv");
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string argument = argv[i];
+
+            if (argument == "--hogwild" && i + 1 < argc) {
+                hogwild_threads = std::stoi(argv[++i]);
+            }
+            else if (argument == "--pipeline" && i + 1 < argc) {
+                std::stringstream ss(argv[++i]);
+                std::string token;
+                while (std::getline(ss, token, ',')) {
+                    pipeline_stages.push_back(std::stoi(token));
+                }
+            }
+            else if (argument == "--micro-batches" && i + 1 < argc) {
+                micro_batches = std::stoi(argv[++i]);
+            }
+            else if (argument == "--optimizer" && i + 1 < argc) {
+                optimizer_name = argv[++i];
+            }
+            else if (argument == "--learning-rate" && i + 1 < argc) {
+                learning_rate = std::stod(argv[++i]);
+            }
+            else if (argument == "--lr-schedule" && i + 1 < argc) {
+                std::stringstream ss(argv[++i]);
+                std::vector<std::string> tokens;
+                std::string token;
+                while (std::getline(ss, token, ',')) {
+                    tokens.push_back(token);
+                }
+
+                if (tokens.size() == 1 && tokens[0] == "constant") {
+                    schedule = schedules::constant();
+                }
+                else if (tokens.size() == 3 && tokens[0] == "step") {
+                    schedule = schedules::step_decay(std::stod(tokens[1]), std::stol(tokens[2]));
+                }
+                else if (tokens.size() == 3 && tokens[0] == "exponential") {
+                    schedule = schedules::exponential_decay(std::stod(tokens[1]), std::stol(tokens[2]));
+                }
+                else {
+                    print_usage();
+                    return 1;
+                }
+            }
+            else if (argument == "--gradient-checkpointing" && i + 1 < argc) {
+                checkpoint_segment_size = std::stoi(argv[++i]);
+            }
+            else if (argument == "--save" && i + 1 < argc) {
+                save_path = argv[++i];
+            }
+            else if (argument == "--load" && i + 1 < argc) {
+                load_path = argv[++i];
+            }
+            else if (argument == "--checkpoint-interval" && i + 1 < argc) {
+                checkpoint_interval = std::stol(argv[++i]);
+            }
+            else if (argument == "--checkpoint-seconds" && i + 1 < argc) {
+                checkpoint_seconds = std::stoi(argv[++i]);
+            }
+            else if (argument == "--idx" && i + 1 < argc) {
+                std::stringstream ss(argv[++i]);
+                std::getline(ss, idx_images_path, ',');
+                std::getline(ss, idx_labels_path, ',');
+            }
+            else if (argument == "--data-cache" && i + 1 < argc) {
+                data_cache_path = argv[++i];
+            }
+            else if ((argument == "--stream" || argument == "--stream-test") && i + 1 < argc) {
+                std::vector<std::string>& shards = argument == "--stream" ? stream_shards : stream_test_shards;
+                std::stringstream ss(argv[++i]);
+                std::string token;
+                while (std::getline(ss, token, ',')) {
+                    shards.push_back(token);
+                }
+            }
+            else if (argument == "--memory-budget" && i + 1 < argc) {
+                memory_budget_mb = std::stoi(argv[++i]);
+            }
+            else if (argument == "--shuffle-buffer" && i + 1 < argc) {
+                shuffle_buffer_size = std::stoi(argv[++i]);
+            }
+            else if (argument == "--augment" && i + 1 < argc) {
+                augment_workers = std::stoi(argv[++i]);
+            }
+            else if (argument == "--profile") {
+                profile = true;
+            }
+            else if (argument == "--confusion-matrix") {
+                confusion_matrix = true;
+            }
+            else if (argument == "--track-allocations") {
+                track_allocations = true;
+            }
+            else if (argument == "--report-seconds" && i + 1 < argc) {
+                report_seconds = std::stod(argv[++i]);
+            }
+            else if (argument == "--telemetry" && i + 1 < argc) {
+                telemetry_path = argv[++i];
+            }
+            else if (argument == "--trace" && i + 1 < argc) {
+                trace_path = argv[++i];
+            }
+            else if (argument == "--trace-sample" && i + 1 < argc) {
+                trace_sample_interval = std::stol(argv[++i]);
+            }
+            else if (argument == "--trace-buffer" && i + 1 < argc) {
+                trace_buffer_events = std::stol(argv[++i]);
+            }
+            else {
+                print_usage();
+                return 1;
+            }
+        }
+    }
+    catch (const std::logic_error&) {
+        // std::stoi and std::stod throw invalid_argument or out_of_range on a malformed number
+        print_usage();
+        return 1;
+    }
+
+    if (stream_shards.empty() != stream_test_shards.empty()) {
+        std::cerr << "--stream and --stream-test must be given together" << std::endl;
+        return 1;
+    }
+    if (!stream_shards.empty() && (hogwild_threads > 0 || !pipeline_stages.empty())) {
+        std::cerr << "--stream cannot be combined with --hogwild or --pipeline" << std::endl;
+        return 1;
+    }
+    if (augment_workers > 0 && (hogwild_threads > 0 || !pipeline_stages.empty() || !stream_shards.empty())) {
+        std::cerr << "--augment cannot be combined with --hogwild, --pipeline or --stream" << std::endl;
+        return 1;
+    }
+    if (trace_sample_interval <= 0 || trace_buffer_events <= 0) {
+        std::cerr << "--trace-sample and --trace-buffer must be greater than 0" << std::endl;
+        return 1;
+    }
+    if (report_seconds <= 0.0) {
+        std::cerr << "--report-seconds must be greater than 0" << std::endl;
+        return 1;
+    }
+    if ((checkpoint_interval > 0 || checkpoint_seconds > 0) && (hogwild_threads > 0 || !pipeline_stages.empty())) {
+        std::cerr << "--checkpoint-interval and --checkpoint-seconds cannot be combined with --hogwild or --pipeline,"
+                  << " which save with --save at the end of every epoch" << std::endl;
+        return 1;
+    }
+    if ((profile || track_allocations) && (hogwild_threads > 0 || !pipeline_stages.empty())) {
+        std::cerr << "--profile and --track-allocations cannot be combined with --hogwild or --pipeline" << std::endl;
+        return 1;
+    }
+
+    // A factory, so the synchronous baseline of --hogwild gets an optimizer of its own
+    std::function<std::shared_ptr<Optimizer>()> make_optimizer;
+    if (utility::compare_ignore_case(optimizer_name, "sgd")) {
+        make_optimizer = [] { return std::make_shared<SGDOptimizer>(); };
+        learning_rate = learning_rate > 0.0 ? learning_rate : 0.1;
+    }
+    else if (utility::compare_ignore_case(optimizer_name, "momentum") ||
+             utility::compare_ignore_case(optimizer_name, "nesterov")) {
+        const bool nesterov = utility::compare_ignore_case(optimizer_name, "nesterov");
+        make_optimizer = [nesterov] { return std::make_shared<MomentumOptimizer>(0.9, nesterov); };
+        learning_rate = learning_rate > 0.0 ? learning_rate : 0.01;
+    }
+    else if (utility::compare_ignore_case(optimizer_name, "adam")) {
+        make_optimizer = [] { return std::make_shared<AdamOptimizer>(); };
+        learning_rate = learning_rate > 0.0 ? learning_rate : 0.001;
+    }
+    else {
+        std::cerr << "Unknown optimizer: " << optimizer_name << std::endl;
+        return 1;
+    }
+    std::shared_ptr<Optimizer> optimizer = make_optimizer();
+
+    std::unique_ptr<MNISTDataSet> dataset;
+    std::unique_ptr<StreamingDataSet> train_stream;
+    std::unique_ptr<StreamingDataSet> test_stream;
+
+    if (!stream_shards.empty()) {
+        // Half the budget each, the test stream is read in order so it only needs a one sample shuffle buffer
+        const size_t stream_budget = static_cast<size_t>(memory_budget_mb) * 1024 * 1024 / 2;
+        train_stream = std::make_unique<StreamingDataSet>(stream_shards, stream_budget, shuffle_buffer_size, 0);
+        test_stream = std::make_unique<StreamingDataSet>(stream_test_shards, stream_budget, 1, 0);
+
+        std::cout << "Streaming " << train_stream->get_num_shards() << " training shards and "
+                  << test_stream->get_num_shards() << " test shards through "
+                  << (train_stream->get_buffer_bytes() + test_stream->get_buffer_bytes()) / 1024.0 << "KB of buffers" << std::endl;
+    }
+    else {
+        std::cout << "Loading data set..." << std::endl ;
+
+        if (!idx_images_path.empty() && data_cache_path.empty()) {
+            data_cache_path = idx_images_path + ".cache";
+        }
+
+        dataset = idx_images_path.empty() ? std::make_unique<MNISTDataSet>("data/mnist.csv") :
+                                            std::make_unique<MNISTDataSet>(idx_images_path, idx_labels_path, data_cache_path);
+        std::cout << "Loaded " << (dataset->get_train_size() + dataset->get_test_size()) << " samples in "
+                  << dataset->get_load_time().count() << "ms (" << dataset->get_memory_bytes() / 1024.0 << "KB"
+                  << (dataset->get_loaded_from_cache() ? ", from cache" : "") << ")" << std::endl;
+    }
     
-    std::unique_ptr<Layer> layer0 = std::make_unique<ConvolutionalLayer>(16, 1, 28, 28, 3, 3, learning_rate);
-    std::unique_ptr<Layer> layer1 = std::make_unique<ActivationLayer>("relu");
-    std::unique_ptr<Layer> layer2 = std::make_unique<MaxPoolLayer>(2, 2);
-    std::unique_ptr<Layer> layer3 = std::make_unique<ConvolutionalLayer>(16 * 2, 16, 13, 13, 3, 3, learning_rate);
-    std::unique_ptr<Layer> layer4 = std::make_unique<ActivationLayer>("relu");
-    std::unique_ptr<Layer> layer5 = std::make_unique<MaxPoolLayer>(2, 2);
-    std::unique_ptr<Layer> layer6 = std::make_unique<FlattenLayer>(16 * 2, 6, 6);
-    std::unique_ptr<Layer> layer7 = std::make_unique<DenseLayer>(16 * 2 * 6 * 6, 100, learning_rate);
-    std::unique_ptr<Layer> layer8 = std::make_unique<ActivationLayer>("sigmoid");
-    std::unique_ptr<Layer> layer9 = std::make_unique<DenseLayer>(100, 10, learning_rate);
-    std::unique_ptr<Layer> layer10 = std::make_unique<ActivationLayer>("sigmoid");
-
-    NeuralNetwork network;
-    network.add_layer(std::move(layer0));
-    network.add_layer(std::move(layer1));
-    network.add_layer(std::move(layer2));
-    network.add_layer(std::move(layer3));
-    network.add_layer(std::move(layer4));
-    network.add_layer(std::move(layer5));
-    network.add_layer(std::move(layer6));
-    network.add_layer(std::move(layer7));
-    network.add_layer(std::move(layer8));
-    network.add_layer(std::move(layer9));
-    network.add_layer(std::move(layer10));
+    checkpoint::Position start = {0, 0};
+    NeuralNetwork network = load_path.empty() ? create_mnist_network(learning_rate) : checkpoint::load(load_path, optimizer, start);
+    optimizer->set_schedule(schedule);
+    network.set_optimizer(optimizer);
+    network.set_checkpoint_segment_size(checkpoint_segment_size);
+    network.set_profiling(profile);
+
+    std::vector<std::string> layer_names;
+    for (int i = 0; i < network.get_num_layers(); ++i) {
+        layer_names.push_back(std::to_string(i) + " " + network.get_layer(i).get_name());
+    }
+    if (track_allocations) {
+        AllocationTracker::get_global().enable(network.get_num_layers());
+    }
+
+    // Hogwild is compared against a synchronous copy that starts from the same weights and optimizer state
+    std::unique_ptr<HogwildTrainer> hogwild_trainer;
+    std::unique_ptr<NeuralNetwork> sync_network;
+    if (hogwild_threads > 0) {
+        hogwild_trainer = std::make_unique<HogwildTrainer>(network, hogwild_threads);
+
+        std::shared_ptr<Optimizer> sync_optimizer = make_optimizer();
+        checkpoint::Position sync_start = {0, 0};
+        sync_network = std::make_unique<NeuralNetwork>(load_path.empty() ? create_mnist_network(learning_rate) :
+                                                                           checkpoint::load(load_path, sync_optimizer, sync_start));
+        const std::vector<Parameter> parameters = network.get_parameters();
+        const std::vector<Parameter> sync_parameters = sync_network->get_parameters();
+        for (size_t i = 0; i < parameters.size(); ++i) {
+            *sync_parameters[i].value = *parameters[i].value;
+        }
+        sync_optimizer->set_schedule(schedule);
+        sync_network->set_optimizer(sync_optimizer);
+    }
+
+    std::unique_ptr<PipelineTrainer> pipeline_trainer;
+    if (!pipeline_stages.empty()) {
+        pipeline_trainer = std::make_unique<PipelineTrainer>(network, pipeline_stages, micro_batches);
+    }
+
+    std::unique_ptr<AugmentationPipeline> augmentation_pipeline;
+    if (augment_workers > 0) {
+        augmentation_pipeline = std::make_unique<AugmentationPipeline>(*dataset, augmentation::default_options(),
+                                                                       augment_workers, 32, 4 * augment_workers, 0);
+    }
+
+    std::unique_ptr<CheckpointWriter> checkpoint_writer;
+    if (!save_path.empty()) {
+        checkpoint_writer = std::make_unique<CheckpointWriter>(save_path, checkpoint_interval, std::chrono::seconds(checkpoint_seconds));
+    }
+
+    if (!load_path.empty()) {
+        std::cout << "Resuming at epoch " << (start.epoch + 1) << " sample " << start.sample << std::endl;
+    }
+
+    // Hogwild and pipeline training report once per epoch
+    std::unique_ptr<TelemetryReporter> telemetry;
+    if (!hogwild_trainer && !pipeline_trainer) {
+        telemetry = std::make_unique<TelemetryReporter>(
+            std::chrono::milliseconds(static_cast<long>(report_seconds * 1000)), telemetry_path);
+    }
+
+    if (!trace_path.empty()) {
+        Tracer::get_global().enable(trace_buffer_events, trace_sample_interval);
+    }
+    const int load_trace = Tracer::get_global().intern("load sample", "data");
 
     std::cout << "Starting training..." << std::endl;
  
-    for (int epoch = 0; epoch < epochs; ++epoch) {
+    long streamed_samples = 0;
+    for (int epoch = start.epoch; epoch < epochs; ++epoch) {
 
         std::cout << "************ Epoch " << (epoch + 1) << "/" << epochs << " ************" << std::endl;
 
         auto beg = std::chrono::high_resolution_clock::now();
+        const int first_sample = epoch == start.epoch ? start.sample : 0;
+        long num_trained = 0;
+
+        // Seeded by epoch, so a resumed run sees the same order
+        if (dataset) {
+            dataset->shuffle(epoch);
+        }
 
         // Train
-        for (int i = 0; i < dataset.get_train_size(); ++i) {
+        if (hogwild_trainer) {
+            std::cout << "Training asynchronously on " << hogwild_trainer->get_num_threads() << " threads..." << std::endl;
+            hogwild_trainer->train(*dataset, first_sample);
+            num_trained = dataset->get_train_size() - first_sample;
+        }
+        else if (pipeline_trainer) {
+            std::cout << "Training in a pipeline of " << pipeline_trainer->get_num_stages() << " stages with "
+                      << pipeline_trainer->get_num_micro_batches() << " micro-batches..." << std::endl;
+            pipeline_trainer->train(*dataset, first_sample);
+            num_trained = dataset->get_train_size() - first_sample;
+        }
+        else if (augmentation_pipeline) {
+            AugmentationPipeline::Batch batch;
+            int position = first_sample;
+
+            augmentation_pipeline->start_epoch(epoch, first_sample);
+            telemetry->start_epoch(epoch, first_sample, dataset->get_train_size());
+            while (augmentation_pipeline->next(batch)) {
+                for (size_t j = 0; j < batch.data.size(); ++j) {
+                    Tensor output = network.train(batch.data[j], batch.labels[j]);
+                    telemetry->record(output, batch.labels[j]);
+                    ++num_trained;
+                    ++position;
+
+                    if (checkpoint_writer) {
+                        checkpoint_writer->on_sample(network, {epoch, position});
+                    }
+                }
+            }
+            telemetry->end_epoch();
 
-            std::cout << "Training iteration: " << (i + 1) << "/" << dataset.get_train_size() << std::flush;
+            std::cout << "Augmented " << augmentation_pipeline->get_num_batches() << " batches on "
+                      << augmentation_pipeline->get_num_workers() << " threads, training waited for "
+                      << augmentation_pipeline->get_num_starved() << " of them for "
+                      << augmentation_pipeline->get_starved_time().count() / 1000.0 << "ms" << std::endl;
+        }
+        else if (train_stream) {
+            Tensor tensor_in;
+            Tensor expected_out;
 
-            Tensor tensor_in = dataset.get_train_data(i);
-            Tensor expected_out = dataset.get_train_label(i);
+            // The stream is seeded by epoch, so skipping the samples already trained resumes exactly
+            train_stream->start_pass(epoch);
+            for (int i = 0; i < first_sample && train_stream->next(tensor_in, expected_out); ++i) {}
 
-            network.train(tensor_in, expected_out);
+            // The stream size is unknown until the first pass ends, so the ETA assumes it has not changed
+            telemetry->start_epoch(epoch, first_sample, streamed_samples);
+            while (train_stream->next(tensor_in, expected_out)) {
+                Tensor output = network.train(tensor_in, expected_out);
+                telemetry->record(output, expected_out);
+                ++num_trained;
 
-            std::cout << "\r";
+                if (checkpoint_writer) {
+                    checkpoint_writer->on_sample(network, {epoch, train_stream->get_num_samples()});
+                }
+            }
+            telemetry->end_epoch();
+            streamed_samples = train_stream->get_num_samples();
+
+            std::cout << "Waited " << train_stream->get_stall_time().count() / 1000.0 << "ms for data" << std::endl;
         }
+        else {
+            Tensor tensor_in;
+            Tensor expected_out;
+
+            telemetry->start_epoch(epoch, first_sample, dataset->get_train_size());
+            for (int i = first_sample; i < dataset->get_train_size(); ++i) {
+                {
+                    TraceScope trace(load_trace);
+                    dataset->get_train_data(i, tensor_in);
+                    dataset->get_train_label(i, expected_out);
+                }
 
-        std::cout << std::endl;
+                Tensor output = network.train(tensor_in, expected_out);
+                telemetry->record(output, expected_out);
+                ++num_trained;
+
+                if (checkpoint_writer) {
+                    checkpoint_writer->on_sample(network, {epoch, i + 1});
+                }
+            }
+            telemetry->end_epoch();
+        }
 
         auto end = std::chrono::high_resolution_clock::now();
 
-        std::cout << "Predicting..." << std::endl;
+        // The baseline trains on the same samples in the same order, after Hogwild so the two are timed apart
+        std::chrono::milliseconds sync_duration(0);
+        if (sync_network) {
+            std::cout << "Training synchronously for comparison..." << std::endl;
+            auto sync_beg = std::chrono::high_resolution_clock::now();
 
-        int num_correct = 0;
+            Tensor tensor_in;
+            Tensor expected_out;
+            for (int i = first_sample; i < dataset->get_train_size(); ++i) {
+                dataset->get_train_data(i, tensor_in);
+                dataset->get_train_label(i, expected_out);
+                sync_network->train(tensor_in, expected_out);
+            }
+
+            sync_duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - sync_beg);
+        }
+
+        std::cout << "Predicting..." << std::endl;
 
         // Test
-        for (int i = 0; i < dataset.get_test_size(); ++i) {
+        const evaluation::Evaluation evaluated = test_stream ? evaluation::evaluate(network, *test_stream)
+                                                             : evaluation::evaluate(network, *dataset);
 
-            Tensor tensor_in = dataset.get_test_data(i);
-            Tensor expected_out = dataset.get_test_label(i);
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - beg);
 
-            Tensor result = network.predict(tensor_in);
+        auto print_result = [num_trained](const std::string& label, const evaluation::Evaluation& result,
+                                          const std::chrono::milliseconds time) {
+            double throughput = time.count() > 0 ? num_trained * 1000.0 / time.count() : 0.0;
+            std::cout << label << "Accuracy: " << (result.accuracy * 100) << "% Loss: " << result.loss << " Time: " << time.count() << "ms"
+                      << " Throughput: " << throughput << " samples/s" << std::endl;
+        };
 
-            int predicted = utility::argmax(result);
-            int expected = utility::argmax(expected_out);
-            
-            if (predicted == expected) {
-                ++num_correct;
-            }
+        if (sync_network) {
+            print_result("Hogwild:     ", evaluated, duration);
+            print_result("Synchronous: ", evaluation::evaluate(*sync_network, *dataset), sync_duration);
+        }
+        else {
+            print_result("", evaluated, duration);
         }
 
-        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - beg);
+        if (!pipeline_trainer) {
+            std::cout << "Peak activation memory: " << network.get_peak_activation_bytes() / 1024.0 << "KB" << std::endl;
+        }
+
+        if (confusion_matrix) {
+            std::cout << evaluation::format_confusion(evaluated);
+        }
+
+        if (profile) {
+            std::cout << network.format_profile();
+            network.reset_profile();
+        }
 
-        double accuracy = (double) num_correct / dataset.get_test_size();
+        if (track_allocations) {
+            std::cout << AllocationTracker::get_global().format_report(layer_names);
+            AllocationTracker::get_global().reset_report();
+        }
+
+        if (checkpoint_writer) {
+            checkpoint_writer->write(network, {epoch + 1, 0});
+        }
+    }
+
+    if (!trace_path.empty()) {
+        Tracer::get_global().disable();
+        Tracer::get_global().write(trace_path);
+        std::cout << "Wrote " << Tracer::get_global().get_num_events() << " trace events to " << trace_path << std::endl;
+    }
 
-        std::cout << "Accuracy: " << (accuracy * 100) << "% Time: " << duration.count() << "ms" << std::endl;
+    if (checkpoint_writer) {
+        checkpoint_writer->flush();
+        std::cout << "Wrote " << checkpoint_writer->get_num_written() << " checkpoints to " << save_path << std::endl;
     }
 
     return 0;
@@ -5,8 +5,12 @@
 #include <random>
 #include <cmath>
 #include <limits>
+#include <algorithm>
+#include <memory>
+#include <utility>
 #include "matrix.hpp"
 #include "utility.hpp"
+#include "kernels.hpp"
 
 /******************************************************
  * Constructors
@@ -19,7 +23,8 @@ Matrix::Matrix(const int rows, const int columns) {
 
     rows_ = rows;
     columns_ = columns;
-    data_.resize(rows_ * columns_, 0.0);
+    storage_.resize(rows_ * columns_, 0.0);
+    data_ = storage_.data();
 }
 
 Matrix::Matrix(const std::vector<std::vector<double>>& input_matrix) {
@@ -35,16 +40,44 @@ Matrix::Matrix(const std::vector<std::vector<double>>& input_matrix) {
         throw std::invalid_argument("Matrix constructor: input_matrix size was too large");
     }
 
-    data_.reserve(rows_ * columns_);
+    storage_.reserve(rows_ * columns_);
     for (int i = 0; i < rows_; ++i) {
-        data_.insert(data_.end(), input_matrix[i].begin(), input_matrix[i].end());
+        storage_.insert(storage_.end(), input_matrix[i].begin(), input_matrix[i].end());
     }
+    data_ = storage_.data();
 }
 
 Matrix::Matrix(const Matrix& other) {
     rows_ = other.rows_;
     columns_ = other.columns_;
-    data_ = other.data_;
+    storage_.assign(other.data_, other.data_ + other.rows_ * other.columns_);
+    data_ = storage_.data();
+}
+
+Matrix::Matrix(Matrix&& other) noexcept:
+    rows_(other.rows_),
+    columns_(other.columns_),
+    storage_(std::move(other.storage_)),
+    data_(other.data_),
+    owner_(std::move(other.owner_)) {
+
+    other.rows_ = 0;
+    other.columns_ = 0;
+    other.data_ = nullptr;
+}
+
+Matrix::Matrix(const int rows, const int columns, double* data, std::shared_ptr<void> owner) {
+    if (rows <= 0 || columns <= 0) {
+        throw std::invalid_argument("Matrix constructor: dimensions must be greater than 0");
+    }
+    if (data == nullptr) {
+        throw std::invalid_argument("Matrix constructor: external data cannot be null");
+    }
+
+    rows_ = rows;
+    columns_ = columns;
+    data_ = data;
+    owner_ = std::move(owner);
 }
 
 /******************************************************
@@ -75,6 +108,18 @@ const double& Matrix::operator()(const int row, const int column) const {
     return data_[row * columns_ + column];
 }
 
+int Matrix::get_size() const {
+    return rows_ * columns_;
+}
+
+double* Matrix::get_data() {
+    return data_;
+}
+
+const double* Matrix::get_data() const {
+    return data_;
+}
+
 double Matrix::get_minimum() const {
     double min = INFINITY;
     for (int i = 0; i < rows_ * columns_; ++i) {
@@ -141,15 +186,7 @@ Matrix Matrix::operator*(const Matrix& other) const {
     }
 
     Matrix result(rows_, other.columns_);
-    for (int i = 0; i < rows_; ++i) {
-        for (int j = 0; j < other.columns_; ++j) {
-            double sum = 0.0;
-            for (int k = 0; k < columns_; ++k) {
-                sum += (*this)(i, k) * other(k, j);
-            }
-            result(i, j) = sum;
-        }
-    }
+    multiply_into(other, result);
     return result;
 }
 
@@ -183,6 +220,18 @@ Matrix Matrix::transpose() const {
     return result;
 }
 
+void Matrix::multiply_into(const Matrix& other, Matrix& result) const {
+    if (columns_ != other.rows_) {
+        throw std::invalid_argument("Matrix multiply_into: dimensions are incompatible");
+    }
+    if (&result == this || &result == &other) {
+        throw std::invalid_argument("Matrix multiply_into: result cannot alias an operand");
+    }
+
+    result.resize(rows_, other.columns_);
+    kernels::multiply(data_, other.data_, result.data_, rows_, columns_, other.columns_);
+}
+
 /******************************************************
  * Neural network operations
  *****************************************************/
@@ -218,25 +267,7 @@ Matrix Matrix::correlate(const Matrix& filter, const int stride, const std::stri
         int padding_top = padding_rows / 2 + padding_rows % 2;
         int padding_left = padding_columns / 2 + padding_columns % 2;
 
-        for (int i = 0; i < rows_ + padding_rows - filter.rows_ + 1; i += stride) {
-            for (int j = 0; j < columns_ + padding_columns - filter.columns_ + 1; j += stride) {
-                double sum = 0.0;
-
-                for (int k = 0; k < filter.rows_; ++k) {
-                    for (int l = 0; l < filter.columns_; ++l) {
-                        if (i + k >= padding_top &&
-                            i + k < padding_top + rows_ &&
-                            j + l >= padding_left &&
-                            j + l < padding_left + columns_) {
-
-                            sum += (*this)(i + k - padding_top, j + l - padding_left) * filter(k, l);
-                        }
-                    }
-                }
-
-                result(i / stride, j / stride) = sum;
-            }
-        }
+        correlate_padded(filter, stride, padding_rows, padding_columns, padding_top, padding_left, result);
 
         return result;
     }
@@ -252,25 +283,7 @@ Matrix Matrix::correlate(const Matrix& filter, const int stride, const std::stri
         int padding_top = padding_rows / 2 + padding_rows % 2;
         int padding_left = padding_columns / 2 + padding_columns % 2;
 
-        for (int i = 0; i < rows_ + padding_rows - filter.rows_ + 1; i += stride) {
-            for (int j = 0; j < columns_ + padding_columns - filter.columns_ + 1; j += stride) {
-                double sum = 0.0;
-
-                for (int k = 0; k < filter.rows_; ++k) {
-                    for (int l = 0; l < filter.columns_; ++l) {
-                        if (i + k >= padding_top &&
-                            i + k < padding_top + rows_ &&
-                            j + l >= padding_left &&
-                            j + l < padding_left + columns_) {
-
-                            sum += (*this)(i + k - padding_top, j + l - padding_left) * filter(k, l);
-                        }
-                    }
-                }
-
-                result(i / stride, j / stride) = sum;
-            }
-        }
+        correlate_padded(filter, stride, padding_rows, padding_columns, padding_top, padding_left, result);
 
         return result;
     }
@@ -287,20 +300,7 @@ Matrix Matrix::correlate(const Matrix& filter, const int stride, const std::stri
         int result_columns = (columns_ - filter.columns_) / stride + 1;
         Matrix result(result_rows, result_columns);
 
-        for (int i = 0; i < rows_ - filter.rows_ + 1; i += stride) {
-            for (int j = 0; j < columns_ - filter.columns_ + 1; j += stride) {
-                double sum = 0.0;
-
-                for (int k = 0; k < filter.rows_; ++k) {
-                    for (int l = 0; l < filter.columns_; ++l) {
-                        sum += (*this)(i + k, j + l) * filter(k, l);
-                    }
-                }
-
-                result(i / stride, j / stride) = sum;
-            }
-        }
-
+        correlate_accumulate(filter, stride, result);
         return result;
     }
     else {
@@ -324,22 +324,33 @@ Matrix Matrix::convolve(const Matrix& filter, const int stride, const std::strin
 }
 
 Matrix Matrix::max_pool_forward(const int window_size, const int stride) const {
+    Matrix result(1, 1);
+    max_pool_forward_into(window_size, stride, result);
+    return result;
+}
+
+Matrix Matrix::max_pool_backward(const Matrix& output, const int window_size, const int stride) const {
     if (stride > window_size) {
-        throw std::invalid_argument("Matrix max_pool_forward: stride must be less than or equal to window_size");
+        throw std::invalid_argument("Matrix max_pool_backward: stride must be less than or equal to window_size");
     }
     if (stride <= 0) {
-        throw std::invalid_argument("Matrix max_pool_forward: stride must be greater than 0");
+        throw std::invalid_argument("Matrix max_pool_backward: stride must be greater than 0");
     }
     if (window_size > rows_ || window_size > columns_) {
-        throw std::invalid_argument("Matrix max_pool_forward: window_size must be less or equal to matrix dimensions");
+        throw std::invalid_argument("Matrix max_pool_backward: window_size must be less or equal to matrix dimensions");
     }
     if (get_minimum() < 0.0) {
-        throw std::logic_error("Matrix max_pool_forward: matrix contains negative numbers, cannot add zero padding");
+        throw std::logic_error("Matrix max_pool_backward: matrix contains negative numbers, cannot add zero padding");
     }
 
     int result_rows = ((rows_ - window_size) + stride - 1) / stride + 1;
     int result_columns = ((columns_ - window_size) + stride - 1) / stride + 1;
-    Matrix result(result_rows, result_columns);
+
+    if (output.rows_ != result_rows || output.columns_ != result_columns) {
+        throw std::invalid_argument("Matrix max_pool_backward: output matrix doesn't match expected output dimensions");
+    }
+
+    Matrix result(rows_, columns_);
 
     int padding_rows = (result_rows - 1) * stride + window_size - rows_;
     int padding_columns = (result_columns - 1) * stride + window_size - columns_;
@@ -347,52 +358,50 @@ Matrix Matrix::max_pool_forward(const int window_size, const int stride) const {
     int padding_top = padding_rows / 2 + padding_rows % 2;
     int padding_left = padding_columns / 2 + padding_columns % 2;
 
-    for (int i = 0; i < rows_ + padding_rows - window_size + 1; i += stride) {
-        for (int j = 0; j < columns_ + padding_columns - window_size + 1; j += stride) {
-            double max = 0.0;
+    kernels::max_pool_backward(data_, rows_, columns_, window_size, stride, padding_top, padding_left, output.data_,
+                               result_rows, result_columns, result.data_);
 
-            for (int k = 0; k < window_size; ++k) {
-                for (int l = 0; l < window_size; ++l) {
-                    if (i + k >= padding_top &&
-                        i + k < padding_top + rows_ &&
-                        j + l >= padding_left &&
-                        j + l < padding_left + columns_ &&
-                        (*this)(i + k - padding_top, j + l - padding_left) >= max) {
-
-                        max = (*this)(i + k - padding_top, j + l - padding_left);
-                    }
-                }
-            }
+    return result;
+}
 
-            result(i / stride, j / stride) = max;
-        }
+void Matrix::correlate_accumulate(const Matrix& filter, const int stride, Matrix& result) const {
+    if (stride <= 0) {
+        throw std::invalid_argument("Matrix correlate_accumulate: stride must be greater than 0");
+    }
+    if (filter.rows_ > rows_ || filter.columns_ > columns_) {
+        throw std::invalid_argument("Matrix correlate_accumulate: filter size must be less or equal to matrix dimensions");
+    }
+    if ((rows_ - filter.rows_) % stride != 0 || (columns_ - filter.columns_) % stride != 0) {
+        throw std::invalid_argument("Matrix correlate_accumulate: Valid padding is not possible for given filter and stride sizes");
+    }
+    if (result.rows_ != (rows_ - filter.rows_) / stride + 1 || result.columns_ != (columns_ - filter.columns_) / stride + 1) {
+        throw std::invalid_argument("Matrix correlate_accumulate: result dimensions do not match");
     }
 
-    return result;
+    /* Valid padding only: adds the correlation to result instead of allocating a new matrix */
+    kernels::correlate_accumulate(data_, rows_, columns_, filter.data_, filter.rows_, filter.columns_, stride, result.data_);
 }
 
-Matrix Matrix::max_pool_backward(const Matrix& output, const int window_size, const int stride) const {
+void Matrix::max_pool_forward_into(const int window_size, const int stride, Matrix& result) const {
     if (stride > window_size) {
-        throw std::invalid_argument("Matrix max_pool_backward: stride must be less than or equal to window_size");
+        throw std::invalid_argument("Matrix max_pool_forward_into: stride must be less than or equal to window_size");
     }
     if (stride <= 0) {
-        throw std::invalid_argument("Matrix max_pool_backward: stride must be greater than 0");
+        throw std::invalid_argument("Matrix max_pool_forward_into: stride must be greater than 0");
     }
     if (window_size > rows_ || window_size > columns_) {
-        throw std::invalid_argument("Matrix max_pool_backward: window_size must be less or equal to matrix dimensions");
+        throw std::invalid_argument("Matrix max_pool_forward_into: window_size must be less or equal to matrix dimensions");
     }
     if (get_minimum() < 0.0) {
-        throw std::logic_error("Matrix max_pool_backward: matrix contains negative numbers, cannot add zero padding");
+        throw std::logic_error("Matrix max_pool_forward_into: matrix contains negative numbers, cannot add zero padding");
     }
 
     int result_rows = ((rows_ - window_size) + stride - 1) / stride + 1;
     int result_columns = ((columns_ - window_size) + stride - 1) / stride + 1;
-
-    if (output.rows_ != result_rows || output.columns_ != result_columns) {
-        throw std::invalid_argument("Matrix max_pool_backward: output matrix doesn't match expected output dimensions");
+    if (&result == this) {
+        throw std::invalid_argument("Matrix max_pool_forward_into: result cannot alias the input");
     }
-
-    Matrix result(rows_, columns_);
+    result.resize(result_rows, result_columns);
 
     int padding_rows = (result_rows - 1) * stride + window_size - rows_;
     int padding_columns = (result_columns - 1) * stride + window_size - columns_;
@@ -400,32 +409,24 @@ Matrix Matrix::max_pool_backward(const Matrix& output, const int window_size, co
     int padding_top = padding_rows / 2 + padding_rows % 2;
     int padding_left = padding_columns / 2 + padding_columns % 2;
 
-    for (int i = 0; i < rows_ + padding_rows - window_size + 1; i += stride) {
-        for (int j = 0; j < columns_ + padding_columns - window_size + 1; j += stride) {
-            double max = 0.0;
-            int max_k = 0;
-            int max_l = 0;
-
-            for (int k = 0; k < window_size; ++k) {
-                for (int l = 0; l < window_size; ++l) {
-                    if (i + k >= padding_top &&
-                        i + k < padding_top + rows_ &&
-                        j + l >= padding_left &&
-                        j + l < padding_left + columns_ &&
-                        (*this)(i + k - padding_top, j + l - padding_left) >= max) {
-
-                        max = (*this)(i + k - padding_top, j + l - padding_left);
-                        max_k = k;
-                        max_l = l;
-                    }
-                }
-            }
-
-            result(i + max_k - padding_top, j + max_l - padding_left) = output(i / stride, j / stride);
-        }
+    kernels::max_pool_forward(data_, rows_, columns_, window_size, stride, padding_top, padding_left, result.data_,
+                              result_rows, result_columns);
+}
+
+void Matrix::correlate_padded(const Matrix& filter, const int stride, const int padding_rows, const int padding_columns,
+                              const int padding_top, const int padding_left, Matrix& result) const {
+    /* Zero padded copy, kept per thread so full and same padding do not allocate matrix storage */
+    thread_local std::vector<double> padded;
+    const int padded_rows = rows_ + padding_rows;
+    const int padded_columns = columns_ + padding_columns;
+    padded.assign(padded_rows * padded_columns, 0.0);
+
+    for (int i = 0; i < rows_; ++i) {
+        std::copy(data_ + i * columns_, data_ + (i + 1) * columns_, padded.begin() + (i + padding_top) * padded_columns + padding_left);
     }
 
-    return result;
+    kernels::correlate_accumulate(padded.data(), padded_rows, padded_columns, filter.data_, filter.rows_, filter.columns_,
+                                  stride, result.data_);
 }
 
 /******************************************************
@@ -437,26 +438,42 @@ Matrix& Matrix::operator=(const Matrix& other) {
         return *this;
     }
 
+    /* Assignment always leaves this matrix owning its storage */
+    if (owner_ || rows_ * columns_ != other.rows_ * other.columns_) {
+        detach(other.rows_ * other.columns_);
+    }
+
     rows_ = other.rows_;
     columns_ = other.columns_;
+    std::copy(other.data_, other.data_ + rows_ * columns_, data_);
+
+    return *this;
+}
+
+Matrix& Matrix::operator=(Matrix&& other) noexcept {
+    if (&other == this) {
+        return *this;
+    }
+
+    rows_ = other.rows_;
+    columns_ = other.columns_;
+    storage_ = std::move(other.storage_);
     data_ = other.data_;
+    owner_ = std::move(other.owner_);
+
+    other.rows_ = 0;
+    other.columns_ = 0;
+    other.data_ = nullptr;
 
     return *this;
 }
 
 void Matrix::randomize() {
-    std::random_device rd;
-    std::default_random_engine generator(rd());
-    std::normal_distribution<double> dist(0, 1);
-
-    for (int i = 0; i < rows_ * columns_; ++i) {
-        data_[i] = dist(generator);
-    }
+    randomize(0, 1);
 }
 
 void Matrix::randomize(const double mean, const double std_dev) {
-    std::random_device rd;
-    std::default_random_engine generator(rd());
+    std::default_random_engine& generator = utility::random_engine();
     std::normal_distribution<double> dist(mean, std_dev);
 
     for (int i = 0; i < rows_ * columns_; ++i) {
@@ -464,6 +481,10 @@ void Matrix::randomize(const double mean, const double std_dev) {
     }
 }
 
+void Matrix::fill(const double value) {
+    std::fill(data_, data_ + rows_ * columns_, value);
+}
+
 void Matrix::reshape(const int rows, const int columns) {
     if (rows < 1 || columns < 1) {
         throw std::invalid_argument("Matrix reshape: new dimensions cannot be zero or less");
@@ -476,6 +497,31 @@ void Matrix::reshape(const int rows, const int columns) {
     columns_ = columns;
 }
 
+void Matrix::resize(const int rows, const int columns) {
+    if (rows < 1 || columns < 1) {
+        throw std::invalid_argument("Matrix resize: new dimensions cannot be zero or less");
+    }
+
+    /* Reuses the existing storage when the size is unchanged */
+    if (rows * columns != rows_ * columns_) {
+        detach(rows * columns);
+    }
+
+    rows_ = rows;
+    columns_ = columns;
+}
+
+void Matrix::detach(const int size) {
+    if (owner_) {
+        storage_.assign(size, 0.0);
+        owner_.reset();
+    }
+    else {
+        storage_.resize(size);
+    }
+    data_ = storage_.data();
+}
+
 bool Matrix::operator==(const Matrix& other) const {
     if (rows_ != other.rows_ || columns_ != other.columns_) {
         return false;
@@ -1,3 +1,7 @@
+#include <string>
+#include <cstddef>
+#include <memory>
+#include <vector>
 #include "max_pool_layer.hpp"
 #include "tensor.hpp"
 
@@ -15,9 +19,69 @@ MaxPoolLayer::MaxPoolLayer(const int window_size, const int stride):
 
 Tensor MaxPoolLayer::forward(const Tensor& input) {
     input_ = input;
-    return input.max_pool_forward(window_size_, stride_);
+
+    Tensor output;
+    infer(input, output);
+    return output;
 }
 
 Tensor MaxPoolLayer::backward(const Tensor& output) {
     return input_.max_pool_backward(output, window_size_, stride_);
-}
\ No newline at end of file
+}
+
+/******************************************************
+ * Parameters
+ *****************************************************/
+
+std::vector<Parameter> MaxPoolLayer::get_parameters() {
+    return std::vector<Parameter>();
+}
+
+void MaxPoolLayer::infer(const Tensor& input, Tensor& output) const {
+    input.max_pool_forward_into(window_size_, stride_, output);
+}
+
+/******************************************************
+ * Forward caches
+ *****************************************************/
+
+void MaxPoolLayer::clear_cache() {
+    input_ = Tensor();
+}
+
+size_t MaxPoolLayer::get_cache_bytes() const {
+    return input_.get_size() * sizeof(double);
+}
+
+/******************************************************
+ * Replication
+ *****************************************************/
+
+std::unique_ptr<Layer> MaxPoolLayer::replicate() const {
+    return std::unique_ptr<Layer>(new MaxPoolLayer(window_size_, stride_));
+}
+
+/******************************************************
+ * Serialization
+ *****************************************************/
+
+std::string MaxPoolLayer::get_name() const {
+    return "max_pool";
+}
+
+std::vector<double> MaxPoolLayer::get_config() const {
+    return {static_cast<double>(window_size_), static_cast<double>(stride_)};
+}
+
+/******************************************************
+ * Profiling
+ *****************************************************/
+
+double MaxPoolLayer::get_forward_flops(const Tensor& input) const {
+    /* One comparison per input element covered by a window */
+    return input.get_size();
+}
+
+double MaxPoolLayer::get_backward_flops(const Tensor& input) const {
+    return input.get_size();
+}
@@ -1,101 +1,166 @@
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <vector>
-#include <iostream>
-#include <fstream>
-#include <sstream>
+#include <chrono>
 #include <algorithm>
+#include <numeric>
 #include <cmath>
+#include <cstring>
 #include <stdexcept>
+#include <fstream>
+#include <cstdio>
+#include <random>
+#include <limits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "mnist_data_set.hpp"
+#include "mnist_record.hpp"
+#include "sample_view.hpp"
+#include "thread_pool.hpp"
 
-/******************************************************
- * Constructors
- *****************************************************/
+namespace {
+    using mnist_record::image_rows;
+    using mnist_record::image_columns;
+    using mnist_record::num_classes;
+    using mnist_record::num_pixels;
+    using mnist_record::record_bytes;
+    using mnist_record::find_line_end;
+    using mnist_record::is_blank;
+    using mnist_record::parse_csv_line;
 
-MNISTDataSet::MNISTDataSet(const std::string& file_path) {
+    const size_t chunk_bytes = 1 << 20;
+    const int shuffle_block_size = 64;
+    const unsigned split_seed = 0;
 
-    std::ifstream file(file_path);
-    std::vector<std::vector<double>> one_hot_labels;
-    std::vector<std::vector<double>> pixel_values;
-    
-    /* Get file data */
-    if (file.is_open()) {
-        std::string line;
-        std::getline(file, line);
+    /* Read-only mapping of a whole file, unmapped when it goes out of scope */
+    class MappedFile {
+    public:
+        MappedFile(const std::string& path): data_(nullptr), size_(0) {
+            const int fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0) {
+                throw std::runtime_error("MNISTDataSet constructor: failed to open " + path);
+            }
 
-        while (std::getline(file, line)) {
-            std::stringstream ss(line);
-            std::string token;
+            struct stat status;
+            if (fstat(fd, &status) != 0 || status.st_size == 0) {
+                close(fd);
+                throw std::runtime_error("MNISTDataSet constructor: " + path + " is empty");
+            }
 
-            std::getline(ss, token, ',');
-            int label = std::stoi(token);
+            size_ = status.st_size;
+            void* address = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+            if (address == MAP_FAILED) {
+                throw std::runtime_error("MNISTDataSet constructor: failed to map " + path);
+            }
+            madvise(address, size_, MADV_SEQUENTIAL);
+            data_ = static_cast<const char*>(address);
+        }
 
-            std::vector<double> one_hot(10, 0.0);
-            one_hot[label] = 1.0;
-            one_hot_labels.push_back(one_hot);
+        MappedFile(const MappedFile& other) = delete;
+        MappedFile& operator=(const MappedFile& other) = delete;
 
-            std::vector<double> pixels;
-            while (std::getline(ss, token, ',')) {
-                double pixel_value = std::stod(token);
-                pixels.push_back(pixel_value);
-            }
-            pixel_values.push_back(pixels);
+        ~MappedFile() {
+            munmap(const_cast<char*>(data_), size_);
+        }
+
+        const char* begin() const {
+            return data_;
         }
-        file.close();
-    }
 
-    /* Normalize data */
-    for (size_t i = 0; i < pixel_values.size(); ++i) {
-        for (size_t j = 0; j < pixel_values[i].size(); ++j) {
-            pixel_values[i][j] /= 255.0;
+        const char* end() const {
+            return data_ + size_;
         }
+
+        size_t size() const {
+            return size_;
+        }
+
+    private:
+        const char* data_;
+        size_t size_;
+    };
+
+    /* IDX files start with a big endian magic number followed by one big endian uint32 per dimension */
+    const uint32_t idx_images_magic = 0x00000803;
+    const uint32_t idx_labels_magic = 0x00000801;
+
+    uint32_t read_big_endian(const char* data) {
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+        return (static_cast<uint32_t>(bytes[0]) << 24) | (static_cast<uint32_t>(bytes[1]) << 16) |
+               (static_cast<uint32_t>(bytes[2]) << 8) | static_cast<uint32_t>(bytes[3]);
     }
 
-    /* Shuffle the data */
-    std::vector<std::vector<double>> data_set;
-    for (size_t i = 0; i < one_hot_labels.size(); ++i) {
-        data_set.push_back(std::vector<double>());
-        data_set.back().insert(data_set.back().end(), one_hot_labels[i].begin(), one_hot_labels[i].end());
-        data_set.back().insert(data_set.back().end(), pixel_values[i].begin(), pixel_values[i].end());
+    /* Cache layout: char[8] magic, uint32 version, uint32 record bytes, uint64 num_samples, uint64 train size,
+     * uint64 fingerprint count, the fingerprint values, int32 train then test indices, then the records */
+    const char cache_magic[8] = {'C', 'N', 'N', 'M', 'N', 'I', 'S', 'T'};
+    const uint32_t cache_version = 2;
+
+    struct CacheHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t record_bytes;
+        uint64_t num_samples;
+        uint64_t train_size;
+        uint64_t fingerprint_count;
+    };
+
+    /* Size and modification time of every source file, a cache built from other contents is stale */
+    std::vector<uint64_t> fingerprint(const std::vector<std::string>& paths) {
+        std::vector<uint64_t> values;
+
+        for (const std::string& path : paths) {
+            struct stat status;
+            if (stat(path.c_str(), &status) != 0) {
+                throw std::runtime_error("MNISTDataSet constructor: failed to open " + path);
+            }
+            values.push_back(status.st_size);
+            values.push_back(status.st_mtim.tv_sec);
+            values.push_back(status.st_mtim.tv_nsec);
+        }
+
+        return values;
     }
-    std::random_shuffle(data_set.begin(), data_set.end());
+}
 
-    /* Split into train and test sets */
-    const double train_ratio = 0.8;
-    const size_t train_size = std::floor(data_set.size() * train_ratio);
-    auto train_end = data_set.begin() + train_size;
-    auto train = std::vector<std::vector<double>>(data_set.begin(), train_end);
-    auto test = std::vector<std::vector<double>>(train_end, data_set.end());
-
-    /* Separate labels and data */
-    for (size_t i = 0; i < train.size(); ++i) {
-        std::vector<double> label_vec(train[i].begin(), train[i].begin() + 10);
-        Matrix label_matrix({label_vec});
-        Tensor label_tensor(label_matrix);
-        train_labels_.push_back(label_tensor);
-
-        std::vector<double> data_vec(train[i].begin() + 10, train[i].end());
-        Matrix data_matrix({data_vec});
-        Tensor data_tensor(data_matrix);
-        data_tensor.reshape(1, 28, 28);
-        train_data_.push_back(data_tensor);
-    }
-    for (size_t i = 0; i < test.size(); ++i) {
-        std::vector<double> label_vec(test[i].begin(), test[i].begin() + 10);
-        Matrix label_matrix({label_vec});
-        Tensor label_tensor(label_matrix);
-        test_labels_.push_back(label_tensor);
-
-        std::vector<double> data_vec(test[i].begin() + 10, test[i].end());
-        Matrix data_matrix({data_vec});
-        Tensor data_tensor(data_matrix);
-        data_tensor.reshape(1, 28, 28);
-        test_data_.push_back(data_tensor);
+/******************************************************
+ * Constructors
+ *****************************************************/
+
+MNISTDataSet::MNISTDataSet(const std::string& file_path):
+    loaded_from_cache_(false) {
+
+    auto load_start = std::chrono::steady_clock::now();
+
+    load_csv(file_path);
+    split();
+    shuffle(0);
+
+    load_time_ = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - load_start);
+}
+
+MNISTDataSet::MNISTDataSet(const std::string& images_path, const std::string& labels_path, const std::string& cache_path):
+    loaded_from_cache_(false) {
+
+    auto load_start = std::chrono::steady_clock::now();
+
+    const std::vector<uint64_t> sources = fingerprint({images_path, labels_path});
+    loaded_from_cache_ = !cache_path.empty() && read_cache(cache_path, sources);
+
+    if (!loaded_from_cache_) {
+        load_idx(images_path, labels_path);
+        split();
+
+        if (!cache_path.empty()) {
+            write_cache(cache_path, sources);
+        }
     }
+    shuffle(0);
 
-    /* Save train and test set sizes */
-    train_size_ = train.size();
-    test_size_ = test.size();
+    load_time_ = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - load_start);
 }
 
 /******************************************************
@@ -110,30 +175,306 @@ int MNISTDataSet::get_test_size() const {
     return test_size_;
 }
 
+std::chrono::milliseconds MNISTDataSet::get_load_time() const {
+    return load_time_;
+}
+
+bool MNISTDataSet::get_loaded_from_cache() const {
+    return loaded_from_cache_;
+}
+
+size_t MNISTDataSet::get_memory_bytes() const {
+    return samples_.size() + (train_indices_.size() + test_indices_.size()) * sizeof(int);
+}
+
 Tensor MNISTDataSet::get_train_data(const int position) const {
-    if (position < 0 || position >= train_size_) {
-        throw std::invalid_argument("MNISTDataSet get_train_data: position out of bounds");
-    }
-    return train_data_[position];
+    Tensor output;
+    get_train_data(position, output);
+    return output;
 }
 
 Tensor MNISTDataSet::get_train_label(const int position) const {
+    Tensor output;
+    get_train_label(position, output);
+    return output;
+}
+
+Tensor MNISTDataSet::get_test_data(const int position) const {
+    Tensor output;
+    get_test_data(position, output);
+    return output;
+}
+
+Tensor MNISTDataSet::get_test_label(const int position) const {
+    Tensor output;
+    get_test_label(position, output);
+    return output;
+}
+
+SampleView MNISTDataSet::get_train_sample(const int position) const {
     if (position < 0 || position >= train_size_) {
-        throw std::invalid_argument("MNISTDataSet get_train_label: position out of bounds");
+        throw std::invalid_argument("MNISTDataSet get_train_sample: position out of bounds");
     }
-    return train_labels_[position];
+    return SampleView(&samples_[train_indices_[position] * record_bytes]);
 }
 
-Tensor MNISTDataSet::get_test_data(const int position) const {
+SampleView MNISTDataSet::get_test_sample(const int position) const {
     if (position < 0 || position >= test_size_) {
-        throw std::invalid_argument("MNISTDataSet get_test_data: position out of bounds");
+        throw std::invalid_argument("MNISTDataSet get_test_sample: position out of bounds");
     }
-    return test_data_[position];
+    return SampleView(&samples_[test_indices_[position] * record_bytes]);
 }
 
-Tensor MNISTDataSet::get_test_label(const int position) const {
-    if (position < 0 || position >= test_size_) {
-        throw std::invalid_argument("MNISTDataSet get_test_label: position out of bounds");
+void MNISTDataSet::get_train_data(const int position, Tensor& output) const {
+    get_train_sample(position).copy_data(output);
+}
+
+void MNISTDataSet::get_train_label(const int position, Tensor& output) const {
+    get_train_sample(position).copy_label(output);
+}
+
+void MNISTDataSet::get_test_data(const int position, Tensor& output) const {
+    get_test_sample(position).copy_data(output);
+}
+
+void MNISTDataSet::get_test_label(const int position, Tensor& output) const {
+    get_test_sample(position).copy_label(output);
+}
+
+/******************************************************
+ * Shuffling
+ *****************************************************/
+
+void MNISTDataSet::shuffle(const unsigned seed) {
+    std::mt19937 generator(seed);
+
+    /* Start from memory order so the result only depends on the seed */
+    std::sort(train_indices_.begin(), train_indices_.end());
+
+    /* Visit the blocks in random order and the samples of each block in random order */
+    const int num_blocks = (train_size_ + shuffle_block_size - 1) / shuffle_block_size;
+    std::vector<int> blocks(num_blocks);
+    for (int i = 0; i < num_blocks; ++i) {
+        blocks[i] = i;
+    }
+    std::shuffle(blocks.begin(), blocks.end(), generator);
+
+    std::vector<int> order;
+    order.reserve(train_size_);
+    for (const int block : blocks) {
+        const auto begin = train_indices_.begin() + block * shuffle_block_size;
+        const auto end = train_indices_.begin() + std::min(train_size_, (block + 1) * shuffle_block_size);
+        const size_t block_start = order.size();
+
+        order.insert(order.end(), begin, end);
+        std::shuffle(order.begin() + block_start, order.end(), generator);
+    }
+
+    train_indices_.swap(order);
+}
+
+/******************************************************
+ * Loading
+ *****************************************************/
+
+void MNISTDataSet::load_csv(const std::string& file_path) {
+    const MappedFile file(file_path);
+
+    /* Split everything after the header into line aligned chunks */
+    std::vector<const char*> chunk_starts;
+    const char* position = std::min(find_line_end(file.begin(), file.end()) + 1, file.end());
+    while (position < file.end()) {
+        chunk_starts.push_back(position);
+        position = std::min(position + chunk_bytes, file.end());
+        position = std::min(find_line_end(position, file.end()) + 1, file.end());
+    }
+    chunk_starts.push_back(file.end());
+    const int num_chunks = chunk_starts.size() - 1;
+
+    /* Count the samples of every chunk so each one knows where its samples go */
+    std::vector<long> chunk_offsets(num_chunks + 1, 0);
+    parallel_for(0, num_chunks, 1, [&](const int begin, const int end) {
+        for (int i = begin; i < end; ++i) {
+            long count = 0;
+            for (const char* line = chunk_starts[i]; line < chunk_starts[i + 1];) {
+                const char* line_end = find_line_end(line, chunk_starts[i + 1]);
+                count += is_blank(line, line_end) ? 0 : 1;
+                line = line_end + 1;
+            }
+            chunk_offsets[i + 1] = count;
+        }
+    });
+    std::partial_sum(chunk_offsets.begin(), chunk_offsets.end(), chunk_offsets.begin());
+    const long num_samples = chunk_offsets.back();
+
+    /* Parse every chunk in parallel into its samples' records, the only copy of the data */
+    samples_.resize(num_samples * record_bytes);
+    parallel_for(0, num_chunks, 1, [&](const int begin, const int end) {
+        for (int i = begin; i < end; ++i) {
+            long sample = chunk_offsets[i];
+            long line_number = 0;
+            for (const char* line = chunk_starts[i]; line < chunk_starts[i + 1];) {
+                const char* line_end = find_line_end(line, chunk_starts[i + 1]);
+                ++line_number;
+                if (!is_blank(line, line_end)) {
+                    // Exact unless earlier chunks hold blank lines, which are not counted
+                    parse_csv_line(line, line_end, &samples_[sample * record_bytes], chunk_offsets[i] + line_number + 1);
+                    ++sample;
+                }
+                line = line_end + 1;
+            }
+        }
+    });
+}
+
+void MNISTDataSet::load_idx(const std::string& images_path, const std::string& labels_path) {
+    const MappedFile images(images_path);
+    const MappedFile labels(labels_path);
+
+    if (images.size() < 16 || read_big_endian(images.begin()) != idx_images_magic) {
+        throw std::runtime_error("MNISTDataSet constructor: " + images_path + " is not an IDX image file");
+    }
+    if (labels.size() < 8 || read_big_endian(labels.begin()) != idx_labels_magic) {
+        throw std::runtime_error("MNISTDataSet constructor: " + labels_path + " is not an IDX label file");
+    }
+
+    const size_t num_samples = read_big_endian(images.begin() + 4);
+    if (read_big_endian(images.begin() + 8) != image_rows || read_big_endian(images.begin() + 12) != image_columns) {
+        throw std::runtime_error("MNISTDataSet constructor: " + images_path + " does not hold 28x28 images");
+    }
+    if (read_big_endian(labels.begin() + 4) != num_samples) {
+        throw std::runtime_error("MNISTDataSet constructor: image and label counts differ");
+    }
+    if (images.size() < 16 + num_samples * num_pixels || labels.size() < 8 + num_samples) {
+        throw std::runtime_error("MNISTDataSet constructor: IDX file is truncated");
+    }
+
+    /* Interleave labels and pixels into records */
+    const char* pixels = images.begin() + 16;
+    const char* label_values = labels.begin() + 8;
+    samples_.resize(num_samples * record_bytes);
+    parallel_for(0, num_samples, 1024, [&](const int begin, const int end) {
+        for (int i = begin; i < end; ++i) {
+            const uint8_t label = label_values[i];
+            if (label >= num_classes) {
+                throw std::runtime_error("MNISTDataSet constructor: invalid label for sample " + std::to_string(i));
+            }
+
+            uint8_t* record = &samples_[i * record_bytes];
+            record[0] = label;
+            std::memcpy(record + 1, pixels + static_cast<size_t>(i) * num_pixels, num_pixels);
+        }
+    });
+}
+
+void MNISTDataSet::split() {
+    const int num_samples = samples_.size() / record_bytes;
+
+    /* Pick the test set at random with a fixed seed */
+    std::vector<int> order(num_samples);
+    for (int i = 0; i < num_samples; ++i) {
+        order[i] = i;
+    }
+    std::mt19937 generator(split_seed);
+    std::shuffle(order.begin(), order.end(), generator);
+
+    /* Split into train and test sets, each kept in memory order */
+    const double train_ratio = 0.8;
+    const size_t train_size = std::floor(num_samples * train_ratio);
+    train_indices_.assign(order.begin(), order.begin() + train_size);
+    test_indices_.assign(order.begin() + train_size, order.end());
+    std::sort(train_indices_.begin(), train_indices_.end());
+    std::sort(test_indices_.begin(), test_indices_.end());
+
+    /* Save train and test set sizes */
+    train_size_ = train_indices_.size();
+    test_size_ = test_indices_.size();
+}
+
+/******************************************************
+ * Cache
+ *****************************************************/
+
+bool MNISTDataSet::read_cache(const std::string& cache_path, const std::vector<uint64_t>& sources) {
+    std::ifstream file(cache_path, std::ios::binary);
+    CacheHeader header;
+
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, cache_magic, sizeof(cache_magic)) != 0 ||
+        header.version != cache_version ||
+        header.record_bytes != record_bytes ||
+        header.train_size > header.num_samples ||
+        header.fingerprint_count != sources.size()) {
+
+        return false;
+    }
+
+    /* The header must describe exactly the bytes the file holds before anything is sized from it */
+    file.seekg(0, std::ios::end);
+    const uint64_t file_size = static_cast<uint64_t>(file.tellg());
+    const uint64_t fixed_bytes = sizeof(header) + header.fingerprint_count * sizeof(uint64_t);
+    if (!file || file_size < fixed_bytes ||
+        header.num_samples > static_cast<uint64_t>(std::numeric_limits<int32_t>::max()) ||
+        file_size - fixed_bytes != header.num_samples * (sizeof(int32_t) + record_bytes)) {
+
+        return false;
+    }
+    file.seekg(sizeof(header));
+
+    std::vector<uint64_t> cached_sources(header.fingerprint_count);
+    file.read(reinterpret_cast<char*>(cached_sources.data()), cached_sources.size() * sizeof(uint64_t));
+    if (!file || cached_sources != sources) {
+        return false;
+    }
+
+    /* The indices and records are read straight into their final storage */
+    std::vector<int32_t> indices(header.num_samples);
+    file.read(reinterpret_cast<char*>(indices.data()), indices.size() * sizeof(int32_t));
+    samples_.resize(header.num_samples * record_bytes);
+    file.read(reinterpret_cast<char*>(samples_.data()), samples_.size());
+
+    /* A corrupt cache is rebuilt rather than trusted with out of range indices or labels */
+    bool valid = static_cast<bool>(file);
+    for (size_t i = 0; valid && i < indices.size(); ++i) {
+        valid = indices[i] >= 0 && static_cast<uint64_t>(indices[i]) < header.num_samples;
+    }
+    for (size_t i = 0; valid && i < header.num_samples; ++i) {
+        valid = samples_[i * record_bytes] < num_classes;
+    }
+    if (!valid) {
+        samples_.clear();
+        return false;
+    }
+
+    train_indices_.assign(indices.begin(), indices.begin() + header.train_size);
+    test_indices_.assign(indices.begin() + header.train_size, indices.end());
+    train_size_ = train_indices_.size();
+    test_size_ = test_indices_.size();
+
+    return true;
+}
+
+void MNISTDataSet::write_cache(const std::string& cache_path, const std::vector<uint64_t>& sources) const {
+    CacheHeader header = {};
+    std::memcpy(header.magic, cache_magic, sizeof(cache_magic));
+    header.version = cache_version;
+    header.record_bytes = record_bytes;
+    header.num_samples = samples_.size() / record_bytes;
+    header.train_size = train_indices_.size();
+    header.fingerprint_count = sources.size();
+
+    /* Written under a temporary name so a reader never sees a partial cache */
+    const std::string temporary_path = cache_path + ".tmp";
+    std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(sources.data()), sources.size() * sizeof(uint64_t));
+    file.write(reinterpret_cast<const char*>(train_indices_.data()), train_indices_.size() * sizeof(int));
+    file.write(reinterpret_cast<const char*>(test_indices_.data()), test_indices_.size() * sizeof(int));
+    file.write(reinterpret_cast<const char*>(samples_.data()), samples_.size());
+    file.close();
+
+    // A cache that cannot be written only costs the next run its head start
+    if (!file || std::rename(temporary_path.c_str(), cache_path.c_str()) != 0) {
+        std::remove(temporary_path.c_str());
     }
-    return test_labels_[position];
 }
@@ -0,0 +1,38 @@
+#include <memory>
+#include "mnist_network.hpp"
+#include "neural_network.hpp"
+#include "layer.hpp"
+#include "dense_layer.hpp"
+#include "convolutional_layer.hpp"
+#include "activation_layer.hpp"
+#include "max_pool_layer.hpp"
+#include "flatten_layer.hpp"
+
+NeuralNetwork create_mnist_network(const double learning_rate) {
+    std::unique_ptr<Layer> layer0 = std::make_unique<ConvolutionalLayer>(16, 1, 28, 28, 3, 3, learning_rate);
+    std::unique_ptr<Layer> layer1 = std::make_unique<ActivationLayer>("relu");
+    std::unique_ptr<Layer> layer2 = std::make_unique<MaxPoolLayer>(2, 2);
+    std::unique_ptr<Layer> layer3 = std::make_unique<ConvolutionalLayer>(16 * 2, 16, 13, 13, 3, 3, learning_rate);
+    std::unique_ptr<Layer> layer4 = std::make_unique<ActivationLayer>("relu");
+    std::unique_ptr<Layer> layer5 = std::make_unique<MaxPoolLayer>(2, 2);
+    std::unique_ptr<Layer> layer6 = std::make_unique<FlattenLayer>(16 * 2, 6, 6);
+    std::unique_ptr<Layer> layer7 = std::make_unique<DenseLayer>(16 * 2 * 6 * 6, 100, learning_rate);
+    std::unique_ptr<Layer> layer8 = std::make_unique<ActivationLayer>("sigmoid");
+    std::unique_ptr<Layer> layer9 = std::make_unique<DenseLayer>(100, 10, learning_rate);
+    std::unique_ptr<Layer> layer10 = std::make_unique<ActivationLayer>("sigmoid");
+
+    NeuralNetwork network;
+    network.add_layer(std::move(layer0));
+    network.add_layer(std::move(layer1));
+    network.add_layer(std::move(layer2));
+    network.add_layer(std::move(layer3));
+    network.add_layer(std::move(layer4));
+    network.add_layer(std::move(layer5));
+    network.add_layer(std::move(layer6));
+    network.add_layer(std::move(layer7));
+    network.add_layer(std::move(layer8));
+    network.add_layer(std::move(layer9));
+    network.add_layer(std::move(layer10));
+
+    return network;
+}
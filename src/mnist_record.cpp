@@ -0,0 +1,98 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <limits>
+#include <stdexcept>
+#include "mnist_record.hpp"
+#include "tensor.hpp"
+
+namespace {
+    /* Parses a non-negative decimal integer at position, leaving position on the character after it.
+     * Values too large for an int saturate at its maximum, which every range check rejects */
+    bool parse_int(const char*& position, const char* end, int& value) {
+        const char* start = position;
+        value = 0;
+
+        while (position < end && *position >= '0' && *position <= '9') {
+            const int digit = *position - '0';
+            value = value > (std::numeric_limits<int>::max() - digit) / 10 ? std::numeric_limits<int>::max()
+                                                                             : value * 10 + digit;
+            ++position;
+        }
+
+        return position != start;
+    }
+
+    /* Pixel value to [0, 1], shared by every copy into a tensor */
+    struct NormalizationTable {
+        double values[256];
+
+        NormalizationTable() {
+            for (int i = 0; i < 256; ++i) {
+                values[i] = i / 255.0;
+            }
+        }
+    };
+
+    const NormalizationTable normalization;
+}
+
+/******************************************************
+ * CSV lines
+ *****************************************************/
+
+const char* mnist_record::find_line_end(const char* position, const char* end) {
+    const char* newline = static_cast<const char*>(std::memchr(position, '\n', end - position));
+    return newline != nullptr ? newline : end;
+}
+
+bool mnist_record::is_blank(const char* begin, const char* end) {
+    return begin == end || (end - begin == 1 && *begin == '\r');
+}
+
+void mnist_record::parse_csv_line(const char* begin, const char* end, uint8_t* record, const long line_number) {
+    const std::string location = " on line " + std::to_string(line_number);
+    const char* position = begin;
+
+    int value = 0;
+    if (!parse_int(position, end, value) || value >= num_classes) {
+        throw std::invalid_argument("Mnist_record parse_csv_line: invalid label" + location);
+    }
+    record[0] = value;
+
+    for (int i = 1; i <= num_pixels; ++i) {
+        if (position == end || *position != ',' || !parse_int(++position, end, value)) {
+            throw std::invalid_argument("Mnist_record parse_csv_line: expected " + std::to_string(num_pixels) + " pixels" +
+                                        location);
+        }
+        if (value > 255) {
+            throw std::invalid_argument("Mnist_record parse_csv_line: pixel out of range" + location);
+        }
+        record[i] = value;
+    }
+
+    if (position != end && !is_blank(position, end)) {
+        throw std::invalid_argument("Mnist_record parse_csv_line: unexpected data after the pixels" + location);
+    }
+}
+
+/******************************************************
+ * Conversion
+ *****************************************************/
+
+void mnist_record::to_data(const uint8_t* record, Tensor& output) {
+    const uint8_t* pixels = record + 1;
+
+    output.resize(1, image_rows, image_columns);
+    double* values = output(0).get_data();
+    for (int i = 0; i < num_pixels; ++i) {
+        values[i] = normalization.values[pixels[i]];
+    }
+}
+
+void mnist_record::to_label(const uint8_t* record, Tensor& output) {
+    output.resize(1, 1, num_classes);
+    output.fill(0.0);
+    output(0)(0, record[0]) = 1.0;
+}
@@ -0,0 +1,48 @@
+#include <stdexcept>
+#include "momentum_optimizer.hpp"
+#include "optimizer.hpp"
+
+/******************************************************
+ * Constructors
+ *****************************************************/
+
+MomentumOptimizer::MomentumOptimizer(const double momentum, const bool nesterov):
+    Optimizer(1),
+    momentum_(momentum),
+    nesterov_(nesterov) {
+
+    if (momentum < 0.0 || momentum >= 1.0) {
+        throw std::invalid_argument("MomentumOptimizer constructor: momentum must be in [0, 1)");
+    }
+}
+
+/******************************************************
+ * Update
+ *****************************************************/
+
+void MomentumOptimizer::update(double* value,
+                               double* gradient,
+                               double* const* state,
+                               const int size,
+                               const double learning_rate,
+                               const double gradient_scale,
+                               const long step) const {
+    (void)step;
+    double* velocity = state[0];
+
+    if (nesterov_) {
+        for (int i = 0; i < size; ++i) {
+            const double g = gradient[i] * gradient_scale;
+            velocity[i] = momentum_ * velocity[i] + g;
+            value[i] -= learning_rate * (g + momentum_ * velocity[i]);
+            gradient[i] = 0.0;
+        }
+    }
+    else {
+        for (int i = 0; i < size; ++i) {
+            velocity[i] = momentum_ * velocity[i] + gradient[i] * gradient_scale;
+            value[i] -= learning_rate * velocity[i];
+            gradient[i] = 0.0;
+        }
+    }
+}
@@ -1,48 +1,372 @@
+#include <cstddef>
 #include <vector>
 #include <memory>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
 #include "tensor.hpp"
 #include "layer.hpp"
 #include "neural_network.hpp"
+#include "optimizer.hpp"
+#include "sgd_optimizer.hpp"
+#include "allocation_tracker.hpp"
+#include "tracer.hpp"
 
 /******************************************************
  * Constructors
  *****************************************************/
 
-NeuralNetwork::NeuralNetwork(): num_layers_(0) {}
+NeuralNetwork::NeuralNetwork():
+    num_layers_(0),
+    optimizer_(std::make_shared<SGDOptimizer>()),
+    checkpoint_segment_size_(0),
+    peak_activation_bytes_(0),
+    profiling_(false) {}
+
+/******************************************************
+ * Getters
+ *****************************************************/
+
+int NeuralNetwork::get_num_layers() const {
+    return num_layers_;
+}
+
+Layer& NeuralNetwork::get_layer(const int index) {
+    if (index < 0 || index >= num_layers_) {
+        throw std::invalid_argument("NeuralNetwork get_layer: index out of bounds");
+    }
+
+    return *layers_[index];
+}
+
+Optimizer& NeuralNetwork::get_optimizer() {
+    return *optimizer_;
+}
+
+std::vector<Parameter> NeuralNetwork::get_parameters() {
+    std::vector<Parameter> parameters;
+
+    for (int i = 0; i < num_layers_; ++i) {
+        std::vector<Parameter> layer_parameters = layers_[i]->get_parameters();
+        parameters.insert(parameters.end(), layer_parameters.begin(), layer_parameters.end());
+    }
+
+    return parameters;
+}
+
+size_t NeuralNetwork::get_peak_activation_bytes() const {
+    return peak_activation_bytes_;
+}
 
 /******************************************************
  * Setters
  *****************************************************/
 
 void NeuralNetwork::add_layer(std::unique_ptr<Layer> layer) {
+    const std::string name = std::to_string(num_layers_) + " " + layer->get_name();
+    profile_.push_back({name, {}, {}});
+    trace_names_.push_back(Tracer::get_global().intern(name + " forward", "forward"));
+    trace_names_.push_back(Tracer::get_global().intern(name + " backward", "backward"));
+    trace_names_.push_back(Tracer::get_global().intern(name + " infer", "predict"));
     layers_.push_back(std::move(layer));
     ++num_layers_;
+    parameters_.clear();
+    optimizer_states_.clear();
+}
+
+void NeuralNetwork::set_optimizer(std::shared_ptr<Optimizer> optimizer) {
+    if (!optimizer) {
+        throw std::invalid_argument("NeuralNetwork set_optimizer: optimizer cannot be null");
+    }
+
+    optimizer_ = std::move(optimizer);
+    parameters_.clear();
+    optimizer_states_.clear();
+}
+
+void NeuralNetwork::set_checkpoint_segment_size(const int segment_size) {
+    if (segment_size < 0) {
+        throw std::invalid_argument("NeuralNetwork set_checkpoint_segment_size: segment_size cannot be negative");
+    }
+
+    checkpoint_segment_size_ = segment_size;
+}
+
+void NeuralNetwork::reset_peak_activation_bytes() {
+    peak_activation_bytes_ = 0;
+}
+
+/******************************************************
+ * Profiling
+ *****************************************************/
+
+void NeuralNetwork::set_profiling(const bool enabled) {
+    profiling_ = enabled;
+}
+
+bool NeuralNetwork::is_profiling() const {
+    return profiling_;
+}
+
+const std::vector<LayerProfile>& NeuralNetwork::get_profile() const {
+    return profile_;
+}
+
+void NeuralNetwork::reset_profile() {
+    for (LayerProfile& layer_profile : profile_) {
+        layer_profile.forward = {};
+        layer_profile.backward = {};
+    }
+}
+
+std::string NeuralNetwork::format_profile() const {
+    double total_seconds = 0.0;
+    for (const LayerProfile& layer_profile : profile_) {
+        total_seconds += layer_profile.forward.seconds + layer_profile.backward.seconds;
+    }
+
+    std::ostringstream table;
+    table << std::left << std::setw(20) << "layer" << std::setw(10) << "pass" << std::right
+          << std::setw(10) << "calls" << std::setw(12) << "total ms" << std::setw(10) << "mean us"
+          << std::setw(8) << "time %" << std::setw(10) << "in MB" << std::setw(10) << "out MB"
+          << std::setw(10) << "GFLOP/s" << "\n";
+    table << std::fixed;
+
+    for (const LayerProfile& layer_profile : profile_) {
+        for (int backward = 0; backward < 2; ++backward) {
+            const PassProfile& pass = backward ? layer_profile.backward : layer_profile.forward;
+            if (pass.calls == 0) {
+                continue;
+            }
+
+            table << std::left << std::setw(20) << layer_profile.name << std::setw(10) << (backward ? "backward" : "forward")
+                  << std::right << std::setw(10) << pass.calls
+                  << std::setprecision(1) << std::setw(12) << pass.seconds * 1e3
+                  << std::setw(10) << pass.seconds * 1e6 / pass.calls
+                  << std::setw(8) << (total_seconds > 0.0 ? pass.seconds * 100.0 / total_seconds : 0.0)
+                  << std::setw(10) << pass.input_bytes / (1024.0 * 1024.0)
+                  << std::setw(10) << pass.output_bytes / (1024.0 * 1024.0)
+                  << std::setprecision(2) << std::setw(10) << (pass.seconds > 0.0 ? pass.flops / pass.seconds * 1e-9 : 0.0)
+                  << "\n";
+        }
+    }
+
+    return table.str();
+}
+
+Tensor NeuralNetwork::forward_layer(const int index, const Tensor& input) {
+    TraceScope trace(trace_names_[3 * index]);
+    set_allocation_scope(index, AllocationPass::forward);
+
+    if (!profiling_) {
+        return layers_[index]->forward(input);
+    }
+
+    auto beg = std::chrono::steady_clock::now();
+    Tensor output = layers_[index]->forward(input);
+    auto end = std::chrono::steady_clock::now();
+
+    PassProfile& pass = profile_[index].forward;
+    ++pass.calls;
+    pass.seconds += std::chrono::duration<double>(end - beg).count();
+    pass.input_bytes += input.get_size() * sizeof(double);
+    pass.output_bytes += output.get_size() * sizeof(double);
+    pass.flops += layers_[index]->get_forward_flops(input);
+    return output;
+}
+
+Tensor NeuralNetwork::backward_layer(const int index, const Tensor& output) {
+    TraceScope trace(trace_names_[3 * index + 1]);
+    set_allocation_scope(index, AllocationPass::backward);
+
+    if (!profiling_) {
+        return layers_[index]->backward(output);
+    }
+
+    auto beg = std::chrono::steady_clock::now();
+    Tensor input = layers_[index]->backward(output);
+    auto end = std::chrono::steady_clock::now();
+
+    /* The gradient returned by backward has the shape of the forward input */
+    PassProfile& pass = profile_[index].backward;
+    ++pass.calls;
+    pass.seconds += std::chrono::duration<double>(end - beg).count();
+    pass.input_bytes += output.get_size() * sizeof(double);
+    pass.output_bytes += input.get_size() * sizeof(double);
+    pass.flops += layers_[index]->get_backward_flops(input);
+    return input;
+}
+
+void NeuralNetwork::set_allocation_scope(const int layer, const AllocationPass pass) const {
+    AllocationTracker& tracker = AllocationTracker::get_global();
+    if (tracker.is_enabled()) {
+        tracker.set_scope(layer, pass);
+    }
 }
 
 /******************************************************
  * Operations
  *****************************************************/
 
-void NeuralNetwork::train(const Tensor& input, const Tensor& expected_output) {
-    Tensor result = input;
+Tensor NeuralNetwork::train(const Tensor& input, const Tensor& expected_output) {
+    static const int train_trace = Tracer::get_global().intern("train", "train");
+    static const int update_trace = Tracer::get_global().intern("update", "train");
+    Tracer::get_global().next_sample();
+    TraceScope trace(train_trace);
+
+    AllocationTracker& tracker = AllocationTracker::get_global();
+    const bool tracking = tracker.is_enabled();
+    if (tracking) {
+        tracker.begin_step();
+    }
+
+    Tensor output;
+    if (checkpoint_segment_size_ > 0) {
+        output = train_with_checkpoints(input, expected_output);
+    }
+    else {
+        output = input;
+
+        for (int i = 0; i < num_layers_; ++i) {
+            output = forward_layer(i, output);
+        }
+
+        peak_activation_bytes_ = std::max(peak_activation_bytes_, get_cache_bytes());
+        set_allocation_scope(-1, AllocationPass::other);
+        Tensor result = output - expected_output;
+
+        for (int i = num_layers_ - 1; i >= 0; --i) {
+            result = backward_layer(i, result);
+        }
+    }
+
+    set_allocation_scope(-1, AllocationPass::update);
+    {
+        TraceScope update(update_trace);
+        if (optimizer_states_.empty()) {
+            parameters_ = get_parameters();
+            optimizer_states_ = optimizer_->get_states(parameters_);
+        }
+        optimizer_->step(parameters_, optimizer_states_.data(), 1);
+    }
+
+    if (tracking) {
+        tracker.end_step();
+    }
+
+    return output;
+}
+
+Tensor NeuralNetwork::predict(const Tensor& input) const {
+    thread_local InferenceWorkspace workspace;
+    return predict(input, workspace);
+}
+
+const Tensor& NeuralNetwork::predict(const Tensor& input, InferenceWorkspace& workspace) const {
+    if (num_layers_ == 0) {
+        throw std::logic_error("NeuralNetwork predict: network has no layers");
+    }
 
+    static const int predict_trace = Tracer::get_global().intern("predict", "predict");
+    Tracer::get_global().next_sample();
+    TraceScope trace(predict_trace);
+
+    /* Layers write into the workspace only, so one network can serve several threads */
+    workspace.activations.resize(num_layers_);
+
+    const Tensor* result = &input;
     for (int i = 0; i < num_layers_; ++i) {
-        result = layers_[i]->forward(result);
+        TraceScope layer_trace(trace_names_[3 * i + 2]);
+        layers_[i]->infer(*result, workspace.activations[i]);
+        result = &workspace.activations[i];
     }
 
-    result = result - expected_output;
+    return *result;
+}
 
-    for (int i = num_layers_ - 1; i >= 0; --i) {
-        result = layers_[i]->backward(result);
+size_t NeuralNetwork::get_cache_bytes() const {
+    size_t bytes = 0;
+
+    for (int i = 0; i < num_layers_; ++i) {
+        bytes += layers_[i]->get_cache_bytes();
     }
+
+    return bytes;
 }
 
-Tensor NeuralNetwork::predict(const Tensor& input) {
+Tensor NeuralNetwork::train_with_checkpoints(const Tensor& input, const Tensor& expected_output) {
+    std::vector<Tensor> checkpoints;
+    size_t checkpoint_bytes = 0;
     Tensor result = input;
 
+    /* Forward, keeping only the input of every segment and the caches of the last one */
+    for (int begin = 0; begin < num_layers_; begin += checkpoint_segment_size_) {
+        const int end = std::min(begin + checkpoint_segment_size_, num_layers_);
+
+        set_allocation_scope(-1, AllocationPass::other);
+        checkpoints.push_back(result);
+        checkpoint_bytes += result.get_size() * sizeof(double);
+
+        for (int i = begin; i < end; ++i) {
+            result = forward_layer(i, result);
+        }
+
+        peak_activation_bytes_ = std::max(peak_activation_bytes_, get_cache_bytes() + checkpoint_bytes);
+
+        if (end < num_layers_) {
+            for (int i = begin; i < end; ++i) {
+                layers_[i]->clear_cache();
+            }
+        }
+    }
+
+    set_allocation_scope(-1, AllocationPass::other);
+    Tensor output = result;
+    result = result - expected_output;
+
+    /* Backward segment by segment, recomputing the caches of every segment but the last */
+    const int num_segments = static_cast<int>(checkpoints.size());
+    for (int segment = num_segments - 1; segment >= 0; --segment) {
+        const int begin = segment * checkpoint_segment_size_;
+        const int end = std::min(begin + checkpoint_segment_size_, num_layers_);
+
+        if (segment < num_segments - 1) {
+            set_allocation_scope(-1, AllocationPass::other);
+            Tensor recomputed = checkpoints[segment];
+            for (int i = begin; i < end; ++i) {
+                recomputed = forward_layer(i, recomputed);
+            }
+
+            peak_activation_bytes_ = std::max(peak_activation_bytes_, get_cache_bytes() + checkpoint_bytes);
+        }
+
+        for (int i = end - 1; i >= begin; --i) {
+            result = backward_layer(i, result);
+            layers_[i]->clear_cache();
+        }
+
+        checkpoint_bytes -= checkpoints[segment].get_size() * sizeof(double);
+        checkpoints.pop_back();
+    }
+
+    return output;
+}
+
+/******************************************************
+ * Replication
+ *****************************************************/
+
+NeuralNetwork NeuralNetwork::replicate() const {
+    NeuralNetwork replica;
+    replica.optimizer_ = optimizer_;
+    replica.checkpoint_segment_size_ = checkpoint_segment_size_;
+
     for (int i = 0; i < num_layers_; ++i) {
-        result = layers_[i]->forward(result);
+        replica.add_layer(layers_[i]->replicate());
     }
 
-    return result;
+    return replica;
 }
@@ -0,0 +1,191 @@
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <stdexcept>
+#include <cmath>
+#include "optimizer.hpp"
+#include "tensor.hpp"
+#include "layer.hpp"
+
+/******************************************************
+ * Constructors
+ *****************************************************/
+
+Optimizer::Optimizer(const int num_state_buffers):
+    num_state_buffers_(num_state_buffers),
+    schedule_(schedules::constant()) {
+
+    if (num_state_buffers < 0 || num_state_buffers > max_state_buffers) {
+        throw std::invalid_argument("Optimizer constructor: num_state_buffers must be between 0 and " +
+                                    std::to_string(max_state_buffers));
+    }
+}
+
+/******************************************************
+ * Getters
+ *****************************************************/
+
+int Optimizer::get_num_state_buffers() const {
+    return num_state_buffers_;
+}
+
+/******************************************************
+ * Setters
+ *****************************************************/
+
+void Optimizer::set_schedule(const std::function<double(const long)>& schedule) {
+    if (!schedule) {
+        throw std::invalid_argument("Optimizer set_schedule: schedule cannot be empty");
+    }
+
+    schedule_ = schedule;
+}
+
+/******************************************************
+ * Operations
+ *****************************************************/
+
+std::vector<Optimizer::State*> Optimizer::get_states(const std::vector<Parameter>& parameters) {
+    std::vector<State*> states;
+
+    for (const Parameter& parameter : parameters) {
+        states.push_back(&get_state(*parameter.value));
+    }
+
+    return states;
+}
+
+void Optimizer::step(const std::vector<Parameter>& parameters, State* const* states, const int batch_size) {
+    if (batch_size <= 0) {
+        throw std::invalid_argument("Optimizer step: batch_size must be greater than 0");
+    }
+
+    const double gradient_scale = 1.0 / batch_size;
+    double* state[max_state_buffers];
+
+    for (size_t p = 0; p < parameters.size(); ++p) {
+        const Parameter& parameter = parameters[p];
+        Tensor& value = *parameter.value;
+        Tensor& gradient = *parameter.gradient;
+        State& parameter_state = *states[p];
+
+        const long step = parameter_state.step.fetch_add(1, std::memory_order_relaxed) + 1;
+        const double learning_rate = parameter.learning_rate * schedule_(step - 1);
+
+        int offset = 0;
+        for (int i = 0; i < value.get_depth(); ++i) {
+            const int size = value(i).get_size();
+
+            for (int j = 0; j < num_state_buffers_; ++j) {
+                state[j] = parameter_state.buffers[j].data() + offset;
+            }
+
+            update(value(i).get_data(), gradient(i).get_data(), state, size, learning_rate, gradient_scale, step);
+            offset += size;
+        }
+    }
+}
+
+void Optimizer::step(const std::vector<Parameter>& parameters, const int batch_size) {
+    const std::vector<State*> states = get_states(parameters);
+    step(parameters, states.data(), batch_size);
+}
+
+/******************************************************
+ * Checkpointing
+ *****************************************************/
+
+std::vector<Optimizer::ParameterState> Optimizer::export_state(const std::vector<Parameter>& parameters) {
+    std::vector<ParameterState> states;
+    std::lock_guard<std::mutex> lock(states_mutex_);
+
+    for (const Parameter& parameter : parameters) {
+        ParameterState parameter_state = {0, {}};
+        auto it = states_.find(parameter.value);
+
+        if (it != states_.end()) {
+            parameter_state.step = it->second->step.load(std::memory_order_relaxed);
+            parameter_state.buffers = it->second->buffers;
+        }
+
+        states.push_back(std::move(parameter_state));
+    }
+
+    return states;
+}
+
+void Optimizer::import_state(const std::vector<Parameter>& parameters, const std::vector<ParameterState>& states) {
+    if (parameters.size() != states.size()) {
+        throw std::invalid_argument("Optimizer import_state: one state is required per parameter");
+    }
+
+    for (size_t i = 0; i < parameters.size(); ++i) {
+        if (states[i].step == 0) {
+            continue;
+        }
+
+        const size_t size = parameters[i].value->get_size();
+        if (static_cast<int>(states[i].buffers.size()) != num_state_buffers_) {
+            throw std::invalid_argument("Optimizer import_state: state was saved by a different optimizer");
+        }
+        for (const std::vector<double>& buffer : states[i].buffers) {
+            if (buffer.size() != size) {
+                throw std::invalid_argument("Optimizer import_state: state size does not match the parameter");
+            }
+        }
+
+        State& parameter_state = get_state(*parameters[i].value);
+        std::lock_guard<std::mutex> lock(states_mutex_);
+        parameter_state.step = states[i].step;
+        parameter_state.buffers = states[i].buffers;
+    }
+}
+
+Optimizer::State& Optimizer::get_state(const Tensor& value) {
+    std::lock_guard<std::mutex> lock(states_mutex_);
+    std::unique_ptr<State>& state = states_[&value];
+
+    if (!state) {
+        const size_t size = static_cast<size_t>(value.get_depth()) * value.get_num_rows() * value.get_num_columns();
+
+        state.reset(new State());
+        state->step = 0;
+        state->buffers.assign(num_state_buffers_, std::vector<double>(size, 0.0));
+    }
+
+    return *state;
+}
+
+/******************************************************
+ * Learning rate schedules
+ *****************************************************/
+
+std::function<double(const long)> schedules::constant() {
+    return [](const long step) {
+        (void)step;
+        return 1.0;
+    };
+}
+
+std::function<double(const long)> schedules::step_decay(const double factor, const long step_size) {
+    if (step_size <= 0) {
+        throw std::invalid_argument("Step_decay: step_size must be greater than 0");
+    }
+
+    return [factor, step_size](const long step) {
+        return std::pow(factor, static_cast<double>(step / step_size));
+    };
+}
+
+std::function<double(const long)> schedules::exponential_decay(const double decay_rate, const long decay_steps) {
+    if (decay_steps <= 0) {
+        throw std::invalid_argument("Exponential_decay: decay_steps must be greater than 0");
+    }
+
+    return [decay_rate, decay_steps](const long step) {
+        return std::pow(decay_rate, static_cast<double>(step) / decay_steps);
+    };
+}
@@ -0,0 +1,219 @@
+#include <vector>
+#include <memory>
+#include <thread>
+#include <exception>
+#include <stdexcept>
+#include <algorithm>
+#include "pipeline_trainer.hpp"
+#include "neural_network.hpp"
+#include "mnist_data_set.hpp"
+#include "bounded_queue.hpp"
+#include "tensor.hpp"
+#include "layer.hpp"
+#include "optimizer.hpp"
+
+/******************************************************
+ * Constructors
+ *****************************************************/
+
+PipelineTrainer::PipelineTrainer(NeuralNetwork& network, const std::vector<int>& stage_boundaries, const int num_micro_batches):
+    network_(network),
+    stage_boundaries_(stage_boundaries),
+    num_stages_(static_cast<int>(stage_boundaries.size())),
+    num_micro_batches_(num_micro_batches) {
+
+    if (stage_boundaries.empty() || stage_boundaries[0] != 0) {
+        throw std::invalid_argument("PipelineTrainer constructor: the first stage must start at layer 0");
+    }
+    for (int i = 1; i < num_stages_; ++i) {
+        if (stage_boundaries[i] <= stage_boundaries[i - 1] || stage_boundaries[i] >= network.get_num_layers()) {
+            throw std::invalid_argument("PipelineTrainer constructor: stage boundaries must be increasing layer indices");
+        }
+    }
+    if (num_micro_batches <= 0) {
+        throw std::invalid_argument("PipelineTrainer constructor: num_micro_batches must be greater than 0");
+    }
+
+    /* Stage boundaries are stored as half open ranges of layer indices */
+    stage_boundaries_.push_back(network.get_num_layers());
+
+    for (int i = 1; i < num_micro_batches_; ++i) {
+        replicas_.push_back(network_.replicate());
+    }
+}
+
+/******************************************************
+ * Getters
+ *****************************************************/
+
+int PipelineTrainer::get_num_stages() const {
+    return num_stages_;
+}
+
+int PipelineTrainer::get_num_micro_batches() const {
+    return num_micro_batches_;
+}
+
+/******************************************************
+ * Operations
+ *****************************************************/
+
+void PipelineTrainer::train(const MNISTDataSet& data_set, const int first_sample) {
+    if (first_sample < 0) {
+        throw std::invalid_argument("PipelineTrainer train: first_sample cannot be negative");
+    }
+
+    MessageQueues forward_queues;
+    MessageQueues backward_queues;
+
+    for (int i = 0; i < num_stages_; ++i) {
+        forward_queues.emplace_back(new BoundedQueue<Message>(num_micro_batches_));
+        backward_queues.emplace_back(new BoundedQueue<Message>(num_micro_batches_));
+    }
+
+    std::vector<std::exception_ptr> errors(num_stages_);
+    std::vector<std::thread> stages;
+
+    for (int i = 0; i < num_stages_; ++i) {
+        stages.emplace_back([&, i] {
+            try {
+                run_stage(i, forward_queues, backward_queues);
+            }
+            catch (...) {
+                errors[i] = std::current_exception();
+
+                for (int j = 0; j < num_stages_; ++j) {
+                    forward_queues[j]->close();
+                    backward_queues[j]->close();
+                }
+            }
+        });
+    }
+
+    /* Feed the first stage, splitting the training set into mini-batches of micro-batches */
+    const int train_size = data_set.get_train_size();
+    for (int position = first_sample; position < train_size; position += num_micro_batches_) {
+        const int batch_size = std::min(num_micro_batches_, train_size - position);
+        bool pushed = true;
+
+        for (int i = 0; i < batch_size && pushed; ++i) {
+            pushed = forward_queues[0]->push(Message {i,
+                                                     batch_size,
+                                                     data_set.get_train_data(position + i),
+                                                     data_set.get_train_label(position + i)});
+        }
+
+        if (!pushed) {
+            break;
+        }
+    }
+    forward_queues[0]->close();
+
+    for (std::thread& stage : stages) {
+        stage.join();
+    }
+
+    for (const std::exception_ptr& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+NeuralNetwork& PipelineTrainer::get_replica(const int micro_batch) {
+    return micro_batch == 0 ? network_ : replicas_[micro_batch - 1];
+}
+
+Tensor PipelineTrainer::forward_stage(const int stage, const int micro_batch, Tensor activation) {
+    NeuralNetwork& replica = get_replica(micro_batch);
+
+    for (int i = stage_boundaries_[stage]; i < stage_boundaries_[stage + 1]; ++i) {
+        activation = replica.get_layer(i).forward(activation);
+    }
+
+    return activation;
+}
+
+Tensor PipelineTrainer::backward_stage(const int stage, const int micro_batch, Tensor gradient) {
+    NeuralNetwork& replica = get_replica(micro_batch);
+
+    for (int i = stage_boundaries_[stage + 1] - 1; i >= stage_boundaries_[stage]; --i) {
+        gradient = replica.get_layer(i).backward(gradient);
+    }
+
+    return gradient;
+}
+
+void PipelineTrainer::run_stage(const int stage, MessageQueues& forward_queues, MessageQueues& backward_queues) {
+    const bool is_last_stage = stage == num_stages_ - 1;
+    Message message;
+
+    /* The parameters of this stage's layers in every replica and their optimizer states, resolved once */
+    std::vector<std::vector<std::vector<Parameter>>> parameters;
+    std::vector<std::vector<Optimizer::State*>> states;
+    for (int j = stage_boundaries_[stage]; j < stage_boundaries_[stage + 1]; ++j) {
+        parameters.emplace_back();
+        for (int i = 0; i < num_micro_batches_; ++i) {
+            parameters.back().push_back(get_replica(i).get_layer(j).get_parameters());
+        }
+        states.push_back(network_.get_optimizer().get_states(parameters.back()[0]));
+    }
+
+    while (forward_queues[stage]->pop(message)) {
+        const int batch_size = message.batch_size;
+
+        /* Forward every micro-batch, the last stage turns each one around immediately */
+        for (int i = 0; i < batch_size; ++i) {
+            if (i > 0 && !forward_queues[stage]->pop(message)) {
+                return;
+            }
+
+            message.activation = forward_stage(stage, message.micro_batch, message.activation);
+
+            if (is_last_stage) {
+                message.activation = backward_stage(stage, message.micro_batch, message.activation - message.label);
+                if (stage > 0 && !backward_queues[stage - 1]->push(message)) {
+                    return;
+                }
+            }
+            else if (!forward_queues[stage + 1]->push(message)) {
+                return;
+            }
+        }
+
+        /* Backward every micro-batch as the gradients come back from the next stage */
+        if (!is_last_stage) {
+            for (int i = 0; i < batch_size; ++i) {
+                if (!backward_queues[stage]->pop(message)) {
+                    return;
+                }
+
+                message.activation = backward_stage(stage, message.micro_batch, message.activation);
+
+                if (stage > 0 && !backward_queues[stage - 1]->push(message)) {
+                    return;
+                }
+            }
+        }
+
+        /* Flush the accumulated gradients of this stage at the mini-batch boundary */
+        for (size_t j = 0; j < parameters.size(); ++j) {
+            const std::vector<Parameter>& layer_parameters = parameters[j][0];
+
+            for (int i = 1; i < batch_size; ++i) {
+                const std::vector<Parameter>& replica_parameters = parameters[j][i];
+
+                for (size_t k = 0; k < layer_parameters.size(); ++k) {
+                    *layer_parameters[k].gradient += *replica_parameters[k].gradient;
+                    replica_parameters[k].gradient->fill(0.0);
+                }
+            }
+
+            network_.get_optimizer().step(layer_parameters, states[j].data(), batch_size);
+        }
+    }
+
+    if (!is_last_stage) {
+        forward_queues[stage + 1]->close();
+    }
+}
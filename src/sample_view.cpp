@@ -0,0 +1,41 @@
+#include <cstdint>
+#include <stdexcept>
+#include "sample_view.hpp"
+#include "mnist_record.hpp"
+#include "tensor.hpp"
+
+/******************************************************
+ * Constructors
+ *****************************************************/
+
+SampleView::SampleView(const uint8_t* record):
+    record_(record) {
+
+    if (record == nullptr) {
+        throw std::invalid_argument("SampleView constructor: record cannot be null");
+    }
+}
+
+/******************************************************
+ * Getters
+ *****************************************************/
+
+int SampleView::get_label() const {
+    return record_[0];
+}
+
+const uint8_t* SampleView::get_pixels() const {
+    return record_ + 1;
+}
+
+/******************************************************
+ * Conversion
+ *****************************************************/
+
+void SampleView::copy_data(Tensor& output) const {
+    mnist_record::to_data(record_, output);
+}
+
+void SampleView::copy_label(Tensor& output) const {
+    mnist_record::to_label(record_, output);
+}
@@ -0,0 +1,29 @@
+#include "sgd_optimizer.hpp"
+#include "optimizer.hpp"
+
+/******************************************************
+ * Constructors
+ *****************************************************/
+
+SGDOptimizer::SGDOptimizer(): Optimizer(0) {}
+
+/******************************************************
+ * Update
+ *****************************************************/
+
+void SGDOptimizer::update(double* value,
+                          double* gradient,
+                          double* const* state,
+                          const int size,
+                          const double learning_rate,
+                          const double gradient_scale,
+                          const long step) const {
+    (void)state;
+    (void)step;
+    const double scale = learning_rate * gradient_scale;
+
+    for (int i = 0; i < size; ++i) {
+        value[i] -= scale * gradient[i];
+        gradient[i] = 0.0;
+    }
+}
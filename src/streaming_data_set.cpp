@@ -0,0 +1,280 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <thread>
+#include <memory>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include "streaming_data_set.hpp"
+#include "mnist_record.hpp"
+#include "bounded_queue.hpp"
+#include "tensor.hpp"
+#include "tracer.hpp"
+
+namespace {
+    using mnist_record::record_bytes;
+
+    const int block_records = 256;
+    const size_t read_bytes = 1 << 20;
+
+    /* Descriptor of a shard opened for sequential reads, closed when it goes out of scope */
+    class ShardFile {
+    public:
+        ShardFile(const std::string& path): fd_(open(path.c_str(), O_RDONLY)) {
+            if (fd_ < 0) {
+                throw std::runtime_error("StreamingDataSet prefetch: failed to open " + path);
+            }
+            posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+        }
+
+        ShardFile(const ShardFile& other) = delete;
+        ShardFile& operator=(const ShardFile& other) = delete;
+
+        ~ShardFile() {
+            close(fd_);
+        }
+
+        int get() const {
+            return fd_;
+        }
+
+    private:
+        int fd_;
+    };
+}
+
+/******************************************************
+ * Constructors
+ *****************************************************/
+
+StreamingDataSet::StreamingDataSet(const std::vector<std::string>& shard_paths,
+                                   const size_t memory_budget,
+                                   const int shuffle_buffer_size,
+                                   const unsigned seed):
+    shard_paths_(shard_paths),
+    block_records_(block_records),
+    shuffle_buffer_size_(shuffle_buffer_size),
+    seed_(seed),
+    current_position_(0),
+    exhausted_(true),
+    shuffle_buffer_(shuffle_buffer_size * record_bytes),
+    num_buffered_(0),
+    num_samples_(0),
+    stall_time_(0) {
+
+    if (shard_paths.empty()) {
+        throw std::invalid_argument("StreamingDataSet constructor: at least one shard is required");
+    }
+    if (shuffle_buffer_size <= 0) {
+        throw std::invalid_argument("StreamingDataSet constructor: shuffle_buffer_size must be greater than 0");
+    }
+
+    /* Whatever the shuffle and read buffers leave of the budget goes to the blocks: the block being
+     * consumed, the block being filled and at least one queued between them */
+    const size_t block_bytes = block_records_ * record_bytes;
+    const size_t shuffle_bytes = shuffle_buffer_.size();
+    if (memory_budget < shuffle_bytes + read_bytes + 3 * block_bytes) {
+        throw std::invalid_argument("StreamingDataSet constructor: memory_budget is too small for the shuffle and read buffers");
+    }
+    num_blocks_ = (memory_budget - shuffle_bytes - read_bytes) / block_bytes;
+}
+
+StreamingDataSet::~StreamingDataSet() {
+    stop();
+}
+
+/******************************************************
+ * Getters
+ *****************************************************/
+
+int StreamingDataSet::get_num_shards() const {
+    return shard_paths_.size();
+}
+
+size_t StreamingDataSet::get_buffer_bytes() const {
+    return shuffle_buffer_.size() + read_bytes + static_cast<size_t>(num_blocks_) * block_records_ * record_bytes;
+}
+
+long StreamingDataSet::get_num_samples() const {
+    return num_samples_;
+}
+
+std::chrono::microseconds StreamingDataSet::get_stall_time() const {
+    return stall_time_;
+}
+
+/******************************************************
+ * Operations
+ *****************************************************/
+
+void StreamingDataSet::start_pass(const int pass) {
+    stop();
+
+    // The block being consumed and the one being filled take two of the blocks the budget allows
+    blocks_.reset(new BoundedQueue<Block>(num_blocks_ - 2));
+    current_ = Block();
+    current_position_ = 0;
+    exhausted_ = false;
+    num_buffered_ = 0;
+    generator_.seed(seed_ + pass);
+    num_samples_ = 0;
+    stall_time_ = std::chrono::microseconds(0);
+
+    prefetcher_ = std::thread(&StreamingDataSet::prefetch, this, std::ref(*blocks_));
+}
+
+bool StreamingDataSet::next(Tensor& data, Tensor& label) {
+    static const int next_trace = Tracer::get_global().intern("stream next", "data");
+    TraceScope trace(next_trace);
+
+    /* Top up the shuffle buffer, only short at the start and end of a pass */
+    while (num_buffered_ < shuffle_buffer_size_ && pull_record(&shuffle_buffer_[num_buffered_ * record_bytes])) {
+        ++num_buffered_;
+    }
+
+    if (num_buffered_ == 0) {
+        return false;
+    }
+
+    std::uniform_int_distribution<int> distribution(0, num_buffered_ - 1);
+    uint8_t* record = &shuffle_buffer_[distribution(generator_) * record_bytes];
+    mnist_record::to_data(record, data);
+    mnist_record::to_label(record, label);
+    ++num_samples_;
+
+    /* Replace the sample with the next one from the stream, or with the last buffered sample once it runs dry */
+    if (!pull_record(record)) {
+        --num_buffered_;
+        std::memcpy(record, &shuffle_buffer_[num_buffered_ * record_bytes], record_bytes);
+    }
+
+    return true;
+}
+
+void StreamingDataSet::stop() {
+    if (blocks_) {
+        blocks_->close();
+    }
+    if (prefetcher_.joinable()) {
+        prefetcher_.join();
+    }
+}
+
+bool StreamingDataSet::pull_record(uint8_t* record) {
+    if (exhausted_) {
+        return false;
+    }
+
+    if (current_position_ * record_bytes == current_.records.size()) {
+        auto wait_start = std::chrono::steady_clock::now();
+        const bool received = blocks_->pop(current_);
+        stall_time_ += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - wait_start);
+
+        if (!received) {
+            exhausted_ = true;
+            return false;
+        }
+        if (current_.error) {
+            exhausted_ = true;
+            std::rethrow_exception(current_.error);
+        }
+        current_position_ = 0;
+    }
+
+    std::memcpy(record, &current_.records[current_position_ * record_bytes], record_bytes);
+    ++current_position_;
+    return true;
+}
+
+/******************************************************
+ * Prefetching
+ *****************************************************/
+
+void StreamingDataSet::prefetch(BoundedQueue<Block>& blocks) const {
+    Block block;
+    block.records.reserve(block_records_ * record_bytes);
+
+    try {
+        std::vector<char> buffer(read_bytes);
+
+        for (const std::string& path : shard_paths_) {
+            const ShardFile file(path);
+
+            /* Lines can straddle reads, the unparsed tail is moved to the front of the buffer */
+            size_t filled = 0;
+            long line_number = 0;
+            bool at_end = false;
+
+            while (!at_end) {
+                static const int read_trace = Tracer::get_global().intern("read shard", "data");
+                ssize_t count = 0;
+                {
+                    TraceScope trace(read_trace);
+                    count = read(file.get(), buffer.data() + filled, buffer.size() - filled);
+                }
+                if (count < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (count < 0) {
+                    throw std::runtime_error("StreamingDataSet prefetch: failed to read " + path);
+                }
+                at_end = count == 0;
+                filled += count;
+
+                const char* begin = buffer.data();
+                const char* end = buffer.data() + filled;
+                const char* line = begin;
+
+                while (line < end) {
+                    const char* line_end = mnist_record::find_line_end(line, end);
+                    if (line_end == end && !at_end) {
+                        break;
+                    }
+
+                    ++line_number;
+                    // Each shard may start with a header line
+                    const bool header = line_number == 1 && (*line < '0' || *line > '9');
+                    if (!header && !mnist_record::is_blank(line, line_end)) {
+                        block.records.resize(block.records.size() + record_bytes);
+                        mnist_record::parse_csv_line(line, line_end, &block.records[block.records.size() - record_bytes], line_number);
+
+                        if (static_cast<int>(block.records.size() / record_bytes) == block_records_) {
+                            if (!blocks.push(std::move(block))) {
+                                return;
+                            }
+                            block = Block();
+                            block.records.reserve(block_records_ * record_bytes);
+                        }
+                    }
+                    line = line_end + 1;
+                }
+
+                if (!at_end && line == begin && filled == buffer.size()) {
+                    throw std::runtime_error("StreamingDataSet prefetch: line too long in " + path);
+                }
+
+                filled = line < end ? end - line : 0;
+                std::memmove(buffer.data(), line < end ? line : begin, filled);
+            }
+        }
+
+        if (!block.records.empty()) {
+            blocks.push(std::move(block));
+        }
+    }
+    catch (...) {
+        Block failure;
+        failure.error = std::current_exception();
+        blocks.push(std::move(failure));
+    }
+
+    blocks.close();
+}
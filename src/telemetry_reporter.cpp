@@ -0,0 +1,173 @@
+#include <string>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include "telemetry_reporter.hpp"
+#include "tensor.hpp"
+#include "utility.hpp"
+
+/******************************************************
+ * Constructors
+ *****************************************************/
+
+TelemetryReporter::TelemetryReporter(const std::chrono::milliseconds interval, const std::string& json_path):
+    interval_(interval),
+    samples_(0),
+    correct_(0),
+    loss_sum_(0.0),
+    num_reports_(0),
+    stop_(false),
+    active_(false),
+    epoch_(0),
+    first_sample_(0),
+    num_samples_(0),
+    created_(std::chrono::steady_clock::now()),
+    last_samples_(0),
+    last_loss_sum_(0.0),
+    last_loss_(0.0) {
+
+    if (interval.count() <= 0) {
+        throw std::invalid_argument("TelemetryReporter constructor: interval must be greater than 0");
+    }
+
+    if (!json_path.empty()) {
+        json_.open(json_path, std::ios::out | std::ios::trunc);
+        if (!json_) {
+            throw std::runtime_error("TelemetryReporter constructor: could not open " + json_path);
+        }
+    }
+
+    thread_ = std::thread(&TelemetryReporter::run, this);
+}
+
+TelemetryReporter::~TelemetryReporter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    thread_.join();
+}
+
+/******************************************************
+ * Getters
+ *****************************************************/
+
+int TelemetryReporter::get_num_reports() const {
+    return num_reports_;
+}
+
+/******************************************************
+ * Operations
+ *****************************************************/
+
+void TelemetryReporter::start_epoch(const int epoch, const long first_sample, const long num_samples) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    samples_ = 0;
+    correct_ = 0;
+    loss_sum_ = 0.0;
+    active_ = true;
+    epoch_ = epoch;
+    first_sample_ = first_sample;
+    num_samples_ = num_samples;
+    epoch_start_ = std::chrono::steady_clock::now();
+    last_time_ = epoch_start_;
+    last_samples_ = 0;
+    last_loss_sum_ = 0.0;
+    last_loss_ = 0.0;
+}
+
+void TelemetryReporter::record(const Tensor& output, const Tensor& expected_output) {
+    loss_sum_.store(loss_sum_.load(std::memory_order_relaxed) + utility::cross_entropy(output, expected_output),
+                    std::memory_order_relaxed);
+    if (utility::argmax(output) == utility::argmax(expected_output)) {
+        correct_.fetch_add(1, std::memory_order_relaxed);
+    }
+    samples_.fetch_add(1, std::memory_order_release);
+}
+
+void TelemetryReporter::end_epoch() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (active_) {
+        report(true);
+        active_ = false;
+    }
+}
+
+void TelemetryReporter::report(const bool final) {
+    const auto now = std::chrono::steady_clock::now();
+    const long samples = samples_.load(std::memory_order_acquire);
+    const long correct = correct_.load(std::memory_order_relaxed);
+    const double loss_sum = loss_sum_.load(std::memory_order_relaxed);
+
+    const double epoch_seconds = std::chrono::duration<double>(now - epoch_start_).count();
+    const double interval_seconds = std::chrono::duration<double>(now - last_time_).count();
+
+    /* A final report covers the whole epoch, the others only the last interval */
+    const long window_samples = final ? samples : samples - last_samples_;
+    const double window_seconds = final ? epoch_seconds : interval_seconds;
+    const double window_loss_sum = final ? loss_sum : loss_sum - last_loss_sum_;
+
+    const double throughput = window_seconds > 0.0 ? window_samples / window_seconds : 0.0;
+    const double loss = window_samples > 0 ? window_loss_sum / window_samples : last_loss_;
+    const double accuracy = samples > 0 ? static_cast<double>(correct) / samples : 0.0;
+    const double average_throughput = epoch_seconds > 0.0 ? samples / epoch_seconds : 0.0;
+    const long remaining = std::max(0L, num_samples_ - first_sample_ - samples);
+    const double eta_seconds = average_throughput > 0.0 ? remaining / average_throughput : 0.0;
+
+    last_time_ = now;
+    last_samples_ = samples;
+    last_loss_sum_ = loss_sum;
+    last_loss_ = loss;
+
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(1);
+    if (final) {
+        line << "Trained " << samples << " samples: " << throughput << " samples/s, loss "
+             << std::setprecision(4) << loss << ", train accuracy " << std::setprecision(2) << accuracy * 100 << "%";
+    }
+    else {
+        line << "Epoch " << (epoch_ + 1) << " " << (first_sample_ + samples);
+        if (num_samples_ > 0) {
+            line << "/" << num_samples_;
+        }
+        line << ": " << throughput << " samples/s, loss " << std::setprecision(4) << loss << ", train accuracy "
+             << std::setprecision(2) << accuracy * 100 << "%";
+        if (num_samples_ > 0) {
+            line << ", ETA " << std::setprecision(0) << eta_seconds << "s";
+        }
+    }
+    std::cout << line.str() << std::endl;
+
+    if (json_.is_open()) {
+        json_ << std::setprecision(6)
+              << "{\"time\":" << std::chrono::duration<double>(now - created_).count()
+              << ",\"epoch\":" << (epoch_ + 1) << ",\"samples\":" << (first_sample_ + samples)
+              << ",\"epoch_samples\":" << num_samples_ << ",\"samples_per_second\":" << throughput
+              << ",\"loss\":" << loss << ",\"train_accuracy\":" << accuracy << ",\"eta_seconds\":" << (num_samples_ > 0 ? std::to_string(eta_seconds) : "null")
+              << ",\"final\":" << (final ? "true" : "false") << "}" << std::endl;
+    }
+
+    ++num_reports_;
+}
+
+void TelemetryReporter::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (!stop_) {
+        wake_.wait_for(lock, interval_, [this] { return stop_; });
+        if (!stop_ && active_) {
+            report(false);
+        }
+    }
+}
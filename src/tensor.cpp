@@ -3,8 +3,11 @@
 #include <stdexcept>
 #include <iostream>
 #include <limits>
+#include <functional>
 #include "tensor.hpp"
 #include "matrix.hpp"
+#include "utility.hpp"
+#include "thread_pool.hpp"
 
 /******************************************************
  * Constructors
@@ -88,6 +91,10 @@ int Tensor::get_depth() const {
     return depth_;
 }
 
+int Tensor::get_size() const {
+    return depth_ * rows_ * columns_;
+}
+
 Matrix& Tensor::operator()(const int index) {
     if (index < 0 || index >= depth_) {
         throw std::invalid_argument("Tensor get_matrix: index out of bounds for tensor depth");
@@ -196,21 +203,49 @@ Tensor Tensor::transpose() const {
 
 Tensor Tensor::max_pool_forward(const int window_size, const int stride) const {
     Tensor result;
-    for (int i = 0; i < depth_; ++i) {
-        result.append_matrix(data_[i].max_pool_forward(window_size, stride));
-    }
+    max_pool_forward_into(window_size, stride, result);
     return result;
 }
 
+void Tensor::max_pool_forward_into(const int window_size, const int stride, Tensor& result) const {
+    if (&result == this) {
+        throw std::invalid_argument("Tensor max_pool_forward_into: result cannot alias the input");
+    }
+
+    if (depth_ <= 0) {
+        result = Tensor();
+        return;
+    }
+
+    result.resize(depth_,
+                  utility::max_pool_result_dim(rows_, window_size, stride),
+                  utility::max_pool_result_dim(columns_, window_size, stride));
+
+    /* Passed by reference so std::function does not allocate for the captures */
+    const auto pool_channels = [&](const int begin, const int end) {
+        for (int i = begin; i < end; ++i) {
+            data_[i].max_pool_forward_into(window_size, stride, result.data_[i]);
+        }
+    };
+    parallel_for(0, depth_, 1, std::cref(pool_channels));
+}
+
 Tensor Tensor::max_pool_backward(const Tensor& output, const int window_size, const int stride) const {
     if (depth_ != output.depth_) {
         throw std::invalid_argument("Tensor max_pool_backward: depths do not match");
     }
 
-    Tensor result;
-    for (int i = 0; i < depth_; ++i) {
-        result.append_matrix(data_[i].max_pool_backward(output.data_[i], window_size, stride));
+    if (depth_ <= 0) {
+        return Tensor();
     }
+
+    Tensor result(depth_, rows_, columns_);
+
+    parallel_for(0, depth_, 1, [&](const int begin, const int end) {
+        for (int i = begin; i < end; ++i) {
+            result.data_[i] = data_[i].max_pool_backward(output.data_[i], window_size, stride);
+        }
+    });
     return result;
 }
 
@@ -265,6 +300,12 @@ void Tensor::randomize(const double mean, const double std_dev) {
     }
 }
 
+void Tensor::fill(const double value) {
+    for (int i = 0; i < depth_; ++i) {
+        data_[i].fill(value);
+    }
+}
+
 void Tensor::reshape(const int depth, const int rows, const int columns) {
     if (depth < 1 || rows < 1 || columns < 1) {
         throw std::invalid_argument("Tensor reshape: new dimensions cannot be zero or less");
@@ -300,6 +341,24 @@ void Tensor::reshape(const int depth, const int rows, const int columns) {
     data_ = new_data;
 }
 
+void Tensor::resize(const int depth, const int rows, const int columns) {
+    if (depth < 1 || rows < 1 || columns < 1) {
+        throw std::invalid_argument("Tensor resize: new dimensions cannot be zero or less");
+    }
+
+    /* Reuses the existing matrices, contents are unspecified afterwards */
+    if (depth != depth_) {
+        *this = Tensor(depth, rows, columns);
+        return;
+    }
+
+    for (int i = 0; i < depth_; ++i) {
+        data_[i].resize(rows, columns);
+    }
+    rows_ = rows;
+    columns_ = columns;
+}
+
 bool Tensor::operator==(const Tensor& other) const {
     if (depth_ != other.depth_) {
         return false;
@@ -0,0 +1,238 @@
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <algorithm>
+#include "thread_pool.hpp"
+
+namespace {
+    thread_local const ThreadPool* current_pool = nullptr;
+    thread_local int current_worker = -1;
+}
+
+struct ThreadPool::Job {
+    std::atomic<int> remaining_tasks;
+    std::mutex error_mutex;
+    std::exception_ptr error;
+};
+
+/******************************************************
+ * Constructors
+ *****************************************************/
+
+ThreadPool::ThreadPool(const int num_threads):
+    num_threads_(num_threads),
+    pending_tasks_(0),
+    next_queue_(0),
+    stop_(false) {
+
+    if (num_threads <= 0) {
+        throw std::invalid_argument("ThreadPool constructor: num_threads must be greater than 0");
+    }
+
+    /* The thread calling parallel_for takes part in the work, so one thread fewer is spawned */
+    for (int i = 0; i < num_threads_ - 1; ++i) {
+        queues_.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue()));
+    }
+    for (int i = 0; i < num_threads_ - 1; ++i) {
+        workers_.emplace_back(&ThreadPool::worker_loop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        stop_ = true;
+    }
+    sleep_condition_.notify_all();
+
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+}
+
+ThreadPool& ThreadPool::get_global() {
+    static ThreadPool pool([] {
+        const char* value = std::getenv("CNN_NUM_THREADS");
+        int num_threads = value != nullptr ? std::atoi(value) : static_cast<int>(std::thread::hardware_concurrency());
+        return num_threads > 0 ? num_threads : 1;
+    }());
+    return pool;
+}
+
+/******************************************************
+ * Getters
+ *****************************************************/
+
+int ThreadPool::get_num_threads() const {
+    return num_threads_;
+}
+
+/******************************************************
+ * Operations
+ *****************************************************/
+
+void ThreadPool::parallel_for(const int begin, const int end, const int grain_size, const std::function<void(int, int)>& body) {
+    if (grain_size <= 0) {
+        throw std::invalid_argument("ThreadPool parallel_for: grain_size must be greater than 0");
+    }
+    if (begin >= end) {
+        return;
+    }
+    if (workers_.empty() || end - begin <= grain_size) {
+        body(begin, end);
+        return;
+    }
+
+    Job job;
+    int num_chunks = (end - begin + grain_size - 1) / grain_size;
+    job.remaining_tasks = num_chunks;
+
+    /* Workers queue nested work locally, other threads spread it across all workers */
+    const int own_queue = current_pool == this ? current_worker : -1;
+    for (int chunk_begin = begin; chunk_begin < end; chunk_begin += grain_size) {
+        Task task {&body, chunk_begin, std::min(chunk_begin + grain_size, end), &job};
+        int queue_index = own_queue >= 0 ? own_queue : static_cast<int>(next_queue_++ % queues_.size());
+
+        std::lock_guard<std::mutex> lock(queues_[queue_index]->mutex);
+        queues_[queue_index]->push_back(task);
+    }
+
+    pending_tasks_ += num_chunks;
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+    }
+    sleep_condition_.notify_all();
+
+    /* Help until every chunk of this job has finished */
+    Task task;
+    while (job.remaining_tasks.load(std::memory_order_acquire) > 0) {
+        if ((own_queue >= 0 && pop_task(own_queue, task)) || steal_task(own_queue, task)) {
+            run_task(task);
+        }
+        else {
+            std::this_thread::yield();
+        }
+    }
+
+    if (job.error) {
+        std::rethrow_exception(job.error);
+    }
+}
+
+void ThreadPool::worker_loop(const int worker_index) {
+    current_pool = this;
+    current_worker = worker_index;
+
+    Task task;
+    while (true) {
+        if (pop_task(worker_index, task) || steal_task(worker_index, task)) {
+            run_task(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        sleep_condition_.wait(lock, [this] { return stop_ || pending_tasks_.load() > 0; });
+        if (stop_) {
+            return;
+        }
+    }
+}
+
+bool ThreadPool::pop_task(const int worker_index, Task& task) {
+    WorkerQueue& queue = *queues_[worker_index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+
+    if (queue.empty()) {
+        return false;
+    }
+
+    task = queue.pop_back();
+    --pending_tasks_;
+    return true;
+}
+
+bool ThreadPool::steal_task(const int worker_index, Task& task) {
+    const int num_queues = static_cast<int>(queues_.size());
+
+    for (int i = 1; i <= num_queues; ++i) {
+        int victim = (worker_index + i + num_queues) % num_queues;
+        if (victim == worker_index) {
+            continue;
+        }
+
+        WorkerQueue& queue = *queues_[victim];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+
+        if (!queue.empty()) {
+            task = queue.pop_front();
+            --pending_tasks_;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::run_task(const Task& task) {
+    try {
+        (*task.body)(task.begin, task.end);
+    }
+    catch (...) {
+        std::lock_guard<std::mutex> lock(task.job->error_mutex);
+        if (!task.job->error) {
+            task.job->error = std::current_exception();
+        }
+    }
+
+    task.job->remaining_tasks.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+/******************************************************
+ * Worker queues
+ *****************************************************/
+
+bool ThreadPool::WorkerQueue::empty() const {
+    return size == 0;
+}
+
+void ThreadPool::WorkerQueue::push_back(const Task& task) {
+    if (size == tasks.size()) {
+        /* Unrolls the ring into a buffer twice as large */
+        std::vector<Task> grown(std::max<size_t>(16, 2 * tasks.size()));
+        for (size_t i = 0; i < size; ++i) {
+            grown[i] = tasks[(head + i) % tasks.size()];
+        }
+        tasks.swap(grown);
+        head = 0;
+    }
+
+    tasks[(head + size) % tasks.size()] = task;
+    ++size;
+}
+
+ThreadPool::Task ThreadPool::WorkerQueue::pop_back() {
+    --size;
+    return tasks[(head + size) % tasks.size()];
+}
+
+ThreadPool::Task ThreadPool::WorkerQueue::pop_front() {
+    const Task task = tasks[head];
+    head = (head + 1) % tasks.size();
+    --size;
+    return task;
+}
+
+/******************************************************
+ * Global pool
+ *****************************************************/
+
+void parallel_for(const int begin, const int end, const int grain_size, const std::function<void(int, int)>& body) {
+    ThreadPool::get_global().parallel_for(begin, end, grain_size, body);
+}
@@ -0,0 +1,237 @@
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <stdexcept>
+#include <set>
+#include "tracer.hpp"
+
+namespace {
+
+    /* Sampling state of the calling thread */
+    struct ThreadSampling {
+        long generation = -1;
+        long num_samples = 0;
+        bool recording = false;
+    };
+
+    thread_local ThreadSampling thread_sampling;
+
+    /* Escapes the characters JSON does not allow in a string */
+    std::string escape(const std::string& text) {
+        std::string escaped;
+        for (char character : text) {
+            if (character == '"' || character == '\\') {
+                escaped += '\\';
+                escaped += character;
+            }
+            else if (static_cast<unsigned char>(character) < 0x20) {
+                escaped += ' ';
+            }
+            else {
+                escaped += character;
+            }
+        }
+        return escaped;
+    }
+}
+
+/******************************************************
+ * Constructors
+ *****************************************************/
+
+Tracer::Tracer():
+    enabled_(false),
+    recording_(false),
+    generation_(0),
+    events_per_thread_(0),
+    sample_interval_(1),
+    origin_ns_(now_ns()),
+    next_thread_id_(1) {}
+
+Tracer& Tracer::get_global() {
+    static Tracer* tracer = new Tracer();
+    return *tracer;
+}
+
+/******************************************************
+ * Tracing
+ *****************************************************/
+
+void Tracer::enable(const size_t events_per_thread, const long sample_interval) {
+    if (events_per_thread == 0) {
+        throw std::invalid_argument("Tracer enable: events_per_thread must be greater than 0");
+    }
+    if (sample_interval <= 0) {
+        throw std::invalid_argument("Tracer enable: sample_interval must be greater than 0");
+    }
+
+    events_per_thread_ = events_per_thread;
+    sample_interval_ = sample_interval;
+    ++generation_;
+    enabled_ = true;
+    recording_ = true;
+}
+
+void Tracer::disable() {
+    enabled_ = false;
+    recording_ = false;
+}
+
+bool Tracer::is_recording() const {
+    if (!enabled_.load(std::memory_order_relaxed)) {
+        return false;
+    }
+
+    if (thread_sampling.generation == generation_.load(std::memory_order_relaxed)) {
+        return thread_sampling.recording;
+    }
+    return recording_.load(std::memory_order_relaxed);
+}
+
+void Tracer::next_sample() {
+    if (!enabled_.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    const long generation = generation_.load(std::memory_order_relaxed);
+    if (thread_sampling.generation != generation) {
+        thread_sampling.generation = generation;
+        thread_sampling.num_samples = 0;
+    }
+
+    thread_sampling.recording = thread_sampling.num_samples++ % sample_interval_.load(std::memory_order_relaxed) == 0;
+    recording_.store(thread_sampling.recording, std::memory_order_relaxed);
+}
+
+/******************************************************
+ * Events
+ *****************************************************/
+
+int Tracer::intern(const std::string& name, const std::string& category) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto key = std::make_pair(name, category);
+    auto found = name_ids_.find(key);
+    if (found != name_ids_.end()) {
+        return found->second;
+    }
+
+    const int id = static_cast<int>(names_.size());
+    names_.push_back(key);
+    name_ids_.emplace(key, id);
+    return id;
+}
+
+void Tracer::record(const int name_id, const int64_t begin_ns, const int64_t end_ns) {
+    ThreadBuffer& buffer = get_thread_buffer();
+
+    /* Only this thread writes the buffer, head publishes the event to write */
+    const size_t head = buffer.head.load(std::memory_order_relaxed);
+    buffer.events[head % buffer.events.size()] = {name_id, buffer.thread_id, begin_ns, end_ns};
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+int64_t Tracer::now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Tracer::ThreadBuffer& Tracer::get_thread_buffer() {
+    /* Hands the buffer back when the thread exits, so short lived threads reuse buffers instead of adding them */
+    struct Holder {
+        ThreadBuffer* buffer = nullptr;
+
+        ~Holder() {
+            if (buffer != nullptr) {
+                Tracer& tracer = Tracer::get_global();
+                std::lock_guard<std::mutex> lock(tracer.mutex_);
+                tracer.free_buffers_.push_back(buffer);
+            }
+        }
+    };
+    thread_local Holder holder;
+
+    if (holder.buffer == nullptr) {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (!free_buffers_.empty()) {
+            holder.buffer = free_buffers_.back();
+            holder.buffer->thread_id = next_thread_id_++;
+            free_buffers_.pop_back();
+        }
+        else {
+            std::unique_ptr<ThreadBuffer> created(new ThreadBuffer());
+            created->thread_id = next_thread_id_++;
+            created->events.resize(std::max<size_t>(events_per_thread_, 1));
+            created->head = 0;
+            holder.buffer = created.get();
+            buffers_.push_back(std::move(created));
+        }
+    }
+
+    return *holder.buffer;
+}
+
+/******************************************************
+ * Output
+ *****************************************************/
+
+void Tracer::write(const std::string& path) const {
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    if (!file) {
+        throw std::runtime_error("Tracer write: could not open " + path);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    /* Names every thread once, before its first event */
+    std::set<int> named_threads;
+    bool first = true;
+    auto name_thread = [&](const int thread_id) {
+        if (named_threads.insert(thread_id).second) {
+            file << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread_id
+                 << ",\"args\":{\"name\":\"thread " << thread_id << "\"}}";
+            first = false;
+        }
+    };
+
+    for (const std::unique_ptr<ThreadBuffer>& buffer : buffers_) {
+        name_thread(buffer->thread_id);
+
+        const size_t head = buffer->head.load(std::memory_order_acquire);
+        const size_t count = std::min(head, buffer->events.size());
+
+        for (size_t i = head - count; i < head; ++i) {
+            const Event& event = buffer->events[i % buffer->events.size()];
+            name_thread(event.thread_id);
+            file << ",\n{\"name\":\"" << escape(names_[event.name_id].first) << "\",\"cat\":\""
+                 << escape(names_[event.name_id].second) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread_id
+                 << ",\"ts\":" << (event.begin_ns - origin_ns_) / 1000.0
+                 << ",\"dur\":" << (event.end_ns - event.begin_ns) / 1000.0 << "}";
+        }
+    }
+
+    file << "\n]}\n";
+    if (!file) {
+        throw std::runtime_error("Tracer write: failed to write " + path);
+    }
+}
+
+size_t Tracer::get_num_events() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    size_t count = 0;
+    for (const std::unique_ptr<ThreadBuffer>& buffer : buffers_) {
+        count += std::min(buffer->head.load(std::memory_order_acquire), buffer->events.size());
+    }
+    return count;
+}
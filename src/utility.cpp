@@ -2,6 +2,9 @@
 #include <cctype>
 #include <algorithm>
 #include <stdexcept>
+#include <vector>
+#include <cmath>
+#include <random>
 #include "utility.hpp"
 #include "tensor.hpp"
 
@@ -30,6 +33,11 @@ int utility::argmax(const Tensor& input) {
     return max_index;
 }
 
+double utility::cross_entropy(const Tensor& output, const Tensor& expected_output) {
+    const double probability = output(0)(0, argmax(expected_output));
+    return -std::log(std::max(probability, 1e-12));
+}
+
 int utility::convolve_result_dim(const int dim, const int filter_dim, const int stride, const std::string& padding_type) {
     if (stride > filter_dim) {
         throw std::invalid_argument("Convolve_result_dim: stride must be less than or equal to filter dimension");
@@ -74,4 +82,28 @@ int utility::max_pool_result_dim(const int dim, const int window_size, const int
     }
 
     return ((dim - window_size) + stride - 1) / stride + 1;
-}
\ No newline at end of file
+}
+
+double utility::percentile(std::vector<double> values, const double fraction) {
+    if (values.empty()) {
+        throw std::invalid_argument("Percentile: values cannot be empty");
+    }
+    if (fraction < 0.0 || fraction > 1.0) {
+        throw std::invalid_argument("Percentile: fraction must be between 0 and 1");
+    }
+
+    /* Nearest rank */
+    size_t rank = static_cast<size_t>(std::ceil(fraction * values.size()));
+    size_t index = rank > 0 ? rank - 1 : 0;
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+std::default_random_engine& utility::random_engine() {
+    thread_local std::default_random_engine engine(std::random_device{}());
+    return engine;
+}
+
+void utility::seed_random(const unsigned seed) {
+    random_engine().seed(seed);
+}
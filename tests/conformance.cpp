@@ -0,0 +1,865 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <random>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <unistd.h>
+#include "matrix.hpp"
+#include "tensor.hpp"
+#include "layer.hpp"
+#include "convolutional_layer.hpp"
+#include "dense_layer.hpp"
+#include "activation_layer.hpp"
+#include "max_pool_layer.hpp"
+#include "flatten_layer.hpp"
+#include "utility.hpp"
+#include "kernels.hpp"
+#include "mnist_network.hpp"
+#include "neural_network.hpp"
+#include "checkpoint.hpp"
+#include "optimizer.hpp"
+#include "sgd_optimizer.hpp"
+#include "mnist_data_set.hpp"
+#include "mnist_record.hpp"
+#include "evaluation.hpp"
+#include "cnn.h"
+#include "reference_kernels.hpp"
+
+/* Differential tests of the library kernels against the frozen reference
+ * kernels over random shapes, strides, paddings and values, and numerical
+ * gradient checks of every layer's backward pass. Every section runs once
+ * per instruction set variant the CPU supports, and the variants are checked
+ * to agree bit for bit. The C interface and the parallel test set evaluation
+ * are compared with plain predict calls, the learning rate schedules are
+ * checked at their step boundaries, and the CSV parser is fed boundary and
+ * overlong tokens. */
+
+namespace {
+
+    const int max_reported_failures = 10;
+
+    struct Suite {
+        std::mt19937 generator;
+        long checks;
+        long failures;
+        long skipped;
+    };
+
+    void fail(Suite& suite, const std::string& message) {
+        if (suite.failures < max_reported_failures) {
+            std::cout << "FAIL " << message << std::endl;
+        }
+        ++suite.failures;
+    }
+
+    int random_int(Suite& suite, const int low, const int high) {
+        return std::uniform_int_distribution<int>(low, high)(suite.generator);
+    }
+
+    /* Value distributions that stress different things: ordinary values, a wide
+     * range of magnitudes, small integers whose sums are exact, and non-negative
+     * values on a coarse grid so pooling windows contain ties */
+    enum class Values { normal, wide, integers, non_negative_ties };
+
+    double random_value(Suite& suite, const Values values) {
+        switch (values) {
+            case Values::normal:
+                return std::normal_distribution<double>(0.0, 1.0)(suite.generator);
+            case Values::wide:
+                return std::normal_distribution<double>(0.0, 1.0)(suite.generator) * std::pow(2.0, random_int(suite, -20, 20));
+            case Values::integers:
+                return random_int(suite, -8, 8);
+            default:
+                return random_int(suite, 0, 4) * 0.25;
+        }
+    }
+
+    Matrix random_matrix(Suite& suite, const int rows, const int columns, const Values values) {
+        Matrix matrix(rows, columns);
+        for (int i = 0; i < rows; ++i) {
+            for (int j = 0; j < columns; ++j) {
+                matrix(i, j) = random_value(suite, values);
+            }
+        }
+        return matrix;
+    }
+
+    Values random_values(Suite& suite) {
+        return static_cast<Values>(random_int(suite, 0, 2));
+    }
+
+    uint64_t ulp_distance(const double a, const double b) {
+        int64_t a_bits;
+        int64_t b_bits;
+        std::memcpy(&a_bits, &a, sizeof(a));
+        std::memcpy(&b_bits, &b, sizeof(b));
+
+        /* Maps the sign-magnitude bit patterns onto a monotonic integer line */
+        if (a_bits < 0) {
+            a_bits = INT64_MIN - a_bits;
+        }
+        if (b_bits < 0) {
+            b_bits = INT64_MIN - b_bits;
+        }
+        return a_bits > b_bits ? static_cast<uint64_t>(a_bits) - static_cast<uint64_t>(b_bits)
+                               : static_cast<uint64_t>(b_bits) - static_cast<uint64_t>(a_bits);
+    }
+
+    /* Reordered sums differ from the reference by a few rounding errors per term,
+     * relative to the magnitude of the terms rather than of the possibly cancelled result */
+    bool close_enough(const double expected, const double actual, const double term_magnitude, const int num_terms) {
+        if (std::isnan(expected) || std::isnan(actual)) {
+            return std::isnan(expected) && std::isnan(actual);
+        }
+        if (ulp_distance(expected, actual) <= 4) {
+            return true;
+        }
+        return std::fabs(expected - actual) <= 4.0 * num_terms * 1e-16 * term_magnitude;
+    }
+
+    std::string describe(const Matrix& matrix) {
+        return std::to_string(matrix.get_num_rows()) + "x" + std::to_string(matrix.get_num_columns());
+    }
+
+    void compare(Suite& suite, const std::string& label, const Matrix& expected, const Matrix& actual,
+                 const double term_magnitude, const int num_terms) {
+        ++suite.checks;
+
+        if (expected.get_num_rows() != actual.get_num_rows() || expected.get_num_columns() != actual.get_num_columns()) {
+            fail(suite, label + ": shape " + describe(actual) + ", expected " + describe(expected));
+            return;
+        }
+
+        for (int i = 0; i < expected.get_num_rows(); ++i) {
+            for (int j = 0; j < expected.get_num_columns(); ++j) {
+                if (!close_enough(expected(i, j), actual(i, j), term_magnitude, num_terms)) {
+                    std::ostringstream message;
+                    message.precision(17);
+                    message << label << ": element (" << i << ", " << j << ") is " << actual(i, j) << ", expected "
+                            << expected(i, j) << " (" << ulp_distance(expected(i, j), actual(i, j)) << " ulps)";
+                    fail(suite, message.str());
+                    return;
+                }
+            }
+        }
+    }
+
+    double max_magnitude(const Matrix& matrix) {
+        double magnitude = 0.0;
+        for (int i = 0; i < matrix.get_num_rows(); ++i) {
+            for (int j = 0; j < matrix.get_num_columns(); ++j) {
+                magnitude = std::max(magnitude, std::fabs(matrix(i, j)));
+            }
+        }
+        return magnitude;
+    }
+
+    /* Runs a kernel that is expected to reject its arguments */
+    template <typename Kernel>
+    void expect_invalid(Suite& suite, const std::string& label, Kernel kernel) {
+        ++suite.checks;
+        try {
+            kernel();
+            fail(suite, label + ": accepted invalid arguments");
+        }
+        catch (const std::invalid_argument&) {}
+    }
+
+    /******************************************************
+     * Matrix kernels
+     *****************************************************/
+
+    void fuzz_multiply(Suite& suite, const int iterations) {
+        for (int iteration = 0; iteration < iterations; ++iteration) {
+            const int rows = random_int(suite, 1, 40);
+            const int inner = random_int(suite, 1, 300);
+            const int columns = random_int(suite, 1, 40);
+            const Values values = random_values(suite);
+
+            const Matrix left = random_matrix(suite, rows, inner, values);
+            const Matrix right = random_matrix(suite, inner, columns, values);
+            const Matrix expected = reference::multiply(left, right);
+            const double magnitude = max_magnitude(left) * max_magnitude(right);
+            const std::string label = "multiply " + describe(left) + " * " + describe(right);
+
+            compare(suite, label, expected, left * right, magnitude, inner);
+
+            /* multiply_into must overwrite a result of any previous shape and contents */
+            Matrix result = random_matrix(suite, random_int(suite, 1, 8), random_int(suite, 1, 8), Values::normal);
+            left.multiply_into(right, result);
+            compare(suite, label + " into", expected, result, magnitude, inner);
+
+            expect_invalid(suite, label + " mismatched", [&] { left * random_matrix(suite, inner + 1, columns, values); });
+        }
+    }
+
+    /* Whether Matrix::correlate accepts the arguments, following its documented rules */
+    bool correlate_is_valid(const int rows, const int columns, const int filter_rows, const int filter_columns,
+                            const int stride, const std::string& padding) {
+        if (stride <= 0 || stride > filter_rows || stride > filter_columns || filter_rows > rows || filter_columns > columns) {
+            return false;
+        }
+        if (padding == "full") {
+            return filter_rows >= 2 && filter_columns >= 2 &&
+                   (rows + filter_rows - 2) % stride == 0 && (columns + filter_columns - 2) % stride == 0;
+        }
+        if (padding == "valid") {
+            return (rows - filter_rows) % stride == 0 && (columns - filter_columns) % stride == 0 &&
+                   (rows != filter_rows || stride >= rows) && (columns != filter_columns || stride >= columns);
+        }
+        return true;
+    }
+
+    void fuzz_correlate(Suite& suite, const int iterations) {
+        const std::string paddings[] = {"valid", "same", "full"};
+
+        for (int iteration = 0; iteration < iterations; ++iteration) {
+            const int rows = random_int(suite, 1, 32);
+            const int columns = random_int(suite, 1, 32);
+            const int filter_rows = random_int(suite, 1, std::min(rows, 7));
+            const int filter_columns = random_int(suite, 1, std::min(columns, 7));
+            const int stride = random_int(suite, 1, 3);
+            const std::string padding = paddings[random_int(suite, 0, 2)];
+            const Values values = random_values(suite);
+
+            const Matrix input = random_matrix(suite, rows, columns, values);
+            const Matrix filter = random_matrix(suite, filter_rows, filter_columns, values);
+            std::string label = padding + " " + describe(input) + " filter " + describe(filter) + " stride " + std::to_string(stride);
+
+            if (!correlate_is_valid(rows, columns, filter_rows, filter_columns, stride, padding)) {
+                expect_invalid(suite, "correlate " + label, [&] { input.correlate(filter, stride, padding); });
+                continue;
+            }
+
+            const double magnitude = max_magnitude(input) * max_magnitude(filter);
+            const int num_terms = filter_rows * filter_columns;
+
+            const Matrix expected = reference::correlate(input, filter, stride, padding);
+            compare(suite, "correlate " + label, expected, input.correlate(filter, stride, padding), magnitude, num_terms);
+            compare(suite, "convolve " + label, reference::convolve(input, filter, stride, padding),
+                    input.convolve(filter, stride, padding), magnitude, num_terms);
+
+            /* correlate_accumulate adds the valid correlation to what the result already holds */
+            if (padding == "valid") {
+                Matrix result = random_matrix(suite, expected.get_num_rows(), expected.get_num_columns(), values);
+                Matrix sum = result;
+                sum += expected;
+
+                input.correlate_accumulate(filter, stride, result);
+                compare(suite, "correlate_accumulate " + label, sum, result, magnitude + max_magnitude(sum), num_terms + 1);
+            }
+        }
+    }
+
+    void fuzz_max_pool(Suite& suite, const int iterations) {
+        for (int iteration = 0; iteration < iterations; ++iteration) {
+            const int rows = random_int(suite, 1, 30);
+            const int columns = random_int(suite, 1, 30);
+            const int window_size = random_int(suite, 1, std::min(5, std::min(rows, columns)));
+            const int stride = random_int(suite, 1, window_size);
+            const Values values = iteration % 2 == 0 ? Values::non_negative_ties : Values::wide;
+
+            Matrix input = random_matrix(suite, rows, columns, values);
+            if (values == Values::wide) {
+                for (int i = 0; i < rows; ++i) {
+                    for (int j = 0; j < columns; ++j) {
+                        input(i, j) = std::fabs(input(i, j));
+                    }
+                }
+            }
+            const std::string label = describe(input) + " window " + std::to_string(window_size) + " stride " + std::to_string(stride);
+
+            const Matrix expected = reference::max_pool_forward(input, window_size, stride);
+            compare(suite, "max_pool_forward " + label, expected, input.max_pool_forward(window_size, stride), 0.0, 1);
+
+            Matrix result = random_matrix(suite, random_int(suite, 1, 8), random_int(suite, 1, 8), Values::normal);
+            input.max_pool_forward_into(window_size, stride, result);
+            compare(suite, "max_pool_forward_into " + label, expected, result, 0.0, 1);
+
+            const Matrix output = random_matrix(suite, expected.get_num_rows(), expected.get_num_columns(), Values::normal);
+            compare(suite, "max_pool_backward " + label, reference::max_pool_backward(input, output, window_size, stride),
+                    input.max_pool_backward(output, window_size, stride), 0.0, 1);
+
+            /* The tensor versions pool every channel independently */
+            const int depth = random_int(suite, 1, 4);
+            std::vector<Matrix> channels(depth, input);
+            for (int d = 1; d < depth; ++d) {
+                channels[d] = random_matrix(suite, rows, columns, Values::non_negative_ties);
+            }
+            const Tensor tensor(channels);
+            const Tensor pooled = tensor.max_pool_forward(window_size, stride);
+            for (int d = 0; d < depth; ++d) {
+                compare(suite, "tensor max_pool_forward " + label, reference::max_pool_forward(channels[d], window_size, stride),
+                        pooled(d), 0.0, 1);
+            }
+        }
+    }
+
+    /******************************************************
+     * Instruction set variants
+     *****************************************************/
+
+    bool identical(const Matrix& left, const Matrix& right) {
+        return left.get_num_rows() == right.get_num_rows() && left.get_num_columns() == right.get_num_columns() &&
+               std::memcmp(left.get_data(), right.get_data(), sizeof(double) * left.get_size()) == 0;
+    }
+
+    /* Results of every dispatched kernel on one set of random arguments */
+    std::vector<Matrix> run_kernels(const Matrix& left, const Matrix& right, const Matrix& input, const Matrix& filter,
+                                    const int stride, const std::string& padding, const Matrix& pool_input,
+                                    const int window_size, const int pool_stride) {
+        std::vector<Matrix> results;
+        results.push_back(left * right);
+        results.push_back(input.correlate(filter, stride, padding));
+        results.push_back(pool_input.max_pool_forward(window_size, pool_stride));
+        results.push_back(pool_input.max_pool_backward(results.back(), window_size, pool_stride));
+
+        void (*const activations[])(const double*, double*, const int) = {
+            kernels::relu, kernels::relu_derivative, kernels::sigmoid, kernels::sigmoid_derivative};
+        for (const auto activation : activations) {
+            Matrix output(input.get_num_rows(), input.get_num_columns());
+            activation(input.get_data(), output.get_data(), input.get_size());
+            results.push_back(output);
+        }
+        return results;
+    }
+
+    void check_isa_agreement(Suite& suite, const int iterations) {
+        const char* const names[] = {"multiply", "correlate", "max_pool_forward", "max_pool_backward",
+                                     "relu", "relu_derivative", "sigmoid", "sigmoid_derivative"};
+        const std::string paddings[] = {"valid", "same", "full"};
+        const kernels::Isa selected = kernels::get_isa();
+
+        for (int iteration = 0; iteration < iterations; ++iteration) {
+            const int inner = random_int(suite, 1, 300);
+            const Values values = random_values(suite);
+            const Matrix left = random_matrix(suite, random_int(suite, 1, 40), inner, values);
+            const Matrix right = random_matrix(suite, inner, random_int(suite, 1, 40), values);
+
+            /* Shapes every padding accepts, for a filter of at least 2x2 */
+            const int stride = random_int(suite, 1, 2);
+            const int filter_size = random_int(suite, 2, 5);
+            const int input_size = filter_size + stride * random_int(suite, 1, 12);
+            const Matrix input = random_matrix(suite, input_size, input_size, values);
+            const Matrix filter = random_matrix(suite, filter_size, filter_size, values);
+            const std::string padding = paddings[random_int(suite, 0, 2)];
+
+            const int window_size = random_int(suite, 1, 4);
+            const Matrix pool_input = random_matrix(suite, random_int(suite, window_size, 30), random_int(suite, window_size, 30),
+                                                    Values::non_negative_ties);
+            const int pool_stride = random_int(suite, 1, window_size);
+
+            kernels::set_isa(kernels::Isa::generic);
+            const std::vector<Matrix> expected = run_kernels(left, right, input, filter, stride, padding, pool_input,
+                                                             window_size, pool_stride);
+
+            for (const kernels::Isa isa : kernels::get_supported_isas()) {
+                if (isa == kernels::Isa::generic) {
+                    continue;
+                }
+                kernels::set_isa(isa);
+                const std::vector<Matrix> actual = run_kernels(left, right, input, filter, stride, padding, pool_input,
+                                                               window_size, pool_stride);
+
+                for (size_t i = 0; i < expected.size(); ++i) {
+                    ++suite.checks;
+                    if (!identical(expected[i], actual[i])) {
+                        fail(suite, std::string(names[i]) + ": " + kernels::get_isa_name(isa) + " differs from generic");
+                    }
+                }
+            }
+        }
+
+        kernels::set_isa(selected);
+    }
+
+    /******************************************************
+     * Layers
+     *****************************************************/
+
+    Tensor random_tensor(Suite& suite, const int depth, const int rows, const int columns, const Values values) {
+        std::vector<Matrix> channels;
+        for (int d = 0; d < depth; ++d) {
+            channels.push_back(random_matrix(suite, rows, columns, values));
+        }
+        return Tensor(channels);
+    }
+
+    double dot(const Tensor& left, const Tensor& right) {
+        double sum = 0.0;
+        for (int d = 0; d < left.get_depth(); ++d) {
+            for (int i = 0; i < left.get_num_rows(); ++i) {
+                for (int j = 0; j < left.get_num_columns(); ++j) {
+                    sum += left(d)(i, j) * right(d)(i, j);
+                }
+            }
+        }
+        return sum;
+    }
+
+    /* The scalar loss whose gradient with respect to the layer output is weights */
+    double loss(const Layer& layer, const Tensor& input, const Tensor& weights) {
+        Tensor output;
+        layer.infer(input, output);
+        return dot(output, weights);
+    }
+
+    double& element(Tensor& tensor, const int index) {
+        const int per_channel = tensor.get_num_rows() * tensor.get_num_columns();
+        return tensor(index / per_channel)((index % per_channel) / tensor.get_num_columns(), index % tensor.get_num_columns());
+    }
+
+    bool gradient_matches(const double analytical, const double numerical) {
+        return std::fabs(analytical - numerical) <= 1e-6 + 1e-5 * std::max(std::fabs(analytical), std::fabs(numerical));
+    }
+
+    /* Compares backward against central differences, for the input and for every parameter */
+    void check_gradients(Suite& suite, const std::string& label, Layer& layer, Tensor input) {
+        const double step = 1e-6;
+
+        Tensor output = layer.forward(input);
+        Tensor inferred;
+        layer.infer(input, inferred);
+        compare(suite, label + " infer matches forward", output(0), inferred(0), max_magnitude(output(0)), 1);
+
+        const Tensor weights = random_tensor(suite, output.get_depth(), output.get_num_rows(), output.get_num_columns(), Values::normal);
+        const Tensor input_gradient = layer.backward(weights);
+
+        ++suite.checks;
+        const int num_inputs = input.get_size();
+        for (int sample = 0; sample < std::min(num_inputs, 30); ++sample) {
+            const int index = num_inputs <= 30 ? sample : random_int(suite, 0, num_inputs - 1);
+            const double original = element(input, index);
+
+            element(input, index) = original + step;
+            const double plus = loss(layer, input, weights);
+            element(input, index) = original - step;
+            const double minus = loss(layer, input, weights);
+            element(input, index) = original;
+
+            const double numerical = (plus - minus) / (2 * step);
+            const double analytical = element(const_cast<Tensor&>(input_gradient), index);
+            if (!gradient_matches(analytical, numerical)) {
+                std::ostringstream message;
+                message << label << ": input gradient " << index << " is " << analytical << ", numerically " << numerical;
+                fail(suite, message.str());
+                break;
+            }
+        }
+
+        std::vector<Parameter> parameters = layer.get_parameters();
+        for (size_t p = 0; p < parameters.size(); ++p) {
+            ++suite.checks;
+            Tensor& value = *parameters[p].value;
+            Tensor& gradient = *parameters[p].gradient;
+            const int num_values = value.get_size();
+
+            for (int sample = 0; sample < std::min(num_values, 30); ++sample) {
+                const int index = num_values <= 30 ? sample : random_int(suite, 0, num_values - 1);
+                const double original = element(value, index);
+
+                element(value, index) = original + step;
+                const double plus = loss(layer, input, weights);
+                element(value, index) = original - step;
+                const double minus = loss(layer, input, weights);
+                element(value, index) = original;
+
+                const double numerical = (plus - minus) / (2 * step);
+                if (!gradient_matches(element(gradient, index), numerical)) {
+                    std::ostringstream message;
+                    message << label << ": parameter " << p << " gradient " << index << " is " << element(gradient, index)
+                            << ", numerically " << numerical;
+                    fail(suite, message.str());
+                    break;
+                }
+            }
+        }
+    }
+
+    /* Inputs kept away from the kinks of relu and from ties in max pooling, where the derivative is undefined */
+    Tensor smooth_input(Suite& suite, const int depth, const int rows, const int columns, const bool non_negative) {
+        Tensor input = random_tensor(suite, depth, rows, columns, Values::normal);
+        for (int i = 0; i < input.get_size(); ++i) {
+            double& value = element(input, i);
+            value = (value < 0.0 && !non_negative ? -0.1 : 0.1) + value * 0.5 + i * 1e-3;
+            if (non_negative) {
+                value = std::fabs(value) + 0.1;
+            }
+        }
+        return input;
+    }
+
+    void check_layers(Suite& suite, const int iterations) {
+        for (int iteration = 0; iteration < iterations; ++iteration) {
+            const int depth = random_int(suite, 1, 3);
+            const int rows = random_int(suite, 6, 9);
+            const int columns = random_int(suite, 6, 9);
+            const int filter_size = random_int(suite, 2, 3);
+            const int output_depth = random_int(suite, 1, 4);
+            const int input_size = random_int(suite, 1, 40);
+            const int output_size = random_int(suite, 1, 12);
+            const std::string shape = std::to_string(depth) + "x" + std::to_string(rows) + "x" + std::to_string(columns);
+
+            ConvolutionalLayer convolutional(output_depth, depth, rows, columns, filter_size, filter_size, 0.1);
+            check_gradients(suite, "convolutional " + shape, convolutional, smooth_input(suite, depth, rows, columns, false));
+
+            DenseLayer dense(input_size, output_size, 0.1);
+            check_gradients(suite, "dense " + std::to_string(input_size) + "x" + std::to_string(output_size), dense,
+                            smooth_input(suite, 1, 1, input_size, false));
+
+            ActivationLayer relu("relu");
+            check_gradients(suite, "relu " + shape, relu, smooth_input(suite, depth, rows, columns, false));
+
+            ActivationLayer sigmoid("sigmoid");
+            check_gradients(suite, "sigmoid " + shape, sigmoid, smooth_input(suite, depth, rows, columns, false));
+
+            const int window_size = random_int(suite, 2, 3);
+            MaxPoolLayer max_pool(window_size, random_int(suite, 1, window_size));
+            check_gradients(suite, "max_pool " + shape, max_pool, smooth_input(suite, depth, rows, columns, true));
+
+            FlattenLayer flatten(depth, rows, columns);
+            check_gradients(suite, "flatten " + shape, flatten, smooth_input(suite, depth, rows, columns, false));
+        }
+
+        /* ActivationLayer has no softmax derivative, softmax is only used for inference */
+        ++suite.skipped;
+    }
+
+    /******************************************************
+     * C interface
+     *****************************************************/
+
+    void expect_status(Suite& suite, const std::string& label, const cnn_status expected, const cnn_status actual) {
+        ++suite.checks;
+        if (actual != expected) {
+            fail(suite, label + ": returned " + cnn_status_string(actual) + ", expected " + cnn_status_string(expected) +
+                        " (" + cnn_last_error() + ")");
+        }
+    }
+
+    /* Runs a checkpointed network through the C interface and compares it with predict */
+    void check_c_interface(Suite& suite, const int iterations) {
+        const std::string path = "/tmp/cnn_conformance_" + std::to_string(::getpid()) + ".ckpt";
+        NeuralNetwork network = create_mnist_network(0.1);
+        checkpoint::save(network, path);
+
+        cnn_model* model = nullptr;
+        expect_status(suite, "cnn_model_create missing file", CNN_ERROR_IO, cnn_model_create((path + ".missing").c_str(), &model));
+        expect_status(suite, "cnn_model_create", CNN_OK, cnn_model_create(path.c_str(), &model));
+        std::remove(path.c_str());
+        if (model == nullptr) {
+            return;
+        }
+
+        cnn_shape input_shape;
+        cnn_shape output_shape;
+        expect_status(suite, "cnn_model_input_shape", CNN_OK, cnn_model_input_shape(model, &input_shape));
+        expect_status(suite, "cnn_model_output_shape", CNN_OK, cnn_model_output_shape(model, &output_shape));
+        ++suite.checks;
+        if (input_shape.depth != 1 || input_shape.rows != 28 || input_shape.columns != 28 ||
+            output_shape.depth != 1 || output_shape.rows != 1 || output_shape.columns != 10) {
+            fail(suite, "cnn shapes: unexpected input or output shape");
+        }
+
+        const int input_size = input_shape.depth * input_shape.rows * input_shape.columns;
+        const int output_size = output_shape.depth * output_shape.rows * output_shape.columns;
+
+        for (int iteration = 0; iteration < iterations; ++iteration) {
+            const int batch_size = random_int(suite, 0, 4);
+            std::vector<float> inputs(batch_size * input_size);
+            for (float& value : inputs) {
+                value = static_cast<float>(random_int(suite, 0, 255) / 255.0);
+            }
+
+            std::vector<float> outputs(batch_size * output_size);
+            expect_status(suite, "cnn_model_run batch " + std::to_string(batch_size), CNN_OK,
+                          cnn_model_run(model, inputs.data(), batch_size, outputs.data()));
+
+            for (int sample = 0; sample < batch_size; ++sample) {
+                Tensor input(input_shape.depth, input_shape.rows, input_shape.columns);
+                for (int i = 0; i < input_size; ++i) {
+                    input(i / (input_shape.rows * input_shape.columns)).get_data()[i % (input_shape.rows * input_shape.columns)] =
+                        inputs[sample * input_size + i];
+                }
+                const Tensor expected = network.predict(input);
+
+                ++suite.checks;
+                for (int i = 0; i < output_size; ++i) {
+                    if (outputs[sample * output_size + i] != static_cast<float>(expected(0).get_data()[i])) {
+                        fail(suite, "cnn_model_run: output " + std::to_string(i) + " of sample " + std::to_string(sample) +
+                                    " differs from predict");
+                        break;
+                    }
+                }
+            }
+        }
+
+        float value = 0.0f;
+        expect_status(suite, "cnn_model_run null inputs", CNN_ERROR_INVALID_ARGUMENT, cnn_model_run(model, nullptr, 1, &value));
+        expect_status(suite, "cnn_model_run negative batch", CNN_ERROR_INVALID_ARGUMENT, cnn_model_run(model, &value, -1, &value));
+        expect_status(suite, "cnn_model_input_shape null", CNN_ERROR_INVALID_ARGUMENT, cnn_model_input_shape(nullptr, &input_shape));
+        cnn_model_destroy(model);
+    }
+
+    /******************************************************
+     * Evaluation
+     *****************************************************/
+
+    /* Evaluates a random data set with random batch sizes and compares it with a serial predict loop */
+    void check_evaluation(Suite& suite, const int iterations) {
+        const std::string path = "/tmp/cnn_conformance_" + std::to_string(::getpid()) + ".csv";
+        {
+            std::ofstream file(path);
+            file << "label";
+            for (int i = 0; i < 784; ++i) {
+                file << ",p" << i;
+            }
+            for (int sample = 0; sample < 200; ++sample) {
+                file << "\n" << random_int(suite, 0, 9);
+                for (int i = 0; i < 784; ++i) {
+                    file << "," << random_int(suite, 0, 255);
+                }
+            }
+            file << "\n";
+        }
+        const MNISTDataSet data_set(path);
+        std::remove(path.c_str());
+
+        const NeuralNetwork network = create_mnist_network(0.1);
+
+        long num_correct = 0;
+        double loss_sum = 0.0;
+        std::vector<std::vector<long>> confusion(10, std::vector<long>(10, 0));
+        Tensor input;
+        Tensor label;
+        for (int i = 0; i < data_set.get_test_size(); ++i) {
+            data_set.get_test_data(i, input);
+            data_set.get_test_label(i, label);
+            const Tensor output = network.predict(input);
+
+            num_correct += utility::argmax(output) == utility::argmax(label);
+            loss_sum += utility::cross_entropy(output, label);
+            ++confusion[utility::argmax(label)][utility::argmax(output)];
+        }
+
+        for (int iteration = 0; iteration < iterations; ++iteration) {
+            const int batch_size = iteration == 0 ? 256 : random_int(suite, 1, 24);
+            const evaluation::Evaluation evaluated = evaluation::evaluate(network, data_set, batch_size);
+            const std::string label_text = "evaluate batch " + std::to_string(batch_size);
+
+            ++suite.checks;
+            if (evaluated.num_samples != data_set.get_test_size() || evaluated.num_correct != num_correct ||
+                evaluated.confusion != confusion) {
+                fail(suite, label_text + ": counts differ from a serial predict loop");
+            }
+
+            /* Losses are summed in sample order, so they match exactly */
+            ++suite.checks;
+            if (evaluated.loss != loss_sum / data_set.get_test_size()) {
+                fail(suite, label_text + ": loss differs from a serial predict loop");
+            }
+        }
+    }
+
+    /******************************************************
+     * Learning rate schedules
+     *****************************************************/
+
+    void expect_multiplier(Suite& suite, const std::string& label, const std::function<double(const long)>& schedule,
+                           const long step, const double expected) {
+        ++suite.checks;
+        if (std::fabs(schedule(step) - expected) > 1e-15) {
+            fail(suite, label + " at step " + std::to_string(step) + ": " + std::to_string(schedule(step)) + ", expected " +
+                        std::to_string(expected));
+        }
+    }
+
+    /* Multipliers at the step boundaries, and their effect on the updates of Optimizer::step */
+    void check_schedules(Suite& suite) {
+        const std::function<double(const long)> constant = schedules::constant();
+        const std::function<double(const long)> step_decay = schedules::step_decay(0.5, 3);
+        const std::function<double(const long)> exponential = schedules::exponential_decay(0.25, 2);
+
+        expect_multiplier(suite, "constant", constant, 0, 1.0);
+        expect_multiplier(suite, "constant", constant, 1000000, 1.0);
+        expect_multiplier(suite, "step_decay", step_decay, 0, 1.0);
+        expect_multiplier(suite, "step_decay", step_decay, 2, 1.0);
+        expect_multiplier(suite, "step_decay", step_decay, 3, 0.5);
+        expect_multiplier(suite, "step_decay", step_decay, 5, 0.5);
+        expect_multiplier(suite, "step_decay", step_decay, 6, 0.25);
+        expect_multiplier(suite, "exponential_decay", exponential, 0, 1.0);
+        expect_multiplier(suite, "exponential_decay", exponential, 1, 0.5);
+        expect_multiplier(suite, "exponential_decay", exponential, 2, 0.25);
+        expect_multiplier(suite, "exponential_decay", exponential, 4, 0.0625);
+
+        ++suite.checks;
+        try {
+            schedules::step_decay(0.5, 0);
+            fail(suite, "step_decay: accepted a step_size of 0");
+        }
+        catch (const std::invalid_argument&) {}
+
+        /* A gradient of 1 with a learning rate of 1 moves the value by exactly the multiplier of each update */
+        SGDOptimizer optimizer;
+        optimizer.set_schedule(step_decay);
+        Tensor value(1, 1, 1);
+        Tensor gradient(1, 1, 1);
+        const std::vector<Parameter> parameters = {Parameter {&value, &gradient, 1.0}};
+
+        for (long step = 0; step < 7; ++step) {
+            const double before = value(0)(0, 0);
+            gradient(0)(0, 0) = 1.0;
+            optimizer.step(parameters, 1);
+
+            ++suite.checks;
+            if (before - value(0)(0, 0) != step_decay(step)) {
+                fail(suite, "Optimizer step " + std::to_string(step) + ": update does not follow the schedule");
+            }
+        }
+    }
+
+    /******************************************************
+     * CSV records
+     *****************************************************/
+
+    /* Parses a line with the given label and one replaced pixel, expecting an error containing message,
+     * or success when message is empty */
+    void expect_csv_line(Suite& suite, const std::string& label, const std::string& pixel, const std::string& message) {
+        std::string line = label;
+        for (int i = 0; i < mnist_record::num_pixels; ++i) {
+            line += "," + (i == mnist_record::num_pixels / 2 ? pixel : std::to_string(i % 256));
+        }
+
+        uint8_t record[mnist_record::record_bytes];
+        std::string error;
+        try {
+            mnist_record::parse_csv_line(line.data(), line.data() + line.size(), record, 1);
+        }
+        catch (const std::invalid_argument& caught) {
+            error = caught.what();
+        }
+
+        ++suite.checks;
+        if (message.empty() ? !error.empty() : error.find(message) == std::string::npos) {
+            fail(suite, "parse_csv_line label " + label + " pixel " + pixel + ": got \"" + error + "\", expected \"" +
+                        message + "\"");
+        }
+        else if (message.empty() && record[1 + mnist_record::num_pixels / 2] != std::stoi(pixel)) {
+            fail(suite, "parse_csv_line pixel " + pixel + ": parsed the wrong value");
+        }
+    }
+
+    /* Boundary and overlong tokens, which must not wrap around into valid values */
+    void check_csv_records(Suite& suite) {
+        expect_csv_line(suite, "9", "255", "");
+        expect_csv_line(suite, "0", "0000000000000000000255", "");
+        expect_csv_line(suite, "3", "256", "pixel out of range");
+        expect_csv_line(suite, "3", "4294967296", "pixel out of range");
+        expect_csv_line(suite, "3", "4294967297", "pixel out of range");
+        expect_csv_line(suite, "3", "99999999999999999999999999", "pixel out of range");
+        expect_csv_line(suite, "10", "1", "invalid label");
+        expect_csv_line(suite, "4294967296", "1", "invalid label");
+        expect_csv_line(suite, "18446744073709551619", "1", "invalid label");
+    }
+}
+
+int main(int argc, char* argv[]) {
+
+    int iterations = 300;
+    unsigned seed = 1;
+    std::vector<kernels::Isa> isas = kernels::get_supported_isas();
+
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+
+        if (argument == "--iterations" && i + 1 < argc) {
+            iterations = std::stoi(argv[++i]);
+        }
+        else if (argument == "--seed" && i + 1 < argc) {
+            seed = static_cast<unsigned>(std::stoul(argv[++i]));
+        }
+        else if (argument == "--isa" && i + 1 < argc) {
+            isas.assign(1, kernels::parse_isa(argv[++i]));
+            if (!kernels::is_supported(isas[0])) {
+                std::cerr << argv[i] << " is not supported by this CPU" << std::endl;
+                return 1;
+            }
+        }
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--iterations count] [--seed seed] [--isa name]" << std::endl;
+            return 1;
+        }
+    }
+
+    Suite suite = {std::mt19937(seed), 0, 0, 0};
+    utility::seed_random(seed);
+
+    struct Section {
+        const char* name;
+        void (*run)(Suite&, const int);
+        int iterations;
+    };
+    const Section sections[] = {
+        {"multiply", fuzz_multiply, iterations},
+        {"correlate/convolve", fuzz_correlate, iterations * 4},
+        {"max_pool", fuzz_max_pool, iterations * 2},
+        {"layer gradients", check_layers, std::max(1, iterations / 10)},
+    };
+
+    for (const kernels::Isa isa : isas) {
+        kernels::set_isa(isa);
+
+        for (const Section& section : sections) {
+            const long checks = suite.checks;
+            const long failures = suite.failures;
+            section.run(suite, section.iterations);
+            std::cout << section.name << " (" << kernels::get_isa_name(isa) << "): " << (suite.checks - checks) << " checks, "
+                      << (suite.failures - failures) << " failures" << std::endl;
+        }
+    }
+
+    if (isas.size() > 1) {
+        const long checks = suite.checks;
+        const long failures = suite.failures;
+        check_isa_agreement(suite, iterations);
+        std::cout << "instruction set agreement: " << (suite.checks - checks) << " checks, " << (suite.failures - failures)
+                  << " failures" << std::endl;
+    }
+
+    const long checks = suite.checks;
+    const long failures = suite.failures;
+    check_c_interface(suite, std::max(1, iterations / 10));
+    std::cout << "c interface: " << (suite.checks - checks) << " checks, " << (suite.failures - failures) << " failures"
+              << std::endl;
+
+    const long evaluation_checks = suite.checks;
+    const long evaluation_failures = suite.failures;
+    check_evaluation(suite, std::max(1, iterations / 30));
+    std::cout << "evaluation: " << (suite.checks - evaluation_checks) << " checks, "
+              << (suite.failures - evaluation_failures) << " failures" << std::endl;
+
+    const long schedule_checks = suite.checks;
+    const long schedule_failures = suite.failures;
+    check_schedules(suite);
+    std::cout << "learning rate schedules: " << (suite.checks - schedule_checks) << " checks, "
+              << (suite.failures - schedule_failures) << " failures" << std::endl;
+
+    const long csv_checks = suite.checks;
+    const long csv_failures = suite.failures;
+    check_csv_records(suite);
+    std::cout << "csv records: " << (suite.checks - csv_checks) << " checks, " << (suite.failures - csv_failures)
+              << " failures" << std::endl;
+
+    std::cout << suite.checks << " checks, " << suite.failures << " failures, " << suite.skipped << " skipped (seed " << seed << ")"
+              << std::endl;
+    return suite.failures == 0 ? 0 : 1;
+}
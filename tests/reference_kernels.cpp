@@ -0,0 +1,157 @@
+#include <string>
+#include <stdexcept>
+#include "reference_kernels.hpp"
+#include "matrix.hpp"
+
+namespace {
+
+    /* The padding the library splits between the two sides, the odd element going first */
+    int leading_padding(const int padding) {
+        return padding / 2 + padding % 2;
+    }
+}
+
+Matrix reference::multiply(const Matrix& left, const Matrix& right) {
+    Matrix result(left.get_num_rows(), right.get_num_columns());
+
+    for (int i = 0; i < left.get_num_rows(); ++i) {
+        for (int j = 0; j < right.get_num_columns(); ++j) {
+            double sum = 0.0;
+            for (int k = 0; k < left.get_num_columns(); ++k) {
+                sum += left(i, k) * right(k, j);
+            }
+            result(i, j) = sum;
+        }
+    }
+
+    return result;
+}
+
+Matrix reference::correlate(const Matrix& input, const Matrix& filter, const int stride, const std::string& padding_type) {
+    const int rows = input.get_num_rows();
+    const int columns = input.get_num_columns();
+    const int filter_rows = filter.get_num_rows();
+    const int filter_columns = filter.get_num_columns();
+
+    int result_rows = 0;
+    int result_columns = 0;
+    if (padding_type == "full") {
+        result_rows = (rows + filter_rows - 2) / stride + 1;
+        result_columns = (columns + filter_columns - 2) / stride + 1;
+    }
+    else if (padding_type == "same") {
+        result_rows = rows;
+        result_columns = columns;
+    }
+    else if (padding_type == "valid") {
+        result_rows = (rows - filter_rows) / stride + 1;
+        result_columns = (columns - filter_columns) / stride + 1;
+    }
+    else {
+        throw std::invalid_argument("Reference correlate: invalid padding_type");
+    }
+
+    Matrix result(result_rows, result_columns);
+    const int padding_top = leading_padding((result_rows - 1) * stride + filter_rows - rows);
+    const int padding_left = leading_padding((result_columns - 1) * stride + filter_columns - columns);
+
+    for (int i = 0; i < result_rows; ++i) {
+        for (int j = 0; j < result_columns; ++j) {
+            double sum = 0.0;
+
+            for (int k = 0; k < filter_rows; ++k) {
+                for (int l = 0; l < filter_columns; ++l) {
+                    const int row = i * stride + k - padding_top;
+                    const int column = j * stride + l - padding_left;
+                    if (row >= 0 && row < rows && column >= 0 && column < columns) {
+                        sum += input(row, column) * filter(k, l);
+                    }
+                }
+            }
+
+            result(i, j) = sum;
+        }
+    }
+
+    return result;
+}
+
+Matrix reference::convolve(const Matrix& input, const Matrix& filter, const int stride, const std::string& padding_type) {
+    Matrix rotated(filter.get_num_rows(), filter.get_num_columns());
+
+    for (int i = 0; i < filter.get_num_rows(); ++i) {
+        for (int j = 0; j < filter.get_num_columns(); ++j) {
+            rotated(i, j) = filter(filter.get_num_rows() - 1 - i, filter.get_num_columns() - 1 - j);
+        }
+    }
+
+    return correlate(input, rotated, stride, padding_type);
+}
+
+Matrix reference::max_pool_forward(const Matrix& input, const int window_size, const int stride) {
+    const int rows = input.get_num_rows();
+    const int columns = input.get_num_columns();
+    const int result_rows = (rows - window_size + stride - 1) / stride + 1;
+    const int result_columns = (columns - window_size + stride - 1) / stride + 1;
+
+    Matrix result(result_rows, result_columns);
+    const int padding_top = leading_padding((result_rows - 1) * stride + window_size - rows);
+    const int padding_left = leading_padding((result_columns - 1) * stride + window_size - columns);
+
+    /* Padding counts as zero, which is why the inputs must not be negative */
+    for (int i = 0; i < result_rows; ++i) {
+        for (int j = 0; j < result_columns; ++j) {
+            double max = 0.0;
+
+            for (int k = 0; k < window_size; ++k) {
+                for (int l = 0; l < window_size; ++l) {
+                    const int row = i * stride + k - padding_top;
+                    const int column = j * stride + l - padding_left;
+                    if (row >= 0 && row < rows && column >= 0 && column < columns && input(row, column) >= max) {
+                        max = input(row, column);
+                    }
+                }
+            }
+
+            result(i, j) = max;
+        }
+    }
+
+    return result;
+}
+
+Matrix reference::max_pool_backward(const Matrix& input, const Matrix& output, const int window_size, const int stride) {
+    const int rows = input.get_num_rows();
+    const int columns = input.get_num_columns();
+    const int result_rows = output.get_num_rows();
+    const int result_columns = output.get_num_columns();
+
+    Matrix result(rows, columns);
+    const int padding_top = leading_padding((result_rows - 1) * stride + window_size - rows);
+    const int padding_left = leading_padding((result_columns - 1) * stride + window_size - columns);
+
+    /* Every window routes its gradient to its last maximum, overlapping windows that choose the same element add up */
+    for (int i = 0; i < result_rows; ++i) {
+        for (int j = 0; j < result_columns; ++j) {
+            double max = 0.0;
+            int max_row = i * stride - padding_top;
+            int max_column = j * stride - padding_left;
+
+            for (int k = 0; k < window_size; ++k) {
+                for (int l = 0; l < window_size; ++l) {
+                    const int row = i * stride + k - padding_top;
+                    const int column = j * stride + l - padding_left;
+                    if (row >= 0 && row < rows && column >= 0 && column < columns && input(row, column) >= max) {
+                        max = input(row, column);
+                        max_row = row;
+                        max_column = column;
+                    }
+                }
+            }
+
+            result(max_row, max_column) += output(i, j);
+        }
+    }
+
+    return result;
+}
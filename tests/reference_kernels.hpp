@@ -0,0 +1,19 @@
+#ifndef REFERENCE_KERNELS_HPP
+#define REFERENCE_KERNELS_HPP
+
+#include <string>
+#include "matrix.hpp"
+
+/* Frozen copies of the original, straightforward Matrix kernels. They only use
+ * the element accessor, so they stay correct however the library kernels are
+ * rewritten. Keep them simple and never optimize them: the conformance suite
+ * trusts them as the definition of the right answer. */
+namespace reference {
+    Matrix multiply(const Matrix& left, const Matrix& right);
+    Matrix correlate(const Matrix& input, const Matrix& filter, const int stride, const std::string& padding_type);
+    Matrix convolve(const Matrix& input, const Matrix& filter, const int stride, const std::string& padding_type);
+    Matrix max_pool_forward(const Matrix& input, const int window_size, const int stride);
+    Matrix max_pool_backward(const Matrix& input, const Matrix& output, const int window_size, const int stride);
+}
+
+#endif
@@ -0,0 +1,253 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <cmath>
+#include "matrix.hpp"
+#include "tensor.hpp"
+#include "layer.hpp"
+#include "convolutional_layer.hpp"
+#include "dense_layer.hpp"
+#include "activation_layer.hpp"
+#include "max_pool_layer.hpp"
+#include "flatten_layer.hpp"
+#include "thread_pool.hpp"
+#include "kernels.hpp"
+#include "utility.hpp"
+
+namespace {
+
+    /* Results are folded into a global so the compiler cannot drop the timed work */
+    volatile double sink = 0.0;
+
+    struct Benchmark {
+        std::string name;
+        std::function<void()> body;
+    };
+
+    struct Result {
+        std::string name;
+        int iterations;
+        std::vector<double> times_ns;
+    };
+
+    Matrix random_matrix(const int rows, const int columns) {
+        Matrix matrix(rows, columns);
+        matrix.randomize(0.0, 1.0);
+        return matrix;
+    }
+
+    Tensor random_tensor(const int depth, const int rows, const int columns) {
+        Tensor tensor(depth, rows, columns);
+        tensor.randomize(0.0, 1.0);
+        return tensor;
+    }
+
+    /* Pooling follows relu in main.cpp and only pads non-negative inputs */
+    Tensor non_negative_tensor(const int depth, const int rows, const int columns) {
+        Tensor tensor = random_tensor(depth, rows, columns);
+        for (int d = 0; d < depth; ++d) {
+            for (int r = 0; r < rows; ++r) {
+                for (int c = 0; c < columns; ++c) {
+                    tensor(d)(r, c) = std::abs(tensor(d)(r, c));
+                }
+            }
+        }
+        return tensor;
+    }
+
+    void add_matrix_benchmarks(std::vector<Benchmark>& benchmarks) {
+        struct MultiplyShape { int rows; int inner; int columns; };
+        for (const MultiplyShape& shape : {MultiplyShape {1, 1152, 100}, MultiplyShape {1, 100, 10}, MultiplyShape {256, 256, 256}}) {
+            auto a = std::make_shared<Matrix>(random_matrix(shape.rows, shape.inner));
+            auto b = std::make_shared<Matrix>(random_matrix(shape.inner, shape.columns));
+            benchmarks.push_back({"matrix_multiply/" + std::to_string(shape.rows) + "x" + std::to_string(shape.inner) + "x" +
+                                  std::to_string(shape.columns), [a, b] { sink = sink + ((*a) * (*b))(0, 0); }});
+        }
+
+        struct CorrelateShape { int size; int filter; };
+        for (const CorrelateShape& shape : {CorrelateShape {28, 3}, CorrelateShape {13, 3}, CorrelateShape {128, 5}}) {
+            auto input = std::make_shared<Matrix>(random_matrix(shape.size, shape.size));
+            auto filter = std::make_shared<Matrix>(random_matrix(shape.filter, shape.filter));
+            for (const std::string padding : {"valid", "same", "full"}) {
+                benchmarks.push_back({"matrix_correlate_" + padding + "/" + std::to_string(shape.size) + "x" + std::to_string(shape.size) +
+                                      "_" + std::to_string(shape.filter) + "x" + std::to_string(shape.filter),
+                                      [input, filter, padding] { sink = sink + input->correlate(*filter, 1, padding)(0, 0); }});
+            }
+        }
+    }
+
+    void add_tensor_benchmarks(std::vector<Benchmark>& benchmarks) {
+        struct PoolShape { int depth; int size; };
+        for (const PoolShape& shape : {PoolShape {16, 26}, PoolShape {32, 11}, PoolShape {64, 64}}) {
+            auto input = std::make_shared<Tensor>(non_negative_tensor(shape.depth, shape.size, shape.size));
+            auto gradient = std::make_shared<Tensor>(input->max_pool_forward(2, 2));
+            gradient->randomize(0.0, 0.01);
+            const std::string suffix = "/" + std::to_string(shape.depth) + "x" + std::to_string(shape.size) + "x" + std::to_string(shape.size);
+
+            benchmarks.push_back({"max_pool_forward" + suffix, [input] { sink = sink + input->max_pool_forward(2, 2)(0)(0, 0); }});
+            benchmarks.push_back({"max_pool_backward" + suffix, [input, gradient] {
+                sink = sink + input->max_pool_backward(*gradient, 2, 2)(0)(0, 0);
+            }});
+        }
+    }
+
+    /* Forward and backward of a layer, the backward runs against a single earlier forward */
+    void add_layer_benchmarks(std::vector<Benchmark>& benchmarks, const std::string& name,
+                              std::shared_ptr<Layer> layer, const Tensor& input) {
+        auto layer_input = std::make_shared<Tensor>(input);
+        Tensor output = layer->forward(input);
+        auto gradient = std::make_shared<Tensor>(output);
+        gradient->randomize(0.0, 0.01);
+
+        benchmarks.push_back({name + "_forward", [layer, layer_input] { sink = sink + layer->forward(*layer_input)(0)(0, 0); }});
+        benchmarks.push_back({name + "_backward", [layer, gradient] { sink = sink + layer->backward(*gradient)(0)(0, 0); }});
+    }
+
+    void add_network_benchmarks(std::vector<Benchmark>& benchmarks) {
+        /* Activations at the shapes they see in main.cpp, softmax has no backward */
+        add_layer_benchmarks(benchmarks, "relu/16x26x26", std::make_shared<ActivationLayer>("relu"), random_tensor(16, 26, 26));
+        add_layer_benchmarks(benchmarks, "sigmoid/1x1x100", std::make_shared<ActivationLayer>("sigmoid"), random_tensor(1, 1, 100));
+        auto softmax = std::make_shared<ActivationLayer>("softmax");
+        auto logits = std::make_shared<Tensor>(random_tensor(1, 1, 10));
+        benchmarks.push_back({"softmax/1x1x10_forward", [softmax, logits] { sink = sink + softmax->forward(*logits)(0)(0, 0); }});
+
+        /* The layers of main.cpp, then larger versions */
+        add_layer_benchmarks(benchmarks, "convolutional/1x28x28_16x3x3",
+                             std::make_shared<ConvolutionalLayer>(16, 1, 28, 28, 3, 3, 1e-4), random_tensor(1, 28, 28));
+        add_layer_benchmarks(benchmarks, "convolutional/16x13x13_32x3x3",
+                             std::make_shared<ConvolutionalLayer>(32, 16, 13, 13, 3, 3, 1e-4), random_tensor(16, 13, 13));
+        add_layer_benchmarks(benchmarks, "convolutional/32x32x32_64x3x3",
+                             std::make_shared<ConvolutionalLayer>(64, 32, 32, 32, 3, 3, 1e-4), random_tensor(32, 32, 32));
+        add_layer_benchmarks(benchmarks, "max_pool/16x26x26", std::make_shared<MaxPoolLayer>(2, 2), non_negative_tensor(16, 26, 26));
+        add_layer_benchmarks(benchmarks, "max_pool/32x11x11", std::make_shared<MaxPoolLayer>(2, 2), non_negative_tensor(32, 11, 11));
+        add_layer_benchmarks(benchmarks, "flatten/32x6x6", std::make_shared<FlattenLayer>(32, 6, 6), random_tensor(32, 6, 6));
+        add_layer_benchmarks(benchmarks, "dense/1152x100", std::make_shared<DenseLayer>(1152, 100, 1e-4), random_tensor(1, 1, 1152));
+        add_layer_benchmarks(benchmarks, "dense/100x10", std::make_shared<DenseLayer>(100, 10, 1e-4), random_tensor(1, 1, 100));
+        add_layer_benchmarks(benchmarks, "dense/4096x1024", std::make_shared<DenseLayer>(4096, 1024, 1e-4), random_tensor(1, 1, 4096));
+    }
+
+    /* Repeats the body enough times per repetition that timer resolution does not matter */
+    Result run(const Benchmark& benchmark, const int warmup, const int repetitions, const double min_repetition_ns) {
+        for (int i = 0; i < warmup; ++i) {
+            benchmark.body();
+        }
+
+        auto beg = std::chrono::steady_clock::now();
+        benchmark.body();
+        const double single_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - beg).count();
+        const int iterations = std::max(1, static_cast<int>(min_repetition_ns / std::max(single_ns, 1.0)));
+
+        Result result = {benchmark.name, iterations, {}};
+        for (int r = 0; r < repetitions; ++r) {
+            beg = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; ++i) {
+                benchmark.body();
+            }
+            const double elapsed_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - beg).count();
+            result.times_ns.push_back(elapsed_ns / iterations);
+        }
+
+        return result;
+    }
+
+    std::string to_json(const std::vector<Result>& results, const int warmup, const int repetitions) {
+        std::ostringstream json;
+        json << std::setprecision(6) << std::fixed;
+        json << "{\"threads\":" << ThreadPool::get_global().get_num_threads()
+             << ",\"isa\":\"" << kernels::get_isa_name(kernels::get_isa()) << "\",\"warmup\":" << warmup
+             << ",\"repetitions\":" << repetitions << ",\"benchmarks\":[";
+
+        for (size_t i = 0; i < results.size(); ++i) {
+            const std::vector<double>& times = results[i].times_ns;
+            json << (i > 0 ? "," : "") << "{\"name\":\"" << results[i].name << "\",\"iterations\":" << results[i].iterations
+                 << ",\"min_ns\":" << *std::min_element(times.begin(), times.end())
+                 << ",\"median_ns\":" << utility::percentile(times, 0.5)
+                 << ",\"p10_ns\":" << utility::percentile(times, 0.1)
+                 << ",\"p90_ns\":" << utility::percentile(times, 0.9)
+                 << ",\"max_ns\":" << *std::max_element(times.begin(), times.end()) << "}";
+        }
+
+        json << "]}";
+        return json.str();
+    }
+}
+
+int main(int argc, char* argv[]) {
+
+    int warmup = 3;
+    int repetitions = 15;
+    double min_repetition_ms = 5.0;
+    std::string filter;
+    std::string json_path;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+
+        if (argument == "--warmup" && i + 1 < argc) {
+            warmup = std::stoi(argv[++i]);
+        }
+        else if (argument == "--repetitions" && i + 1 < argc) {
+            repetitions = std::stoi(argv[++i]);
+        }
+        else if (argument == "--min-time-ms" && i + 1 < argc) {
+            min_repetition_ms = std::stod(argv[++i]);
+        }
+        else if (argument == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        }
+        else if (argument == "--json" && i + 1 < argc) {
+            json_path = argv[++i];
+        }
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--warmup iterations] [--repetitions count] [--min-time-ms per_repetition]"
+                      << " [--filter name_substring] [--json path]" << std::endl;
+            return 1;
+        }
+    }
+
+    if (repetitions <= 0) {
+        std::cerr << "--repetitions must be greater than 0" << std::endl;
+        return 1;
+    }
+
+    std::vector<Benchmark> benchmarks;
+    add_matrix_benchmarks(benchmarks);
+    add_tensor_benchmarks(benchmarks);
+    add_network_benchmarks(benchmarks);
+
+    std::cout << std::left << std::setw(48) << "benchmark" << std::right << std::setw(14) << "median us"
+              << std::setw(14) << "p10 us" << std::setw(14) << "p90 us" << std::endl;
+
+    std::vector<Result> results;
+    for (const Benchmark& benchmark : benchmarks) {
+        if (benchmark.name.find(filter) == std::string::npos) {
+            continue;
+        }
+
+        results.push_back(run(benchmark, warmup, repetitions, min_repetition_ms * 1e6));
+        const std::vector<double>& times = results.back().times_ns;
+        std::cout << std::left << std::setw(48) << benchmark.name << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(14) << utility::percentile(times, 0.5) / 1000.0
+                  << std::setw(14) << utility::percentile(times, 0.1) / 1000.0
+                  << std::setw(14) << utility::percentile(times, 0.9) / 1000.0 << std::endl;
+    }
+
+    if (!json_path.empty()) {
+        std::ofstream file(json_path);
+        file << to_json(results, warmup, repetitions) << std::endl;
+        if (!file) {
+            std::cerr << "Failed to write " << json_path << std::endl;
+            return 1;
+        }
+        std::cout << "Wrote " << json_path << std::endl;
+    }
+
+    return 0;
+}
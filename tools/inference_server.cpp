@@ -0,0 +1,105 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <csignal>
+#include "neural_network.hpp"
+#include "mnist_network.hpp"
+#include "inference_server.hpp"
+#include "checkpoint.hpp"
+#include "tracer.hpp"
+
+namespace {
+    InferenceServer* running_server = nullptr;
+
+    void handle_signal(int signal) {
+        (void)signal;
+        if (running_server != nullptr) {
+            running_server->request_stop();
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+
+    std::string socket_path = "/tmp/cnn_inference.sock";
+    int max_batch_size = 32;
+    int max_delay_us = 2000;
+    int stats_interval_s = 5;
+    std::string model_path;
+    std::string trace_path;
+    long trace_sample_interval = 1;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+
+        if (argument == "--socket" && i + 1 < argc) {
+            socket_path = argv[++i];
+        }
+        else if (argument == "--max-batch" && i + 1 < argc) {
+            max_batch_size = std::stoi(argv[++i]);
+        }
+        else if (argument == "--max-delay-us" && i + 1 < argc) {
+            max_delay_us = std::stoi(argv[++i]);
+        }
+        else if (argument == "--stats-interval" && i + 1 < argc) {
+            stats_interval_s = std::stoi(argv[++i]);
+        }
+        else if (argument == "--model" && i + 1 < argc) {
+            model_path = argv[++i];
+        }
+        else if (argument == "--trace" && i + 1 < argc) {
+            trace_path = argv[++i];
+        }
+        else if (argument == "--trace-sample" && i + 1 < argc) {
+            trace_sample_interval = std::stol(argv[++i]);
+        }
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--socket path] [--max-batch size] [--max-delay-us microseconds]"
+                      << " [--stats-interval seconds] [--model checkpoint] [--trace path] [--trace-sample interval]" << std::endl;
+            return 1;
+        }
+    }
+
+    if (!trace_path.empty()) {
+        Tracer::get_global().enable(1 << 16, trace_sample_interval);
+    }
+
+    // Without a checkpoint the weights are untrained, which still exercises the serving path
+    NeuralNetwork network = model_path.empty() ? create_mnist_network(0.1) : checkpoint::load(model_path);
+
+    InferenceServer server(network, socket_path, 1, 28, 28, max_batch_size, std::chrono::microseconds(max_delay_us));
+    running_server = &server;
+    std::signal(SIGINT, handle_signal);
+    std::signal(SIGTERM, handle_signal);
+
+    std::atomic<bool> finished(false);
+    std::thread reporter([&] {
+        auto next_report = std::chrono::steady_clock::now() + std::chrono::seconds(stats_interval_s);
+        while (!finished) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            if (stats_interval_s > 0 && std::chrono::steady_clock::now() >= next_report) {
+                std::cout << server.get_stats_json() << std::endl;
+                next_report += std::chrono::seconds(stats_interval_s);
+            }
+        }
+    });
+
+    std::cout << "Listening on " << socket_path << " (max batch " << max_batch_size << ", max delay "
+              << max_delay_us << "us)" << std::endl;
+    server.run();
+
+    finished = true;
+    reporter.join();
+    running_server = nullptr;
+
+    std::cout << server.get_stats_json() << std::endl;
+
+    if (!trace_path.empty()) {
+        Tracer::get_global().disable();
+        Tracer::get_global().write(trace_path);
+        std::cout << "Wrote " << Tracer::get_global().get_num_events() << " trace events to " << trace_path << std::endl;
+    }
+    return 0;
+}
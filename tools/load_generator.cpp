@@ -0,0 +1,138 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <random>
+#include <cstdint>
+#include <stdexcept>
+#include <unistd.h>
+#include "inference_protocol.hpp"
+#include "utility.hpp"
+
+int main(int argc, char* argv[]) {
+
+    std::string socket_path = "/tmp/cnn_inference.sock";
+    int num_connections = 8;
+    int requests_per_connection = 1000;
+    int input_size = 28 * 28;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+
+        if (argument == "--socket" && i + 1 < argc) {
+            socket_path = argv[++i];
+        }
+        else if (argument == "--connections" && i + 1 < argc) {
+            num_connections = std::stoi(argv[++i]);
+        }
+        else if (argument == "--requests" && i + 1 < argc) {
+            requests_per_connection = std::stoi(argv[++i]);
+        }
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--socket path] [--connections count] [--requests per_connection]" << std::endl;
+            return 1;
+        }
+    }
+
+    /* Every connection sends its next request as soon as the previous response arrives */
+    std::vector<std::vector<double>> latencies_us(num_connections);
+    std::vector<int> failures(num_connections, 0);
+    std::vector<std::thread> clients;
+
+    auto beg = std::chrono::steady_clock::now();
+
+    for (int c = 0; c < num_connections; ++c) {
+        clients.emplace_back([&, c] {
+            std::mt19937 generator(c);
+            std::uniform_real_distribution<float> pixel(0.0f, 1.0f);
+            std::vector<float> input(input_size);
+            std::vector<char> response;
+            int fd = -1;
+
+            try {
+                fd = inference_protocol::connect_unix_socket(socket_path);
+            }
+            catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                failures[c] = requests_per_connection;
+                return;
+            }
+
+            for (int i = 0; i < requests_per_connection; ++i) {
+                for (float& value : input) {
+                    value = pixel(generator);
+                }
+
+                auto sent = std::chrono::steady_clock::now();
+                uint32_t status = 0;
+                uint32_t count = 0;
+
+                if (!inference_protocol::write_u32(fd, inference_protocol::predict_request) ||
+                    !inference_protocol::write_u32(fd, static_cast<uint32_t>(input_size)) ||
+                    !inference_protocol::write_exact(fd, input.data(), input.size() * sizeof(float)) ||
+                    !inference_protocol::read_u32(fd, status) ||
+                    !inference_protocol::read_u32(fd, count)) {
+                    ++failures[c];
+                    break;
+                }
+
+                response.resize(status == inference_protocol::status_ok ? count * sizeof(float) : count);
+                if (!inference_protocol::read_exact(fd, response.data(), response.size())) {
+                    ++failures[c];
+                    break;
+                }
+
+                if (status != inference_protocol::status_ok) {
+                    ++failures[c];
+                    continue;
+                }
+
+                latencies_us[c].push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - sent).count());
+            }
+
+            ::close(fd);
+        });
+    }
+
+    for (std::thread& client : clients) {
+        client.join();
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(end - beg).count();
+
+    std::vector<double> all_latencies;
+    int total_failures = 0;
+    for (int c = 0; c < num_connections; ++c) {
+        all_latencies.insert(all_latencies.end(), latencies_us[c].begin(), latencies_us[c].end());
+        total_failures += failures[c];
+    }
+
+    if (all_latencies.empty()) {
+        std::cerr << "No successful requests" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Requests: " << all_latencies.size() << " Failures: " << total_failures
+              << " Throughput: " << all_latencies.size() / seconds << " requests/s" << std::endl;
+    std::cout << "Latency p50: " << utility::percentile(all_latencies, 0.50) << "us"
+              << " p99: " << utility::percentile(all_latencies, 0.99) << "us"
+              << " max: " << utility::percentile(all_latencies, 1.0) << "us" << std::endl;
+
+    /* Server side view, including the batch sizes it formed */
+    int fd = inference_protocol::connect_unix_socket(socket_path);
+    uint32_t status = 0;
+    uint32_t count = 0;
+    if (inference_protocol::write_u32(fd, inference_protocol::stats_request) &&
+        inference_protocol::read_u32(fd, status) &&
+        inference_protocol::read_u32(fd, count)) {
+        std::string stats(count, '\0');
+        if (inference_protocol::read_exact(fd, &stats[0], count)) {
+            std::cout << "Server stats: " << stats << std::endl;
+        }
+    }
+    ::close(fd);
+
+    return 0;
+}
@@ -0,0 +1,358 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <stdexcept>
+#include "neural_network.hpp"
+#include "mnist_network.hpp"
+#include "tensor.hpp"
+#include "thread_pool.hpp"
+#include "kernels.hpp"
+#include "allocation_tracker.hpp"
+#include "utility.hpp"
+
+namespace {
+
+    struct Metric {
+        std::string name;
+        // Throughputs regress when they fall, allocation counts when they rise
+        bool higher_is_better;
+        double value;
+    };
+
+    struct Workload {
+        unsigned seed;
+        int steps;
+        int predictions;
+    };
+
+    /* Synthetic MNIST shaped samples, the same for every run with the same seed */
+    void make_samples(const unsigned seed, const int count, std::vector<Tensor>& inputs, std::vector<Tensor>& labels) {
+        std::mt19937 generator(seed);
+        std::uniform_real_distribution<double> pixel(0.0, 1.0);
+        std::uniform_int_distribution<int> digit(0, 9);
+
+        for (int i = 0; i < count; ++i) {
+            Tensor input(1, 28, 28);
+            for (int r = 0; r < 28; ++r) {
+                for (int c = 0; c < 28; ++c) {
+                    input(0)(r, c) = pixel(generator);
+                }
+            }
+
+            Tensor label(1, 1, 10);
+            label(0)(0, digit(generator)) = 1.0;
+
+            inputs.push_back(std::move(input));
+            labels.push_back(std::move(label));
+        }
+    }
+
+    /* One run of the workload on a freshly initialized network */
+    std::vector<Metric> run(const Workload& workload) {
+        utility::seed_random(workload.seed);
+        NeuralNetwork network = create_mnist_network(0.01);
+
+        std::vector<Tensor> inputs;
+        std::vector<Tensor> labels;
+        make_samples(workload.seed, 64, inputs, labels);
+
+        auto beg = std::chrono::steady_clock::now();
+        for (int i = 0; i < workload.steps; ++i) {
+            network.train(inputs[i % inputs.size()], labels[i % labels.size()]);
+        }
+        const double train_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - beg).count();
+
+        InferenceWorkspace workspace;
+        double checksum = 0.0;
+        beg = std::chrono::steady_clock::now();
+        for (int i = 0; i < workload.predictions; ++i) {
+            checksum += network.predict(inputs[i % inputs.size()], workspace)(0)(0, 0);
+        }
+        const double predict_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - beg).count();
+
+        if (checksum != checksum) {
+            throw std::runtime_error("Perf_regression run: workload produced NaN outputs");
+        }
+
+        return {{"train_steps_per_second", true, workload.steps / train_seconds},
+                {"predictions_per_second", true, workload.predictions / predict_seconds}};
+    }
+
+    /* Counted in an untimed run, since tracking slows every allocation down */
+    Metric count_allocations(const Workload& workload) {
+        utility::seed_random(workload.seed);
+        NeuralNetwork network = create_mnist_network(0.01);
+
+        std::vector<Tensor> inputs;
+        std::vector<Tensor> labels;
+        make_samples(workload.seed, 64, inputs, labels);
+
+        AllocationTracker& tracker = AllocationTracker::get_global();
+        tracker.enable(network.get_num_layers());
+        tracker.reset_report();
+
+        for (int i = 0; i < std::min(workload.steps, 64); ++i) {
+            network.train(inputs[i], labels[i]);
+        }
+
+        const AllocationReport report = tracker.get_report();
+        tracker.disable();
+
+        return {"allocations_per_step", false, static_cast<double>(report.step_allocations) / report.steps};
+    }
+
+    /* Median of every metric over the repeats */
+    std::vector<Metric> measure(const Workload& workload, const int repeats, double& worst_spread) {
+        std::vector<std::vector<Metric>> runs;
+        for (int i = 0; i < repeats; ++i) {
+            runs.push_back(run(workload));
+        }
+
+        std::vector<Metric> medians = runs[0];
+        medians.push_back(count_allocations(workload));
+        worst_spread = 0.0;
+        for (size_t m = 0; m < runs[0].size(); ++m) {
+            std::vector<double> values;
+            for (const std::vector<Metric>& metrics : runs) {
+                values.push_back(metrics[m].value);
+            }
+
+            medians[m].value = utility::percentile(values, 0.5);
+            if (medians[m].value > 0.0) {
+                const double spread = (*std::max_element(values.begin(), values.end()) -
+                                       *std::min_element(values.begin(), values.end())) / medians[m].value;
+                worst_spread = std::max(worst_spread, spread);
+            }
+        }
+
+        return medians;
+    }
+
+    /* Reads "name": number from the flat JSON this tool writes */
+    bool read_number(const std::string& json, const std::string& name, double& value) {
+        const std::string key = "\"" + name + "\"";
+        size_t position = json.find(key);
+        if (position == std::string::npos) {
+            return false;
+        }
+
+        position = json.find(':', position + key.size());
+        if (position == std::string::npos) {
+            return false;
+        }
+
+        std::istringstream stream(json.substr(position + 1));
+        return static_cast<bool>(stream >> value);
+    }
+
+    /* Reads "name": "text" from the flat JSON this tool writes, the text is never escaped */
+    bool read_string(const std::string& json, const std::string& name, std::string& value) {
+        const std::string key = "\"" + name + "\"";
+        size_t position = json.find(key);
+        if (position == std::string::npos) {
+            return false;
+        }
+
+        const size_t begin = json.find('"', json.find(':', position + key.size()));
+        const size_t end = begin == std::string::npos ? std::string::npos : json.find('"', begin + 1);
+        if (end == std::string::npos) {
+            return false;
+        }
+
+        value = json.substr(begin + 1, end - begin - 1);
+        return true;
+    }
+
+    void write_baseline(const std::string& path, const Workload& workload, const std::vector<Metric>& metrics) {
+        std::ofstream file(path);
+        file << std::setprecision(6) << std::fixed;
+        file << "{\n"
+             << "  \"seed\": " << workload.seed << ",\n"
+             << "  \"steps\": " << workload.steps << ",\n"
+             << "  \"predictions\": " << workload.predictions << ",\n"
+             << "  \"threads\": " << ThreadPool::get_global().get_num_threads() << ",\n"
+             << "  \"isa\": \"" << kernels::get_isa_name(kernels::get_isa()) << "\"";
+
+        for (const Metric& metric : metrics) {
+            file << ",\n  \"" << metric.name << "\": " << metric.value;
+        }
+        file << "\n}\n";
+
+        if (!file) {
+            throw std::runtime_error("Perf_regression write_baseline: failed to write " + path);
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+
+    std::string baseline_path = "perf/baseline.json";
+    Workload workload = {42, 300, 1000};
+    int repeats = 5;
+    int max_rounds = 3;
+    double tolerance = 0.15;
+    bool update = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+
+        if (argument == "--baseline" && i + 1 < argc) {
+            baseline_path = argv[++i];
+        }
+        else if (argument == "--steps" && i + 1 < argc) {
+            workload.steps = std::stoi(argv[++i]);
+        }
+        else if (argument == "--predictions" && i + 1 < argc) {
+            workload.predictions = std::stoi(argv[++i]);
+        }
+        else if (argument == "--seed" && i + 1 < argc) {
+            workload.seed = static_cast<unsigned>(std::stoul(argv[++i]));
+        }
+        else if (argument == "--repeats" && i + 1 < argc) {
+            repeats = std::stoi(argv[++i]);
+        }
+        else if (argument == "--rounds" && i + 1 < argc) {
+            max_rounds = std::stoi(argv[++i]);
+        }
+        else if (argument == "--tolerance" && i + 1 < argc) {
+            tolerance = std::stod(argv[++i]);
+        }
+        else if (argument == "--update") {
+            update = true;
+        }
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--baseline path] [--steps count] [--predictions count] [--seed seed]"
+                      << " [--repeats count] [--rounds count] [--tolerance fraction] [--update]" << std::endl;
+            return 1;
+        }
+    }
+
+    if (workload.steps <= 0 || workload.predictions <= 0 || repeats <= 0 || max_rounds <= 0 || tolerance < 0.0) {
+        std::cerr << "--steps, --predictions, --repeats and --rounds must be greater than 0 and --tolerance not negative" << std::endl;
+        return 1;
+    }
+
+    std::string baseline;
+    if (!update) {
+        std::ifstream file(baseline_path);
+        if (!file) {
+            std::cerr << "No baseline at " << baseline_path << ", create one with --update" << std::endl;
+            return 1;
+        }
+        baseline.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+        double baseline_steps = 0.0;
+        double baseline_predictions = 0.0;
+        double baseline_seed = 0.0;
+        double baseline_threads = 0.0;
+        if (!read_number(baseline, "steps", baseline_steps) || !read_number(baseline, "predictions", baseline_predictions) ||
+            !read_number(baseline, "seed", baseline_seed) ||
+            static_cast<int>(baseline_steps) != workload.steps || static_cast<int>(baseline_predictions) != workload.predictions ||
+            static_cast<unsigned>(baseline_seed) != workload.seed) {
+            std::cerr << "The baseline was recorded for a different workload, rerun with the same --steps, --predictions and --seed or --update" << std::endl;
+            return 1;
+        }
+        if (read_number(baseline, "threads", baseline_threads) && static_cast<int>(baseline_threads) != ThreadPool::get_global().get_num_threads()) {
+            std::cout << "Warning: the baseline was recorded on " << baseline_threads << " threads" << std::endl;
+        }
+
+        /* Kernel variants differ several times in speed, so the check runs the ones the baseline was recorded with */
+        std::string baseline_isa;
+        if (!read_string(baseline, "isa", baseline_isa)) {
+            std::cout << "Warning: the baseline does not record its kernels, create a new one with --update" << std::endl;
+        }
+        else if (baseline_isa != kernels::get_isa_name(kernels::get_isa())) {
+            bool supported = false;
+            for (const kernels::Isa isa : kernels::get_supported_isas()) {
+                if (kernels::get_isa_name(isa) == baseline_isa) {
+                    kernels::set_isa(isa);
+                    supported = true;
+                }
+            }
+            if (!supported) {
+                std::cerr << "The baseline was recorded with the " << baseline_isa << " kernels, which this CPU does not support,"
+                          << " create a new one with --update" << std::endl;
+                return 1;
+            }
+            std::cout << "Using the " << baseline_isa << " kernels the baseline was recorded with" << std::endl;
+        }
+    }
+
+    std::cout << "Running " << workload.steps << " training steps and " << workload.predictions << " predictions, "
+              << repeats << " times on " << ThreadPool::get_global().get_num_threads() << " threads with the "
+              << kernels::get_isa_name(kernels::get_isa()) << " kernels" << std::endl;
+
+    /* A first warm up run so page faults and lazy initialization stay out of the measurements */
+    run({workload.seed, std::min(workload.steps, 20), std::min(workload.predictions, 20)});
+
+    double spread = 0.0;
+    std::vector<Metric> current = measure(workload, repeats, spread);
+
+    if (update) {
+        write_baseline(baseline_path, workload, current);
+        std::cout << "Wrote baseline to " << baseline_path << std::endl;
+        return 0;
+    }
+
+    /* A regression has to persist over several rounds of repeats, keeping the best median seen for each metric */
+    std::vector<bool> regressed(current.size(), false);
+    std::vector<double> expected(current.size(), 0.0);
+    for (int round = 1; ; ++round) {
+        bool any_regressed = false;
+        for (size_t m = 0; m < current.size(); ++m) {
+            if (!read_number(baseline, current[m].name, expected[m])) {
+                std::cerr << "The baseline has no " << current[m].name << ", create a new one with --update" << std::endl;
+                return 1;
+            }
+
+            regressed[m] = current[m].higher_is_better ? current[m].value < expected[m] * (1.0 - tolerance)
+                                                       : current[m].value > expected[m] * (1.0 + tolerance);
+            any_regressed = any_regressed || regressed[m];
+        }
+
+        if (!any_regressed || round >= max_rounds) {
+            break;
+        }
+
+        std::cout << "Round " << round << " looks slower than the baseline, measuring again" << std::endl;
+        double round_spread = 0.0;
+        std::vector<Metric> retry = measure(workload, repeats, round_spread);
+        for (size_t m = 0; m < current.size(); ++m) {
+            current[m].value = current[m].higher_is_better ? std::max(current[m].value, retry[m].value)
+                                                           : std::min(current[m].value, retry[m].value);
+        }
+        spread = std::min(spread, round_spread);
+    }
+
+    bool failed = false;
+    std::cout << std::left << std::setw(26) << "metric" << std::right << std::setw(14) << "baseline" << std::setw(14) << "current"
+              << std::setw(10) << "change" << "  status" << std::endl;
+    std::cout << std::fixed;
+    for (size_t m = 0; m < current.size(); ++m) {
+        const double change = expected[m] > 0.0 ? (current[m].value - expected[m]) / expected[m] * 100.0 : 0.0;
+        std::cout << std::left << std::setw(26) << current[m].name << std::right << std::setprecision(2)
+                  << std::setw(14) << expected[m] << std::setw(14) << current[m].value
+                  << std::setw(9) << std::showpos << change << "%" << std::noshowpos
+                  << "  " << (regressed[m] ? "REGRESSED" : "ok") << std::endl;
+        failed = failed || regressed[m];
+    }
+
+    if (spread > tolerance) {
+        std::cout << "Warning: repeats varied by up to " << std::setprecision(1) << spread * 100.0
+                  << "%, more than the tolerance, the machine may be too noisy for this check" << std::endl;
+    }
+
+    if (failed) {
+        std::cout << "Performance regressed by more than " << std::setprecision(0) << tolerance * 100.0 << "%" << std::endl;
+        return 1;
+    }
+
+    std::cout << "No regression beyond " << std::setprecision(0) << tolerance * 100.0 << "%" << std::endl;
+    return 0;
+}